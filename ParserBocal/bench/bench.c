@@ -0,0 +1,276 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   bench.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:03:46 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:46:55 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include "bench.h"
+#include "../common/csvscan.h"
+
+// Benchmark of the journal generators, stage by stage: reading, tokenizing,
+// classification and writing for JB, reading and conversion for JV and JC,
+// and the amount parser they share on its own (MONEY).
+// The February 2025 exports are converted first and compared with the
+// journals in bench/anchors, so a run that times wrong code fails. Then each
+// tool runs on inputs grown from the same exports to each requested size.
+// Results go to a JSON file, one object per tool, size and stage.
+
+#define BENCH_DEFAULT_SIZES "1000,10000,100000,1000000,10000000"
+#define BENCH_MAX_SIZES 16
+
+// Compiler flags of the build, recorded with the results
+#ifndef BENCH_CFLAGS
+# define BENCH_CFLAGS ""
+#endif
+
+typedef int (*BenchAnchorFunc)(const BenchConfig *, char *, size_t);
+typedef int (*BenchToolFunc)(const BenchConfig *, long long, BenchRun *);
+
+static const struct {
+    const char *name;
+    BenchAnchorFunc anchor;
+    BenchToolFunc run;
+} bench_tools[] = {
+    {"JB", bench_jb_anchor, bench_jb},
+    {"JV", bench_jv_anchor, bench_jv},
+    {"JC", bench_jc_anchor, bench_jc},
+    {"MONEY", bench_money_anchor, bench_money},
+};
+
+#define BENCH_TOOL_COUNT (int)(sizeof(bench_tools) / sizeof(bench_tools[0]))
+
+double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+BenchStage *bench_stage(BenchRun *run, const char *name, size_t expected) {
+    BenchStage *stage = &run->stages[run->stage_count++];
+    memset(stage, 0, sizeof(*stage));
+    stage->name = name;
+    stage->samples = malloc((expected ? expected : 1) * sizeof(uint32_t));
+    stage->capacity = stage->samples ? expected : 0;
+    return stage;
+}
+
+void bench_sample(BenchStage *stage, double seconds, long long records) {
+    double ns = records > 0 ? seconds * 1e9 / (double)records : seconds * 1e9;
+
+    stage->seconds += seconds;
+    if (stage->count == stage->capacity) {
+        size_t capacity = stage->capacity ? stage->capacity * 2 : 1024;
+        uint32_t *grown = realloc(stage->samples, capacity * sizeof(uint32_t));
+        if (!grown)
+            return;
+        stage->samples = grown;
+        stage->capacity = capacity;
+    }
+    stage->samples[stage->count++] = ns >= 4294967295.0 ? UINT32_MAX : (uint32_t)ns;
+}
+
+void bench_run_free(BenchRun *run) {
+    for (int i = 0; i < run->stage_count; i++)
+        free(run->stages[i].samples);
+    run->stage_count = 0;
+}
+
+char *bench_read_file(const char *path, size_t *len) {
+    char *data = csv_read_file(path, len);
+    if (!data)
+        fprintf(stderr, "Error: Could not read %s\n", path);
+    return data;
+}
+
+int bench_check_anchor(const BenchConfig *config, const char *anchor, const char *data, size_t len,
+                       char *message, size_t size) {
+    char path[1024];
+    size_t expected_len;
+
+    snprintf(path, sizeof(path), "%s/%s", config->anchors, anchor);
+    char *expected = csv_read_file(path, &expected_len);
+    if (!expected) {
+        snprintf(message, size, "%s is missing", path);
+        return 0;
+    }
+    size_t same = 0;
+    while (same < len && same < expected_len && data[same] == expected[same])
+        same++;
+    int ok = same == len && same == expected_len;
+    if (!ok) {
+        int line = 1;
+        for (size_t i = 0; i < same; i++)
+            line += expected[i] == '\n';
+        snprintf(message, size, "differs from %s at line %d", path, line);
+    }
+    free(expected);
+    return ok;
+}
+
+static int compare_samples(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const BenchStage *stage, int pct) {
+    if (stage->count == 0)
+        return 0;
+    size_t i = (stage->count * (size_t)pct) / 100;
+    return stage->samples[i < stage->count ? i : stage->count - 1];
+}
+
+static void report_run(FILE *json, int first, BenchRun *run) {
+    double mb = (double)run->bytes / (1024.0 * 1024.0);
+
+    for (int i = 0; i < run->stage_count; i++) {
+        BenchStage *stage = &run->stages[i];
+        double seconds = stage->seconds > 0 ? stage->seconds : 1e-9;
+        qsort(stage->samples, stage->count, sizeof(uint32_t), compare_samples);
+        uint32_t p50 = percentile(stage, 50);
+        uint32_t p99 = percentile(stage, 99);
+
+        printf("%-5s %10lld  %-9s %9.4f s %12.0f rec/s %9.1f MB/s %9u %9u\n", run->tool, run->records,
+               stage->name, stage->seconds, (double)run->records / seconds, mb / seconds, p50, p99);
+        if (json) {
+            fprintf(json, "%s    {\"tool\": \"%s\", \"records\": %lld, \"bytes\": %lld, \"stage\": \"%s\", "
+                    "\"seconds\": %.6f, \"records_per_s\": %.1f, \"mb_per_s\": %.2f, "
+                    "\"p50_ns\": %u, \"p99_ns\": %u}",
+                    first && i == 0 ? "" : ",\n", run->tool, run->records, run->bytes, stage->name,
+                    stage->seconds, (double)run->records / seconds, mb / seconds, p50, p99);
+        }
+    }
+}
+
+static int parse_sizes(const char *text, long long *sizes) {
+    int count = 0;
+    const char *p = text;
+
+    while (*p && count < BENCH_MAX_SIZES) {
+        char *end;
+        double value = strtod(p, &end);
+        if (end == p || value < 1)
+            return 0;
+        if (*end == 'K' || *end == 'k') { value *= 1e3; end++; }
+        else if (*end == 'M' || *end == 'm') { value *= 1e6; end++; }
+        sizes[count++] = (long long)value;
+        if (*end == ',') end++;
+        else if (*end) return 0;
+        p = end;
+    }
+    return count;
+}
+
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [-s sizes] [-o results.json] [--assets dir] [--anchors dir] [--chart file]\n",
+           program_name);
+    printf("       [--tool JB|JV|JC|MONEY] [--anchors-only]\n");
+    printf("Sizes are records per run, comma separated, with K and M suffixes (default %s).\n",
+           BENCH_DEFAULT_SIZES);
+    printf("JB records are operations, JV and JC records are days, MONEY records are amounts.\n");
+}
+
+int main(int argc, char *argv[]) {
+    BenchConfig config = {
+        .assets = "assets",
+        .anchors = "bench/anchors",
+        .chart = "assets/Plan Comptable 2025-05.csv",
+        .tmp_dir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp",
+    };
+    const char *sizes_text = BENCH_DEFAULT_SIZES;
+    const char *out_path = "bench/results.json";
+    const char *only_tool = NULL;
+    int anchors_only = 0;
+    long long sizes[BENCH_MAX_SIZES];
+    char message[512];
+    int failed = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) sizes_text = argv[++i];
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) out_path = argv[++i];
+        else if (strcmp(argv[i], "--assets") == 0 && i + 1 < argc) config.assets = argv[++i];
+        else if (strcmp(argv[i], "--anchors") == 0 && i + 1 < argc) config.anchors = argv[++i];
+        else if (strcmp(argv[i], "--chart") == 0 && i + 1 < argc) config.chart = argv[++i];
+        else if (strcmp(argv[i], "--tool") == 0 && i + 1 < argc) only_tool = argv[++i];
+        else if (strcmp(argv[i], "--anchors-only") == 0) anchors_only = 1;
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    int size_count = parse_sizes(sizes_text, sizes);
+    if (size_count == 0) {
+        fprintf(stderr, "Error: Invalid sizes %s\n", sizes_text);
+        return 1;
+    }
+
+    // Correctness first: the staged pipelines must give the journals of the tools
+    for (int t = 0; t < BENCH_TOOL_COUNT; t++) {
+        if (only_tool && strcmp(only_tool, bench_tools[t].name) != 0)
+            continue;
+        if (bench_tools[t].anchor(&config, message, sizeof(message))) {
+            printf("%s anchor: ok\n", bench_tools[t].name);
+        } else {
+            printf("%s anchor: FAILED, %s\n", bench_tools[t].name, message);
+            failed = 1;
+        }
+    }
+    if (failed || anchors_only)
+        return failed ? 2 : 0;
+
+    FILE *json = fopen(out_path, "w");
+    if (!json) {
+        fprintf(stderr, "Error: Could not create %s\n", out_path);
+        return 3;
+    }
+    struct utsname host;
+    char date[32] = "";
+    time_t now = time(NULL);
+    struct tm tm;
+    if (uname(&host) != 0)
+        memset(&host, 0, sizeof(host));
+    if (localtime_r(&now, &tm))
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &tm);
+    fprintf(json, "{\n  \"date\": \"%s\",\n  \"system\": \"%s %s\",\n  \"machine\": \"%s\",\n"
+            "  \"cpus\": %ld,\n  \"cflags\": \"%s\",\n  \"results\": [\n",
+            date, host.sysname, host.release, host.machine, sysconf(_SC_NPROCESSORS_ONLN), BENCH_CFLAGS);
+
+    printf("%-5s %10s  %-9s %11s %18s %14s %9s %9s\n", "tool", "records", "stage", "time", "throughput",
+           "", "p50 ns", "p99 ns");
+    int first = 1;
+    for (int s = 0; s < size_count; s++) {
+        for (int t = 0; t < BENCH_TOOL_COUNT; t++) {
+            BenchRun run;
+            if (only_tool && strcmp(only_tool, bench_tools[t].name) != 0)
+                continue;
+            memset(&run, 0, sizeof(run));
+            run.tool = bench_tools[t].name;
+            if (!bench_tools[t].run(&config, sizes[s], &run)) {
+                fprintf(stderr, "Error: %s failed on %lld records\n", run.tool, sizes[s]);
+                failed = 1;
+            } else {
+                report_run(json, first, &run);
+                first = 0;
+            }
+            bench_run_free(&run);
+            fflush(stdout);
+        }
+    }
+    fprintf(json, "\n  ]\n}\n");
+    if (fclose(json) != 0)
+        failed = 1;
+    printf("Results written to %s\n", out_path);
+    return failed ? 4 : 0;
+}
@@ -0,0 +1,78 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   bench.h                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:03:46 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:46:55 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef BENCH_H
+# define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BENCH_MAX_STAGES 4
+
+// Time spent in one stage of a tool, with latency samples in nanoseconds: one
+// per operation for JB, one per month for JV and JC (the month's time divided
+// by its days, since they convert a whole export at a time), one per batch of
+// amounts for MONEY
+typedef struct {
+    const char *name;
+    double seconds;
+    uint32_t *samples;
+    size_t count;
+    size_t capacity;
+} BenchStage;
+
+// One tool on one input size
+typedef struct {
+    const char *tool;
+    long long records;      // operations (JB), days (JV, JC), amounts (MONEY)
+    long long bytes;        // input bytes
+    BenchStage stages[BENCH_MAX_STAGES];
+    int stage_count;
+} BenchRun;
+
+// Where the inputs come from and where the scratch files go
+typedef struct {
+    const char *assets;     // February 2025 exports, also the correctness anchors
+    const char *anchors;    // journals expected from the assets
+    const char *chart;
+    const char *tmp_dir;
+} BenchConfig;
+
+// Monotonic clock in seconds
+double bench_now(void);
+
+// Stage of a run, with room for `expected` samples
+BenchStage *bench_stage(BenchRun *run, const char *name, size_t expected);
+
+// Account `seconds` to a stage, sampled as the latency of each of `records` records
+void bench_sample(BenchStage *stage, double seconds, long long records);
+
+void bench_run_free(BenchRun *run);
+
+// Compare a journal with the anchor file; returns 0 with a message on mismatch
+int bench_check_anchor(const BenchConfig *config, const char *anchor, const char *data, size_t len,
+                       char *message, size_t size);
+
+// Whole file in a writable NUL-terminated buffer, NULL with a message on failure
+char *bench_read_file(const char *path, size_t *len);
+
+// Tools: convert the assets and compare with the anchors, then time `records` records
+int bench_jb_anchor(const BenchConfig *config, char *message, size_t size);
+int bench_jb(const BenchConfig *config, long long records, BenchRun *run);
+int bench_jv_anchor(const BenchConfig *config, char *message, size_t size);
+int bench_jv(const BenchConfig *config, long long records, BenchRun *run);
+int bench_jc_anchor(const BenchConfig *config, char *message, size_t size);
+int bench_jc(const BenchConfig *config, long long records, BenchRun *run);
+int bench_money_anchor(const BenchConfig *config, char *message, size_t size);
+int bench_money(const BenchConfig *config, long long records, BenchRun *run);
+
+#endif
@@ -0,0 +1,285 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   bench_jb.c                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:03:46 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:17:44 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include "bench.h"
+#include "../process_JB/process.h"
+
+// JB stages, per operation: reading (framing a record with its continuation
+// lines, refilling from the file as needed), tokenizing (parse_bank_operation
+// and the details), classification (convert_to_journal_entries) and writing
+// (the rows, through the buffered writer). Larger statements repeat the
+// operations of the February 2025 statement after its bank header.
+
+#define JB_STATEMENT "Journal Banque Fevrier 2025/BQ-Releve bancaire fevrier 2025.csv"
+#define JB_ANCHOR "jb.csv"
+
+typedef struct {
+    ChartOfAccounts chart;
+    RuleSet rules;
+    Classifier classifier;
+} JbSetup;
+
+static int jb_setup(const BenchConfig *config, JbSetup *setup) {
+    load_chart_of_accounts(config->chart, &setup->chart);
+    if (!load_classification_rules(NULL, &setup->rules) ||
+        !classifier_init(&setup->classifier, &setup->chart, &setup->rules)) {
+        free_classification_rules(&setup->rules);
+        free_chart_of_accounts(&setup->chart);
+        return 0;
+    }
+    return 1;
+}
+
+static void jb_teardown(JbSetup *setup) {
+    classifier_free(&setup->classifier);
+    free_classification_rules(&setup->rules);
+    free_chart_of_accounts(&setup->chart);
+}
+
+// The operations of a statement, timed stage by stage
+static long long jb_convert(RecordReader *reader, JournalWriter *output, Classifier *classifier,
+                            BenchRun *run, size_t expected) {
+    BenchStage *read = bench_stage(run, "read", expected);
+    BenchStage *tokenize = bench_stage(run, "tokenize", expected);
+    BenchStage *classify = bench_stage(run, "classify", expected);
+    BenchStage *write = bench_stage(run, "write", expected);
+    StatementRecord record;
+    BankOperation operation;
+    JournalEntry entries[MAX_OPERATIONS];
+    long long operations = 0;
+
+    double t0 = bench_now();
+    if (!find_statement_header(reader))
+        return -1;
+    jwriter_header(output);
+    for (;;) {
+        int more = reader_next_record(reader, &record);
+        double t1 = bench_now();
+        bench_sample(read, t1 - t0, 1);
+        if (!more)
+            break;
+        if (!parse_statement_record(&record, &operation, &classifier->arena)) {
+            t0 = bench_now();
+            tokenize->seconds += t0 - t1;
+            continue;
+        }
+        double t2 = bench_now();
+        int count = convert_to_journal_entries(&operation, entries, classifier);
+        double t3 = bench_now();
+        for (int i = 0; i < count; i++)
+            write_journal_entry(output, &entries[i]);
+        arena_reset(&classifier->arena);
+        double t4 = bench_now();
+        bench_sample(tokenize, t2 - t1, 1);
+        bench_sample(classify, t3 - t2, 1);
+        bench_sample(write, t4 - t3, 1);
+        operations++;
+        t0 = bench_now();
+    }
+    double t5 = bench_now();
+    if (!jwriter_flush(output))
+        return -1;
+    write->seconds += bench_now() - t5;
+    return operations;
+}
+
+// The statement as the bank exports it, and as it comes back from other tools:
+// without quotes, and with the Crédit column moved to the front (every debit
+// line then starts with an empty field, like a continuation line). Each is a
+// copy, the conversion splits its lines in place.
+typedef char *(*JbVariant)(const char *data, size_t len, size_t *out_len);
+
+static char *jb_as_exported(const char *data, size_t len, size_t *out_len) {
+    char *out = malloc(len + 1);
+
+    if (!out)
+        return NULL;
+    memcpy(out, data, len);
+    out[len] = '\0';
+    *out_len = len;
+    return out;
+}
+
+static char *jb_unquoted(const char *data, size_t len, size_t *out_len) {
+    char *out = malloc(len + 1);
+    size_t n = 0;
+
+    if (!out)
+        return NULL;
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] != '"')
+            out[n++] = data[i];
+    }
+    out[n] = '\0';
+    *out_len = n;
+    return out;
+}
+
+static char *jb_credit_first(const char *data, size_t len, size_t *out_len) {
+    char *out = malloc(len + 2);
+    size_t n = 0;
+
+    if (!out)
+        return NULL;
+    for (const char *line = data; line < data + len;) {
+        const char *eol = memchr(line, '\n', (size_t)(data + len - line));
+        const char *end = eol ? eol : data + len;
+        Slice credit = line_field(line, (size_t)(end - line), ';', 3);
+        if (credit.len) {
+            const char *after = credit.ptr + credit.len;
+            memcpy(out + n, credit.ptr, credit.len);
+            n += credit.len;
+            out[n++] = ';';
+            memcpy(out + n, line, (size_t)(credit.ptr - 1 - line));
+            n += (size_t)(credit.ptr - 1 - line);
+            memcpy(out + n, after, (size_t)(end - after));
+            n += (size_t)(end - after);
+        } else {
+            memcpy(out + n, line, (size_t)(end - line));
+            n += (size_t)(end - line);
+        }
+        if (eol)
+            out[n++] = '\n';
+        line = eol ? eol + 1 : data + len;
+    }
+    out[n] = '\0';
+    *out_len = n;
+    return out;
+}
+
+static const struct {
+    const char *name;
+    JbVariant make;
+} jb_variants[] = {
+    {"as exported", jb_as_exported},
+    {"unquoted", jb_unquoted},
+    {"Credit first", jb_credit_first},
+};
+
+int bench_jb_anchor(const BenchConfig *config, char *message, size_t size) {
+    char path[1024];
+    size_t len;
+    JbSetup setup;
+
+    snprintf(path, sizeof(path), "%s/%s", config->assets, JB_STATEMENT);
+    char *data = bench_read_file(path, &len);
+    if (!data || !jb_setup(config, &setup)) {
+        snprintf(message, size, "could not load %s or the chart", path);
+        free(data);
+        return 0;
+    }
+    int ok = 1;
+    for (size_t v = 0; ok && v < sizeof(jb_variants) / sizeof(jb_variants[0]); v++) {
+        RecordReader reader;
+        JournalWriter output;
+        BenchRun run;
+        size_t variant_len = 0;
+        char *variant = jb_variants[v].make(data, len, &variant_len);
+
+        memset(&run, 0, sizeof(run));
+        reader_init_memory(&reader, variant, variant_len);
+        ok = variant && jwriter_init(&output, -1, JOURNAL_LAYOUT_CPTE_LIBELLE) &&
+             jb_convert(&reader, &output, &setup.classifier, &run, 256) > 0;
+        size_t journal_len;
+        char *journal = ok ? jwriter_take(&output, &journal_len) : NULL;
+        ok = journal && bench_check_anchor(config, JB_ANCHOR, journal, journal_len, message, size);
+        if (!journal)
+            snprintf(message, size, "conversion failed");
+        if (!ok) {
+            char detail[256];
+            snprintf(detail, sizeof(detail), "%s", message);
+            snprintf(message, size, "%s (%s)", detail, jb_variants[v].name);
+        }
+        free(journal);
+        bench_run_free(&run);
+        reader_free(&reader);
+        free(variant);
+    }
+    jb_teardown(&setup);
+    free(data);
+    return ok;
+}
+
+// Statement of `records` operations: the bank header, then the operations of
+// the February statement over and over
+static int jb_write_input(const BenchConfig *config, const char *path, long long records, long long *bytes) {
+    char source[1024];
+    size_t len;
+
+    snprintf(source, sizeof(source), "%s/%s", config->assets, JB_STATEMENT);
+    char *data = bench_read_file(source, &len);
+    if (!data)
+        return 0;
+    CsvDialect dialect;
+    int found = sniff_statement(data, len, &dialect);
+    FILE *out = fopen(path, "w");
+    if (!found || dialect.data_offset >= len || !out) {
+        free(data);
+        if (out) fclose(out);
+        return 0;
+    }
+    char *first = data + dialect.data_offset;
+    fwrite(data, 1, (size_t)(first - data), out);
+
+    // Each operation starts on a line that is not a continuation line
+    long long written = 0;
+    while (written < records) {
+        char *line = first;
+        while (line < data + len && written < records) {
+            char *eol = strchr(line, '\n');
+            char *end = eol ? eol + 1 : data + len;
+            while (end < data + len) {
+                eol = strchr(end, '\n');
+                if (!statement_continuation(end, eol ? (size_t)(eol - end) : strlen(end), &dialect))
+                    break;
+                end = eol ? eol + 1 : data + len;
+            }
+            fwrite(line, 1, (size_t)(end - line), out);
+            if (end == data + len && end[-1] != '\n')
+                fputc('\n', out);
+            written++;
+            line = end;
+        }
+    }
+    *bytes = ftell(out);
+    free(data);
+    return fclose(out) == 0;
+}
+
+int bench_jb(const BenchConfig *config, long long records, BenchRun *run) {
+    char path[1024];
+    JbSetup setup;
+    RecordReader reader;
+    JournalWriter output;
+
+    snprintf(path, sizeof(path), "%s/bench-jb-%ld.csv", config->tmp_dir, (long)getpid());
+    if (!jb_write_input(config, path, records, &run->bytes) || !jb_setup(config, &setup)) {
+        unlink(path);
+        return 0;
+    }
+    int fd = open(path, O_RDONLY);
+    int out_fd = open("/dev/null", O_WRONLY);
+    int ok = fd >= 0 && out_fd >= 0 && reader_init(&reader, fd);
+    if (ok) {
+        ok = jwriter_init(&output, out_fd, JOURNAL_LAYOUT_CPTE_LIBELLE);
+        run->records = ok ? jb_convert(&reader, &output, &setup.classifier, run, (size_t)records) : -1;
+        ok = run->records >= 0 && jwriter_close(&output);
+        reader_free(&reader);
+    }
+    if (fd >= 0) close(fd);
+    if (out_fd >= 0) close(out_fd);
+    jb_teardown(&setup);
+    unlink(path);
+    return ok;
+}
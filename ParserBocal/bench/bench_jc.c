@@ -0,0 +1,95 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   bench_jc.c                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:03:46 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:03:46 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include "bench.h"
+#include "../process_JC/Journal_Caisse.h"
+
+// JC stages, per month: reading the cash export and converting it, since
+// convert_cash_withdrawals tokenizes and writes each day in one pass. Larger
+// runs convert the February 2025 export month after month until they reach
+// the requested number of days.
+
+#define JC_EXPORT "Journal Caisse Fevrier 2025/CAISSE-Prlv Fevrier 2025.csv"
+#define JC_ANCHOR "jc.csv"
+
+// One month, timed stage by stage; returns its days, -1 on failure
+static int jc_convert(const BenchConfig *config, BenchStage *read, BenchStage *convert, JournalWriter *output,
+                      long long *bytes) {
+    char path[1024], name[256];
+    size_t len;
+
+    snprintf(path, sizeof(path), "%s/%s", config->assets, JC_EXPORT);
+    double t0 = bench_now();
+    char *data = bench_read_file(path, &len);
+    if (!data)
+        return -1;
+    double t1 = bench_now();
+    int days = convert_cash_withdrawals(data, len, output, name, sizeof(name));
+    jwriter_flush(output);
+    double t2 = bench_now();
+    free(data);
+    if (days <= 0)
+        return -1;
+
+    bench_sample(read, t1 - t0, days);
+    bench_sample(convert, t2 - t1, days);
+    *bytes += (long long)len;
+    return days;
+}
+
+int bench_jc_anchor(const BenchConfig *config, char *message, size_t size) {
+    JournalWriter output;
+    BenchRun run;
+    long long bytes = 0;
+    size_t len;
+    char *journal = NULL;
+
+    memset(&run, 0, sizeof(run));
+    BenchStage *read = bench_stage(&run, "read", 1);
+    BenchStage *convert = bench_stage(&run, "convert", 1);
+    int ok = jwriter_init(&output, -1, JOURNAL_LAYOUT_LIBELLE_CPTE);
+    if (ok) {
+        ok = jc_convert(config, read, convert, &output, &bytes) > 0;
+        journal = ok ? jwriter_take(&output, &len) : NULL;
+        if (!ok)
+            jwriter_close(&output);
+    }
+    ok = journal && bench_check_anchor(config, JC_ANCHOR, journal, len, message, size);
+    if (!journal)
+        snprintf(message, size, "conversion failed");
+    free(journal);
+    bench_run_free(&run);
+    return ok;
+}
+
+int bench_jc(const BenchConfig *config, long long records, BenchRun *run) {
+    JournalWriter output;
+    int out_fd = open("/dev/null", O_WRONLY);
+    BenchStage *read = bench_stage(run, "read", (size_t)(records / 28 + 1));
+    BenchStage *convert = bench_stage(run, "convert", (size_t)(records / 28 + 1));
+    int ok = out_fd >= 0;
+
+    while (ok && run->records < records) {
+        if (!jwriter_init(&output, out_fd, JOURNAL_LAYOUT_LIBELLE_CPTE)) {
+            ok = 0;
+            break;
+        }
+        int days = jc_convert(config, read, convert, &output, &run->bytes);
+        ok = jwriter_close(&output) && days > 0;
+        if (ok)
+            run->records += days;
+    }
+    if (out_fd >= 0) close(out_fd);
+    return ok;
+}
@@ -0,0 +1,147 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   bench_jv.c                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:03:46 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:37:05 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include "bench.h"
+#include "../process_JV/process.h"
+
+// JV stages, per month: reading the two exports and converting them, since
+// generate_sales_journal parses, joins and writes each sales day in one pass.
+// Larger runs convert the February 2025 exports month after month until they
+// reach the requested number of days.
+
+#define JV_SALES "Journal Vente Fevrier 2025/CAISSE-CA Fevrier 2025.csv"
+#define JV_PAYMENTS "Journal Vente Fevrier 2025/CAISSE-Reglement Fevrier 2025.csv"
+#define JV_ANCHOR "jv.csv"
+
+typedef struct {
+    BenchStage *read;
+    BenchStage *convert;
+} JvMonth;
+
+// One month, timed stage by stage; returns its days, -1 on failure
+static int jv_convert(const BenchConfig *config, JvMonth *month, JournalWriter *output, long long *bytes) {
+    char sales_path[1024], payments_path[1024];
+    size_t sales_len, payments_len;
+
+    snprintf(sales_path, sizeof(sales_path), "%s/%s", config->assets, JV_SALES);
+    snprintf(payments_path, sizeof(payments_path), "%s/%s", config->assets, JV_PAYMENTS);
+    double t0 = bench_now();
+    char *sales = bench_read_file(sales_path, &sales_len);
+    char *payments = sales ? bench_read_file(payments_path, &payments_len) : NULL;
+    if (!payments) {
+        free(sales);
+        return -1;
+    }
+    double t1 = bench_now();
+    SalesStream stream;
+    sales_stream_init(&stream, sales, sales_len);
+    int count = generate_sales_journal(&stream, payments, payments_len, output);
+    jwriter_flush(output);
+    double t2 = bench_now();
+    free(sales);
+    free(payments);
+    if (count <= 0)
+        return -1;
+
+    bench_sample(month->read, t1 - t0, count);
+    bench_sample(month->convert, t2 - t1, count);
+    *bytes += (long long)(sales_len + payments_len);
+    return count;
+}
+
+static JvMonth *jv_month(BenchRun *run, size_t expected) {
+    JvMonth *month = malloc(sizeof(JvMonth));
+
+    if (!month)
+        return NULL;
+    month->read = bench_stage(run, "read", expected);
+    month->convert = bench_stage(run, "convert", expected);
+    return month;
+}
+
+// Days without payments are reported on stderr, once per month converted:
+// they go to /dev/null while the bench runs. Returns the saved stderr
+static int jv_silence(void) {
+    int null_fd = open("/dev/null", O_WRONLY);
+    int saved = null_fd >= 0 ? dup(STDERR_FILENO) : -1;
+
+    if (saved >= 0) {
+        fflush(stderr);
+        dup2(null_fd, STDERR_FILENO);
+    }
+    if (null_fd >= 0)
+        close(null_fd);
+    return saved;
+}
+
+static void jv_restore(int saved) {
+    if (saved >= 0) {
+        dup2(saved, STDERR_FILENO);
+        close(saved);
+    }
+}
+
+int bench_jv_anchor(const BenchConfig *config, char *message, size_t size) {
+    JournalWriter output;
+    BenchRun run;
+    long long bytes = 0;
+    size_t len;
+
+    memset(&run, 0, sizeof(run));
+    jv_verbose = 0;
+    JvMonth *month = jv_month(&run, 1);
+    int ok = month && jwriter_init(&output, -1, JOURNAL_LAYOUT_CPTE_LIBELLE);
+    char *journal = NULL;
+    if (ok) {
+        int saved = jv_silence();
+        ok = jv_convert(config, month, &output, &bytes) > 0;
+        jv_restore(saved);
+        journal = ok ? jwriter_take(&output, &len) : NULL;
+        if (!ok)
+            jwriter_close(&output);
+    }
+    ok = journal && bench_check_anchor(config, JV_ANCHOR, journal, len, message, size);
+    if (!journal)
+        snprintf(message, size, "conversion failed");
+    free(journal);
+    free(month);
+    bench_run_free(&run);
+    return ok;
+}
+
+int bench_jv(const BenchConfig *config, long long records, BenchRun *run) {
+    JournalWriter output;
+    int out_fd = open("/dev/null", O_WRONLY);
+    JvMonth *month = jv_month(run, (size_t)(records / 28 + 1));
+    int ok = out_fd >= 0 && month;
+
+    jv_verbose = 0;
+    if (ok) {
+        int saved = jv_silence();
+        while (ok && run->records < records) {
+            if (!jwriter_init(&output, out_fd, JOURNAL_LAYOUT_CPTE_LIBELLE)) {
+                ok = 0;
+                break;
+            }
+            int days = jv_convert(config, month, &output, &run->bytes);
+            ok = jwriter_close(&output) && days > 0;
+            if (ok)
+                run->records += days;
+        }
+        jv_restore(saved);
+    }
+    if (out_fd >= 0) close(out_fd);
+    free(month);
+    return ok;
+}
@@ -0,0 +1,207 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   bench_money.c                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:46:35 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:29:16 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "../common/money.h"
+
+// Amount parsing on its own: money_parse on the amounts as the exports write
+// them (grouped thousands, decimal comma, a trailing currency mark), on plain
+// dot-decimal text, and atof on the same plain text as the reference. A run
+// parses `records` amounts, cycling over a pool of generated ones; samples
+// are the latency per amount of each batch.
+
+#define MONEY_POOL 65536
+#define MONEY_BATCH 1024
+
+// Texts of the exports and the cents they hold
+static const struct {
+    const char *text;
+    Money cents;
+} money_cases[] = {
+    {"18 387,09", 1838709},
+    {"44,05E", 4405},
+    {"1\xC2\xA0" "234,50", 123450},
+    {"12\xE2\x80\xAF" "345\xE2\x80\xAF" "678,9", 1234567890},
+    {"-1 234,56", -123456},
+    {"\"0,00\"", 0},
+    {"1234.567", 123457},
+    {"-0,005", -1},
+    {"Solde : 99,99 EUR", 9999},
+    {"A-B 12,00", 1200},
+    {"- 7,00", -700},
+    {"123456789012", 12345678901200},
+    {"", 0},
+};
+
+// Pool of amounts written both ways, NUL-terminated one after the other
+typedef struct {
+    char *french;
+    char *plain;
+    size_t french_offsets[MONEY_POOL];
+    size_t plain_offsets[MONEY_POOL];
+    Money cents[MONEY_POOL];
+    long long plain_bytes;
+} MoneyPool;
+
+// "12 345 678,90E" with the group separator of the export
+static size_t write_french(Money cents, const char *group, char *out) {
+    char digits[24];
+    size_t len = 0;
+    Money units = money_abs(cents) / 100;
+    int count = snprintf(digits, sizeof(digits), "%lld", (long long)units);
+
+    if (cents < 0)
+        out[len++] = '-';
+    for (int i = 0; i < count; i++) {
+        if (i > 0 && (count - i) % 3 == 0) {
+            memcpy(out + len, group, strlen(group));
+            len += strlen(group);
+        }
+        out[len++] = digits[i];
+    }
+    len += (size_t)sprintf(out + len, ",%02lldE", (long long)(money_abs(cents) % 100));
+    return len;
+}
+
+static MoneyPool *money_pool(void) {
+    static const char *groups[] = {" ", "\xC2\xA0", "\xE2\x80\xAF", ""};
+    MoneyPool *pool = malloc(sizeof(*pool));
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    size_t french_len = 0, plain_len = 0;
+
+    if (!pool)
+        return NULL;
+    pool->french = malloc(MONEY_POOL * 32);
+    pool->plain = malloc(MONEY_POOL * 24);
+    pool->plain_bytes = 0;
+    if (!pool->french || !pool->plain) {
+        free(pool->french);
+        free(pool->plain);
+        free(pool);
+        return NULL;
+    }
+    for (int i = 0; i < MONEY_POOL; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        // Mostly small amounts, some up to the millions, one in ten negative
+        Money cents = (Money)(seed % (seed % 4 == 0 ? 1000000000 : 100000));
+        if (seed % 10 == 0)
+            cents = -cents;
+        pool->cents[i] = cents;
+        pool->french_offsets[i] = french_len;
+        french_len += write_french(cents, groups[(seed >> 32) % 4], pool->french + french_len) + 1;
+        pool->french[french_len - 1] = '\0';
+        pool->plain_offsets[i] = plain_len;
+        plain_len += (size_t)sprintf(pool->plain + plain_len, "%s%lld.%02lld", MONEY_PRINTF_ARGS(cents)) + 1;
+    }
+    pool->plain_bytes = (long long)plain_len;
+    return pool;
+}
+
+static void money_pool_free(MoneyPool *pool) {
+    free(pool->french);
+    free(pool->plain);
+    free(pool);
+}
+
+int bench_money_anchor(const BenchConfig *config, char *message, size_t size) {
+    (void)config;
+    for (size_t i = 0; i < sizeof(money_cases) / sizeof(money_cases[0]); i++) {
+        Money cents;
+        money_parse(money_cases[i].text, strlen(money_cases[i].text), &cents);
+        if (cents != money_cases[i].cents) {
+            snprintf(message, size, "\"%s\" parsed as %lld cents, expected %lld", money_cases[i].text,
+                     (long long)cents, (long long)money_cases[i].cents);
+            return 0;
+        }
+    }
+
+    // Both spellings of every generated amount, and atof agreeing with them
+    MoneyPool *pool = money_pool();
+    if (!pool) {
+        snprintf(message, size, "out of memory");
+        return 0;
+    }
+    int ok = 1;
+    for (int i = 0; i < MONEY_POOL && ok; i++) {
+        const char *french = pool->french + pool->french_offsets[i];
+        const char *plain = pool->plain + pool->plain_offsets[i];
+        Money from_french, from_plain;
+        money_parse(french, strlen(french), &from_french);
+        money_parse(plain, strlen(plain), &from_plain);
+        double value = atof(plain) * 100.0;
+        Money from_atof = (Money)(value < 0 ? value - 0.5 : value + 0.5);
+        if (from_french != pool->cents[i] || from_plain != pool->cents[i] || from_atof != pool->cents[i]) {
+            snprintf(message, size, "\"%s\" / \"%s\" parsed as %lld / %lld / %lld cents, expected %lld", french,
+                     plain, (long long)from_french, (long long)from_plain, (long long)from_atof,
+                     (long long)pool->cents[i]);
+            ok = 0;
+        }
+    }
+    money_pool_free(pool);
+    return ok;
+}
+
+// One stage: `records` amounts of `text` in batches, the sum kept so the
+// parsing is not optimized away
+static Money money_stage(BenchStage *stage, const char *text, const size_t *offsets, int use_atof,
+                         long long records) {
+    Money sum = 0;
+    double atof_sum = 0;
+
+    for (long long done = 0; done < records;) {
+        long long batch = records - done < MONEY_BATCH ? records - done : MONEY_BATCH;
+        double t0 = bench_now();
+        for (long long i = 0; i < batch; i++) {
+            const char *s = text + offsets[(done + i) % MONEY_POOL];
+            if (use_atof) {
+                atof_sum += atof(s);
+            } else {
+                Money cents;
+                money_parse(s, strlen(s), &cents);
+                sum += cents;
+            }
+        }
+        bench_sample(stage, bench_now() - t0, batch);
+        done += batch;
+    }
+    return use_atof ? (Money)atof_sum : sum;
+}
+
+int bench_money(const BenchConfig *config, long long records, BenchRun *run) {
+    size_t batches = (size_t)((records + MONEY_BATCH - 1) / MONEY_BATCH);
+    volatile Money sink;
+
+    (void)config;
+    MoneyPool *pool = money_pool();
+    if (!pool)
+        return 0;
+    BenchStage *french = bench_stage(run, "french", batches);
+    BenchStage *plain = bench_stage(run, "plain", batches);
+    BenchStage *reference = bench_stage(run, "atof", batches);
+
+    sink = money_stage(french, pool->french, pool->french_offsets, 0, records);
+    sink = money_stage(plain, pool->plain, pool->plain_offsets, 0, records);
+    sink = money_stage(reference, pool->plain, pool->plain_offsets, 1, records);
+    (void)sink;
+
+    // Bytes of the plain text parsed, so MB/s compares the three stages
+    run->records = records;
+    run->bytes = pool->plain_bytes * (records / MONEY_POOL) +
+                 (long long)pool->plain_offsets[records % MONEY_POOL];
+    money_pool_free(pool);
+    return 1;
+}
@@ -0,0 +1,849 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   gen.c                                              :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:08:23 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:08:23 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Synthetic inputs for scale tests, in the layouts of the February 2025
+// exports: the SG bank statement (header block, "";"..." continuation lines),
+// the POS sales export CAISSE-CA (M/D/YY dates, multi-line TVA cells, footer
+// of totals), its 15-column CAISSE-Reglement and the CAISSE-Prlv withdrawals.
+// Each month goes to its own folder, named like the assets:
+//   Journal Banque Fevrier 2025/BQ-Releve bancaire fevrier 2025.csv
+//   Journal Vente Fevrier 2025/CAISSE-CA Fevrier 2025.csv, CAISSE-Reglement ...
+//   Journal Caisse Fevrier 2025/CAISSE-Prlv Fevrier 2025.csv
+// The output only depends on the seed and the options: every month draws
+// from its own streams, one for the shop's days (shared by the three POS
+// exports, which stay consistent with each other), one for the bank and one
+// per file for its malformed lines.
+
+#define GEN_PATH_SIZE 1024
+#define GEN_MAX_DAYS 31
+#define GEN_BUFFER_SIZE (1 << 20)
+
+typedef enum {
+    OP_REMISE,          // card takings of the day, with the BT/COM line
+    OP_CARTE,           // card payment to a merchant
+    OP_PRELEVEMENT,     // direct debit, with DE/ID/MOTIF lines
+    OP_VIREMENT,        // transfer sent, with POUR/REF/REMISE/MOTIF lines
+    OP_VERSEMENT,       // cash deposit at an ATM
+    OP_VIR_RECU,        // transfer received
+    OP_FRAIS,           // bank fees and subscriptions
+    OP_KIND_COUNT
+} OperationKind;
+
+static const char *operation_kind_names[OP_KIND_COUNT] = {
+    "remise", "carte", "prelevement", "virement", "versement", "vir_recu", "frais",
+};
+
+// Mix of the February statement
+static const int default_weights[OP_KIND_COUNT] = {44, 20, 12, 6, 2, 1, 3};
+
+typedef struct {
+    uint64_t seed;
+    const char *out_dir;
+    int month;                      // first month, 1-12
+    int year;
+    int months;
+    long long operations;           // per bank statement
+    int weights[OP_KIND_COUNT];
+    int unknown_ppm;                // merchants and creditors missing from the rules
+    int malformed_ppm;              // lines replaced by a malformed one
+    int tools;                      // GEN_JB | GEN_JV | GEN_JC
+} GenConfig;
+
+#define GEN_JB 1
+#define GEN_JV 2
+#define GEN_JC 4
+
+// splitmix64: small, fast and the same on every platform
+typedef struct {
+    uint64_t state;
+} GenRandom;
+
+static void gen_seed(GenRandom *r, uint64_t seed, int month_index, int stream) {
+    r->state = seed * 0x9e3779b97f4a7c15ull ^ ((uint64_t)month_index << 8 | (uint64_t)stream);
+}
+
+static uint64_t gen_next(GenRandom *r) {
+    uint64_t z = (r->state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [lo, hi]
+static long long gen_range(GenRandom *r, long long lo, long long hi) {
+    return lo + (long long)(gen_next(r) % (uint64_t)(hi - lo + 1));
+}
+
+static int gen_ppm(GenRandom *r, int ppm) {
+    return ppm > 0 && (int)(gen_next(r) % 1000000) < ppm;
+}
+
+static const char *gen_pick(GenRandom *r, const char *const *list, int count) {
+    return list[gen_next(r) % (uint64_t)count];
+}
+
+#define GEN_PICK(r, list) gen_pick(r, list, (int)(sizeof(list) / sizeof(list[0])))
+
+// -------------------------------------------------------------------------
+// Calendar and number formats
+
+static const char *month_names[12] = {
+    "Janvier", "Fevrier", "Mars", "Avril", "Mai", "Juin",
+    "Juillet", "Aout", "Septembre", "Octobre", "Novembre", "Decembre",
+};
+
+static const char *month_abbrevs[12] = {
+    "JANV", "FEV", "MARS", "AVR", "MAI", "JUIN", "JUIL", "AOUT", "SEPT", "OCT", "NOV", "DEC",
+};
+
+static int days_in_month(int month, int year) {
+    static const int days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return days[month - 1] + (month == 2 && leap);
+}
+
+// 0 = Sunday
+static int day_of_week(int day, int month, int year) {
+    static const int t[12] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
+    if (month < 3)
+        year--;
+    return (year + year / 4 - year / 100 + year / 400 + t[month - 1] + day) % 7;
+}
+
+// Cents as text: the decimal separator, and the thousands separator if any
+// ("2 532,00" in the statement, "4 170.12" in the CA totals, a narrow
+// no-break space in the réglement totals)
+static char *format_cents(char *out, size_t size, long long cents, char decimal, const char *thousands) {
+    char digits[32];
+    int len = snprintf(digits, sizeof(digits), "%lld", (cents < 0 ? -cents : cents) / 100);
+    size_t pos = 0;
+
+    if (cents < 0 && pos + 1 < size)
+        out[pos++] = '-';
+    for (int i = 0; i < len; i++) {
+        if (thousands && i > 0 && (len - i) % 3 == 0) {
+            for (const char *t = thousands; *t && pos + 1 < size; t++)
+                out[pos++] = *t;
+        }
+        if (pos + 1 < size)
+            out[pos++] = digits[i];
+    }
+    snprintf(out + pos, size - pos, "%c%02lld", decimal, (cents < 0 ? -cents : cents) % 100);
+    return out;
+}
+
+// -------------------------------------------------------------------------
+// Output files
+
+static int make_dir(const char *path) {
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+static FILE *open_output(const GenConfig *config, const char *folder, const char *name, char *path) {
+    char dir[GEN_PATH_SIZE];
+
+    if (snprintf(dir, GEN_PATH_SIZE, "%s/%s", config->out_dir, folder) >= GEN_PATH_SIZE ||
+        snprintf(path, GEN_PATH_SIZE, "%s/%s", dir, name) >= GEN_PATH_SIZE) {
+        fprintf(stderr, "Error: Output path too long: %s\n", config->out_dir);
+        return NULL;
+    }
+    if (!make_dir(config->out_dir) || !make_dir(dir)) {
+        fprintf(stderr, "Error: Could not create %s\n", dir);
+        return NULL;
+    }
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Error: Could not create %s\n", path);
+        return NULL;
+    }
+    setvbuf(file, NULL, _IOFBF, GEN_BUFFER_SIZE);
+    return file;
+}
+
+static int close_output(FILE *file, const char *path, long long records, const char *unit) {
+    long bytes = ftell(file);
+
+    if (ferror(file) | (fclose(file) != 0)) {
+        fprintf(stderr, "Error: Could not write %s\n", path);
+        return 0;
+    }
+    printf("Wrote %s: %lld %s, %ld bytes\n", path, records, unit, bytes);
+    return 1;
+}
+
+// -------------------------------------------------------------------------
+// Bank statement
+
+typedef struct {
+    const char *name;
+    int web;                        // followed by COMMERCE ELECTRONIQUE
+} Merchant;
+
+static const Merchant merchants[] = {
+    {"BUREAU VALLEE", 0}, {"L ORANAISE", 0}, {"AMAZON PAYMENTS", 1},
+    {"ADEO*LEROY MERLIN", 0}, {"AVERY FRANCE", 1}, {"ORANGE FACT DM", 1},
+};
+
+typedef struct {
+    const char *name;
+    const char *id;
+    const char *extra;              // last continuation line, if any
+} Creditor;
+
+static const Creditor creditors[] = {
+    {"CEP TRESO SANTE PREV", "FR94ZZZ628721", "2825  03342970001/0942000000311485A"},
+    {"AXA", "FR14ZZZ391832", NULL},
+    {"URSSAF DE LANGUEDOC ROUSSILLON", "FR53ZZZ108278", NULL},
+    {"HAXE DIRECT", "FR33ZZZ609255", NULL},
+    {"GC RE HOKODO", "DE5644300002197951", NULL},
+    {"IONOS SARL", "FR70ZZZ614312", NULL},
+    {"METAC", "FR29ZZZ88EEE1", NULL},
+};
+
+static const char *payees[] = {
+    "FREJAVILLE Carla", "SCOP EPICE", "COMPAGNIE DU BICARBONATE", "ECODIS", "SCI JC",
+};
+
+static const char *agencies[] = {
+    "SG MONTPELLIER COMEDIE  ", "SG MONTPELLIER ANTIGONE ", "SG NIMES FEUCHERES      ",
+    "SG PERPIGNAN CASTILLET  ", "SG SETE CANAL           ",
+};
+
+static const char *shops[] = {
+    "LES COUSINES", "EPICERIE DU MARCHE", "LA BONNE GRAINE", "AU PANIER VRAC", "LE GARDE-MANGER",
+};
+
+static const char *atms[] = {"MONTPELLIER ESPACE P", "ELS MONTPELLIER ST D", "MONTPELLIER GAMBETTA"};
+
+static const char *first_names[] = {"ANNE-SOPHIE", "JULIEN", "MARIE", "KARIM", "LUCIE", "THOMAS"};
+static const char *last_names[] = {"FAURE", "MARTIN", "ROUX", "BENALI", "GARCIA", "LEROUX"};
+
+// Syllables of unknown names: two per word cannot spell any keyword of the rules
+static const char *syllables[] = {
+    "BE", "LU", "MI", "TRA", "VEN", "DOL", "PRI", "SU", "KE", "NO",
+    "RI", "BU", "FE", "LI", "TO", "ZE", "GU", "PA", "CO", "DI",
+};
+
+static const char *company_forms[] = {"", " SARL", " SAS", " SA", " ET FILS"};
+
+static void unknown_name(GenRandom *r, char *out, size_t size) {
+    snprintf(out, size, "%s%s %s%s%s", GEN_PICK(r, syllables), GEN_PICK(r, syllables),
+             GEN_PICK(r, syllables), GEN_PICK(r, syllables), GEN_PICK(r, company_forms));
+}
+
+typedef struct {
+    FILE *file;
+    GenRandom *random;
+    const GenConfig *config;
+    int month;
+    int year;
+} Statement;
+
+// "";"text";"";"";"";"";""
+static void continuation(Statement *s, const char *text) {
+    fprintf(s->file, "\"\";\"%s\";\"\";\"\";\"\";\"\";\"\"\n", text);
+}
+
+// The first line of an operation, or one of the malformed lines found in
+// hand-edited or truncated exports
+static void operation_line(Statement *s, int day, int value_day, const char *nature, long long cents,
+                           const char *interbank) {
+    char amount[32], date[16], value_date[16];
+
+    format_cents(amount, sizeof(amount), cents, ',', " ");
+    snprintf(date, sizeof(date), "%02d/%02d/%04d", day, s->month, s->year);
+    snprintf(value_date, sizeof(value_date), "%02d/%02d/%04d", value_day, s->month, s->year);
+    if (gen_ppm(s->random, s->config->malformed_ppm)) {
+        switch (gen_next(s->random) % 5) {
+        case 0:         // truncated after the amount
+            fprintf(s->file, "\"%s\";\"%s\";\"%s\"\n", date, nature, cents < 0 ? amount : "");
+            return;
+        case 1:         // not a date
+            memcpy(date, "32/13", 5);
+            break;
+        case 2:         // not an amount
+            snprintf(amount, sizeof(amount), "%s%lldO,0O", cents < 0 ? "-" : "", (cents < 0 ? -cents : cents) / 100);
+            break;
+        case 3:
+            fputc('\n', s->file);
+            return;
+        default:        // separators only
+            fputs(";;;;;;\n", s->file);
+            return;
+        }
+    }
+    fprintf(s->file, "\"%s\";\"%s\";\"%s\";\"%s\";\"EUR\";\"%s\";\"%s\"\n", date, nature,
+            cents < 0 ? amount : "", cents < 0 ? "" : amount, value_date, interbank);
+}
+
+static void write_remise(Statement *s, int day, int sales_day, int sales_month) {
+    GenRandom *r = s->random;
+    long long gross = gen_range(r, 500, 60000);
+    long long fee = gross * 35 / 10000 > 0 ? gross * 35 / 10000 : 1;
+    char nature[80], line[80], bt[32], com[32];
+
+    snprintf(nature, sizeof(nature), "REMISE CB /%02d/%02d R%05lld CT39302385%02lld", sales_day, sales_month,
+             gen_range(r, 0, 99999), gen_range(r, 1, 2));
+    operation_line(s, day, day, nature, gross - fee, "FACTURES CARTES REMISES");
+    format_cents(bt, sizeof(bt), gross, ',', NULL);
+    format_cents(com, sizeof(com), fee, ',', NULL);
+    snprintf(line, sizeof(line), "BT%13sE COM%9sE", bt, com);
+    continuation(s, line);
+}
+
+static void write_carte(Statement *s, int day, int spent_day) {
+    GenRandom *r = s->random;
+    char nature[96], name[64], line[64];
+    long long cents;
+
+    if (gen_ppm(r, s->config->unknown_ppm)) {
+        unknown_name(r, name, sizeof(name));
+        snprintf(nature, sizeof(nature), "CARTE X0067 %02d/%02d %s", spent_day, s->month, name);
+        operation_line(s, day, day, nature, -gen_range(r, 100, 40000), "FACTURES CARTES PAYEES");
+        if (gen_range(r, 0, 2) == 0)
+            continuation(s, "COMMERCE ELECTRONIQUE");
+        return;
+    }
+    // Ads are the most frequent card payment, a few euros billed from Ireland
+    int merchant = (int)gen_range(r, -3, (long long)(sizeof(merchants) / sizeof(merchants[0])) - 1);
+    if (merchant < 0) {
+        static const char code[] = "ABCDEFGHJKLMNPQRSTUVWXYZ0123456789";
+        char ref[11];
+        for (int i = 0; i < 10; i++)
+            ref[i] = code[gen_next(r) % (sizeof(code) - 1)];
+        ref[10] = '\0';
+        cents = gen_range(r, 1, 9) * 100;
+        snprintf(nature, sizeof(nature), "CARTE X0067 %02d/%02d FACEBK *%s", spent_day, s->month, ref);
+        operation_line(s, day, day, nature, -cents, "FACTURES CARTES PAYEES");
+        snprintf(line, sizeof(line), "%lld,00 EUR IRLANDE", cents / 100);
+        continuation(s, line);
+        continuation(s, "COMMERCE ELECTRONIQUE");
+        return;
+    }
+    snprintf(nature, sizeof(nature), "CARTE X0067 %02d/%02d %s", spent_day, s->month, merchants[merchant].name);
+    operation_line(s, day, day, nature, -gen_range(r, 100, 25000), "FACTURES CARTES PAYEES");
+    if (merchants[merchant].web)
+        continuation(s, "COMMERCE ELECTRONIQUE");
+}
+
+static void write_prelevement(Statement *s, int day) {
+    GenRandom *r = s->random;
+    char nature[64], line[128], name[64], id[32];
+    const Creditor *creditor = NULL;
+
+    snprintf(nature, sizeof(nature), "PRELEVEMENT EUROPEEN %010lld", gen_range(r, 1000000000, 9999999999));
+    operation_line(s, day, day, nature, -gen_range(r, 100, 300000), "PRELEVEMENTS EUROPEENS EMIS");
+    if (gen_ppm(r, s->config->unknown_ppm)) {
+        unknown_name(r, name, sizeof(name));
+        snprintf(id, sizeof(id), "FR%02lldZZZ%06lld", gen_range(r, 10, 99), gen_range(r, 0, 999999));
+    } else {
+        creditor = &creditors[gen_next(r) % (sizeof(creditors) / sizeof(creditors[0]))];
+        snprintf(name, sizeof(name), "%s", creditor->name);
+        snprintf(id, sizeof(id), "%s", creditor->id);
+    }
+    snprintf(line, sizeof(line), "DE: %s", name);
+    continuation(s, line);
+    snprintf(line, sizeof(line), "ID: %s", id);
+    continuation(s, line);
+    if (creditor && strncmp(name, "URSSAF", 6) == 0) {
+        // Contributions of the month or of the one before
+        int month = gen_range(r, 0, 1) ? s->month : (s->month + 10) % 12 + 1;
+        snprintf(line, sizeof(line), "MOTIF: UR 9170000012%08lld    %s%02d%04lld", gen_range(r, 0, 99999999),
+                 month_abbrevs[month - 1], s->year % 100, gen_range(r, 0, 9999));
+    } else {
+        snprintf(line, sizeof(line), "MOTIF: %s/%08lld", name, gen_range(r, 0, 99999999));
+    }
+    continuation(s, line);
+    if (creditor && creditor->extra)
+        continuation(s, creditor->extra);
+}
+
+static void write_virement(Statement *s, int day) {
+    GenRandom *r = s->random;
+    char name[64], motif[96], line[128];
+    int previous = (s->month + 10) % 12 + 1;
+
+    if (gen_ppm(r, s->config->unknown_ppm)) {
+        unknown_name(r, name, sizeof(name));
+        snprintf(motif, sizeof(motif), "Facture %06lld", gen_range(r, 0, 999999));
+    } else {
+        snprintf(name, sizeof(name), "%s", GEN_PICK(r, payees));
+        if (strcmp(name, "FREJAVILLE Carla") == 0)
+            snprintf(motif, sizeof(motif), "Salaire %s %d", month_names[previous - 1],
+                     previous == 12 ? s->year - 1 : s->year);
+        else if (strcmp(name, "SCI JC") == 0)
+            snprintf(motif, sizeof(motif), "Loyer %s %d", month_names[s->month - 1], s->year);
+        else
+            snprintf(motif, sizeof(motif), "%s - FV%05lld", name, gen_range(r, 0, 99999));
+    }
+    operation_line(s, day, day, "000001 VIR EUROPEEN EMIS   NET", -gen_range(r, 5000, 250000),
+                   "AUTRES VIREMENTS EMIS");
+    snprintf(line, sizeof(line), "POUR: %s", name);
+    continuation(s, line);
+    snprintf(line, sizeof(line), "REF: 95%011lld", gen_range(r, 0, 99999999999));
+    continuation(s, line);
+    snprintf(line, sizeof(line), "REMISE: %s", motif);
+    continuation(s, line);
+    snprintf(line, sizeof(line), "MOTIF: %s", motif);
+    continuation(s, line);
+}
+
+static void write_versement(Statement *s, int day) {
+    GenRandom *r = s->random;
+    char nature[64], line[64];
+
+    snprintf(nature, sizeof(nature), "VRST GAB %02d/%02d/%02d %02lldH%02lld %06lld", day, s->month, s->year % 100,
+             gen_range(r, 8, 19), gen_range(r, 0, 59), gen_range(r, 0, 999));
+    operation_line(s, day, day, nature, gen_range(r, 20, 120) * 1000, "VERSEMENTS ESPECES");
+    snprintf(line, sizeof(line), "%s %08lld", GEN_PICK(r, atms), gen_range(r, 913000, 916000));
+    continuation(s, line);
+    snprintf(line, sizeof(line), "%s %s", GEN_PICK(r, first_names), GEN_PICK(r, last_names));
+    continuation(s, line);
+    continuation(s, "CARTE XXXXXX975078006X");
+}
+
+static void write_vir_recu(Statement *s, int day) {
+    GenRandom *r = s->random;
+    char nature[64], line[96], name[64];
+
+    if (gen_ppm(r, s->config->unknown_ppm))
+        unknown_name(r, name, sizeof(name));
+    else
+        snprintf(name, sizeof(name), "SIE MOSSON");
+    snprintf(nature, sizeof(nature), "VIR RECU    %010lldS", gen_range(r, 0, 9999999999));
+    operation_line(s, day, day, nature, gen_range(r, 1000, 300000), "AUTRES VIREMENTS RECUS");
+    snprintf(line, sizeof(line), "DE: %s", name);
+    continuation(s, line);
+    snprintf(line, sizeof(line), "MOTIF: REMB. DGFiP - %09lld", gen_range(r, 0, 999999999));
+    continuation(s, line);
+    snprintf(line, sizeof(line), "REF: %09lldGAA%03lld-%d", gen_range(r, 0, 999999999), gen_range(r, 0, 999),
+             s->year);
+    continuation(s, line);
+}
+
+static void write_frais(Statement *s, int day) {
+    GenRandom *r = s->random;
+    char nature[80], line[64], amount[32];
+    int value_day = day > 1 ? day - 1 : day;
+
+    switch (gen_next(r) % 3) {
+    case 0:
+        snprintf(nature, sizeof(nature), "COMMISSION RELEVE NO 00479510  AU %02d/%02d.", value_day, s->month);
+        operation_line(s, day, value_day, nature, -gen_range(r, 5, 40) * 100, "COMMISSIONS ET FRAIS DIVERS");
+        continuation(s, "LCR NON/AV");
+        break;
+    case 1:
+        snprintf(nature, sizeof(nature), "COM REL LCR RELEVE N00479510 AU %02d/%02d/%04d", value_day, s->month,
+                 s->year);
+        operation_line(s, day, value_day, nature, -gen_range(r, 5, 40) * 100, "COMMISSIONS ET FRAIS DIVERS");
+        break;
+    default: {
+        // Not taxed, taxed and VAT parts of a subscription
+        long long nt = gen_range(r, 1000, 4000);
+        long long ht = gen_range(r, 500, 2000);
+        long long tva = ht / 5;
+        operation_line(s, day, value_day, "COTISATION MENSUELLE JAZZ PRO", -(nt + ht + tva),
+                       "COMMISSIONS ET FRAIS DIVERS");
+        snprintf(line, sizeof(line), "MONTANT NT  :%9s EUR", format_cents(amount, sizeof(amount), nt, ',', NULL));
+        continuation(s, line);
+        snprintf(line, sizeof(line), "MONTANT HT  :%9s EUR", format_cents(amount, sizeof(amount), ht, ',', NULL));
+        continuation(s, line);
+        snprintf(line, sizeof(line), "TVA A 20,00%%:%9s EUR", format_cents(amount, sizeof(amount), tva, ',', NULL));
+        continuation(s, line);
+    }
+    }
+}
+
+static OperationKind pick_kind(GenRandom *r, const int *weights, int total) {
+    int n = (int)(gen_next(r) % (uint64_t)total);
+    int kind = 0;
+
+    while (n >= weights[kind])
+        n -= weights[kind++];
+    return (OperationKind)kind;
+}
+
+// Operations spread over the weekdays of the month, in date order
+static int write_statement(const GenConfig *config, int month, int year, int month_index) {
+    char folder[128], name[128], path[GEN_PATH_SIZE], balance[32];
+    char lower[16];
+    int weekdays[GEN_MAX_DAYS];
+    int weekday_count = 0;
+    int total = 0;
+    GenRandom r;
+    Statement s;
+
+    gen_seed(&r, config->seed, month_index, 2);
+    for (int i = 0; i < OP_KIND_COUNT; i++)
+        total += config->weights[i];
+    for (int day = 1; day <= days_in_month(month, year); day++) {
+        int dow = day_of_week(day, month, year);
+        if (dow != 0 && dow != 6)
+            weekdays[weekday_count++] = day;
+    }
+    snprintf(lower, sizeof(lower), "%s", month_names[month - 1]);
+    for (char *p = lower; *p; p++)
+        *p = (char)tolower((unsigned char)*p);
+    snprintf(folder, sizeof(folder), "Journal Banque %s %d", month_names[month - 1], year);
+    snprintf(name, sizeof(name), "BQ-Releve bancaire %s %d.csv", lower, year);
+    FILE *file = open_output(config, folder, name, path);
+    if (!file)
+        return 0;
+
+    // SG header block: agency, IBAN and holder, account type, balance
+    fprintf(file, "\"%s\"\n", GEN_PICK(&r, agencies));
+    fprintf(file, "\"FR76 3000 %04lld %04lld %04lld %04lld %03lld\";\"%s\"\n", gen_range(&r, 0, 9999),
+            gen_range(&r, 0, 9999), gen_range(&r, 0, 9999), gen_range(&r, 0, 9999), gen_range(&r, 0, 999),
+            GEN_PICK(&r, shops));
+    fprintf(file, "\"CTE ENTR\"\n");
+    fprintf(file, "\"Solde au\";\"28/%02d/%04d\"\n", month % 12 + 1, month == 12 ? year + 1 : year);
+    fprintf(file, "\"Solde\";\"%s\";\"EUR\"\n\n",
+            format_cents(balance, sizeof(balance), gen_range(&r, -500000, 5000000), ',', " "));
+    fprintf(file, "Date;Nature de l'op\xc3\xa9ration;D\xc3\xa9" "bit;Cr\xc3\xa9" "dit;Devise;Date de valeur;"
+            "Libell\xc3\xa9 interbancaire\n");
+
+    s.file = file;
+    s.random = &r;
+    s.config = config;
+    s.month = month;
+    s.year = year;
+    for (long long i = 0; i < config->operations; i++) {
+        int day = weekdays[i * weekday_count / config->operations];
+        // Takings and card payments are booked one to three days later
+        int before = day > 3 ? day - (int)gen_range(&r, 1, 3) : 1;
+
+        switch (pick_kind(&r, config->weights, total)) {
+        case OP_REMISE: write_remise(&s, day, before, month); break;
+        case OP_CARTE: write_carte(&s, day, before); break;
+        case OP_PRELEVEMENT: write_prelevement(&s, day); break;
+        case OP_VIREMENT: write_virement(&s, day); break;
+        case OP_VERSEMENT: write_versement(&s, day); break;
+        case OP_VIR_RECU: write_vir_recu(&s, day); break;
+        default: write_frais(&s, day); break;
+        }
+    }
+    return close_output(file, path, config->operations, "operations");
+}
+
+// -------------------------------------------------------------------------
+// POS exports
+
+// One day of the shop; closed on Sundays, Mondays and a few other days
+typedef struct {
+    int open;
+    int zero_rate;                  // TVA 0.00% line in the cell
+    long long ht_5_5, tva_5_5, marge_5_5;
+    long long ht_20, tva_20, marge_20;
+    long long ttc, ht, marge;       // cents
+    long long especes, cartes;      // euros, as rounded by the POS
+    long long retrait;              // euros taken from the till, negative
+} ShopDay;
+
+static void draw_days(GenRandom *r, int month, int year, ShopDay *days) {
+    for (int d = 1; d <= days_in_month(month, year); d++) {
+        ShopDay *day = &days[d - 1];
+        int dow = day_of_week(d, month, year);
+
+        memset(day, 0, sizeof(*day));
+        day->open = dow != 0 && dow != 1 && gen_range(r, 0, 99) >= 3;
+        if (!day->open)
+            continue;
+        long long ttc = gen_range(r, 8000, 60000) * (dow == 6 ? 14 : 10) / 10;
+        long long ttc_5_5 = ttc * gen_range(r, 70, 92) / 100;
+        long long ttc_20 = ttc - ttc_5_5;
+        day->zero_rate = gen_range(r, 0, 19) == 0;
+        day->ht_5_5 = (ttc_5_5 * 1000 + 527) / 1055;
+        day->tva_5_5 = ttc_5_5 - day->ht_5_5;
+        day->ht_20 = (ttc_20 * 10 + 6) / 12;
+        day->tva_20 = ttc_20 - day->ht_20;
+        day->marge_5_5 = day->ht_5_5 * gen_range(r, 40, 52) / 100;
+        day->marge_20 = day->ht_20 * gen_range(r, 30, 45) / 100;
+        day->ttc = ttc;
+        day->ht = day->ht_5_5 + day->ht_20;
+        day->marge = day->marge_5_5 + day->marge_20;
+        day->especes = (ttc * gen_range(r, 10, 30) / 100 + 50) / 100;
+        day->cartes = (ttc + 50) / 100 - day->especes;
+        if (gen_range(r, 0, 99) < 85) {
+            long long taken = day->especes + gen_range(r, -20, 15);
+            day->retrait = taken > 0 ? -taken : 0;
+        }
+    }
+}
+
+// TVA: 5.50%  Montant:   22.73  HT:  413.28  TTC:  436.01     Marge:  198.46
+static void tva_line(FILE *file, const char *rate, long long tva, long long ht, long long marge) {
+    char a[32], b[32], c[32], d[32];
+
+    fprintf(file, "TVA:%s%%  Montant:%8s  HT:%8s  TTC:%8s     Marge:%8s   ", rate,
+            format_cents(a, sizeof(a), tva, '.', " "), format_cents(b, sizeof(b), ht, '.', " "),
+            format_cents(c, sizeof(c), ht + tva, '.', " "), format_cents(d, sizeof(d), marge, '.', " "));
+}
+
+static int write_sales(const GenConfig *config, int month, int year, const ShopDay *days, int month_index) {
+    char folder[128], name[128], path[GEN_PATH_SIZE];
+    char ttc[32], ht[32], marge[32];
+    int count = days_in_month(month, year);
+    long long ttc_5_5 = 0, ttc_20 = 0, ht_5_5 = 0, ht_20 = 0, marge_5_5 = 0, marge_20 = 0;
+
+    snprintf(folder, sizeof(folder), "Journal Vente %s %d", month_names[month - 1], year);
+    GenRandom r;
+
+    gen_seed(&r, config->seed, month_index, 3);
+    snprintf(name, sizeof(name), "CAISSE-CA %s %d.csv", month_names[month - 1], year);
+    FILE *file = open_output(config, folder, name, path);
+    if (!file)
+        return 0;
+    fprintf(file, "SITE(S) = 0, ;;;;%d/8/%02d\n", month % 12 + 1, (month == 12 ? year + 1 : year) % 100);
+    fprintf(file, "DEBUT = 01/%02d/%04d;;Journal des CA;CAISSE + BO;\n", month, year);
+    fprintf(file, ";;;FIN = %02d/%02d/%04d;\n", count, month, year);
+    fprintf(file, "Journal des CA;;;;\nDate;CA TTC;CA HT;Marge;\n");
+
+    for (int d = 1; d <= count; d++) {
+        const ShopDay *day = &days[d - 1];
+        format_cents(ttc, sizeof(ttc), day->ttc, ',', NULL);
+        format_cents(ht, sizeof(ht), day->ht, ',', NULL);
+        format_cents(marge, sizeof(marge), day->marge, ',', NULL);
+        if (gen_ppm(&r, config->malformed_ppm)) {
+            // Truncated row, or an amount that is not one
+            if (gen_range(&r, 0, 1))
+                fprintf(file, "%d/%d/%02d;%s\n", month, d, year % 100, ttc);
+            else
+                fprintf(file, "%d/%d/%02d;%sO;%s;%s;\n", month, d, year % 100, ttc, ht, marge);
+        } else {
+            fprintf(file, "%d/%d/%02d;%s;%s;%s;\n", month, d, year % 100, ttc, ht, marge);
+        }
+        if (!day->open)
+            continue;
+        fputc('"', file);
+        if (day->zero_rate) {
+            tva_line(file, " 0.00", 0, 0, 0);
+            fputc('\n', file);
+        }
+        tva_line(file, " 5.50", day->tva_5_5, day->ht_5_5, day->marge_5_5);
+        fputc('\n', file);
+        tva_line(file, "20.00", day->tva_20, day->ht_20, day->marge_20);
+        fputs("\";;;;\n", file);
+        ttc_5_5 += day->ht_5_5 + day->tva_5_5;
+        ttc_20 += day->ht_20 + day->tva_20;
+        ht_5_5 += day->ht_5_5;
+        ht_20 += day->ht_20;
+        marge_5_5 += day->marge_5_5;
+        marge_20 += day->marge_20;
+    }
+
+    // Totals per rate, one multi-line cell per column
+    const long long columns[3][3] = {
+        {ttc_5_5, ttc_20, ttc_5_5 + ttc_20}, {ht_5_5, ht_20, ht_5_5 + ht_20},
+        {marge_5_5, marge_20, marge_5_5 + marge_20},
+    };
+    const char *titles[3] = {"TTC", "HT", "Marge"};
+    fprintf(file, "\"TVA\n 0.00%%\n 5.50%%\n20.00%%\n\nTOTAUX\"");
+    for (int c = 0; c < 3; c++) {
+        char a[32], b[32], t[32];
+        fprintf(file, ";\"%s\n    0.00\n%8s\n%8s\n\n%8s\"", titles[c],
+                format_cents(a, sizeof(a), columns[c][0], '.', " "), format_cents(b, sizeof(b), columns[c][1], '.', " "),
+                format_cents(t, sizeof(t), columns[c][2], '.', " "));
+    }
+    fprintf(file, ";\nNombre de lignes :;;;;\n;;;;1/1");
+    return close_output(file, path, count, "days");
+}
+
+static int write_payments(const GenConfig *config, int month, int year, const ShopDay *days, int month_index) {
+    char folder[128], name[128], path[GEN_PATH_SIZE], total[32];
+    int count = days_in_month(month, year);
+    long long especes = 0, cartes = 0, ttc = 0;
+
+    snprintf(folder, sizeof(folder), "Journal Vente %s %d", month_names[month - 1], year);
+    GenRandom r;
+
+    gen_seed(&r, config->seed, month_index, 4);
+    snprintf(name, sizeof(name), "CAISSE-Reglement %s %d.csv", month_names[month - 1], year);
+    FILE *file = open_output(config, folder, name, path);
+    if (!file)
+        return 0;
+    fprintf(file, "SITE(S) = 0, ;;;;;;;;;;;;;;08/%02d/%04d\n", month % 12 + 1, month == 12 ? year + 1 : year);
+    fprintf(file, ";;;;;RECAPITULATIF REGLEMENTS;;;;;;;;;\n");
+    fprintf(file, "DEBUT = 01/%02d/%04d;;;;;;;;;;;;;FIN = %02d/%02d/%04d;\n", month, year, count, month, year);
+    fprintf(file, "RECAPITULATIF REGLEMENT;;;;;;;;;;;;;;\n");
+    fprintf(file, "Date;ESPECES;CHEQUES;CARTES;VIREMENT;KEETIZ;;;CREDIT;REGUL;;;;BON ACHAT;TOTAL\n");
+
+    for (int d = 1; d <= count; d++) {
+        const ShopDay *day = &days[d - 1];
+        format_cents(total, sizeof(total), day->ttc, ',', NULL);
+        if (gen_ppm(&r, config->malformed_ppm))      // a column short
+            fprintf(file, "%02d/%02d/%02d;%lld;0;%lld;0;0;0;0;0;0;0;0;0;%s\n", d, month, year % 100, day->especes,
+                    day->cartes, total);
+        else
+            fprintf(file, "%02d/%02d/%02d;%lld;0;%lld;0;0;0;0;0;0;0;0;0;0;%s\n", d, month, year % 100, day->especes,
+                    day->cartes, total);
+        especes += day->especes;
+        cartes += day->cartes;
+        ttc += day->ttc;
+    }
+    fprintf(file, ";%lld;0;%lld;0;0;0;0;0;0;0;0;0;0;%s\n", especes, cartes,
+            format_cents(total, sizeof(total), ttc, ',', "\xe2\x80\xaf"));
+    fprintf(file, "Nombre de lignes :;;%d;;;;;;;;;;;;\n;;;;;;;;;;;;;;1/1", count);
+    return close_output(file, path, count, "days");
+}
+
+static int write_withdrawals(const GenConfig *config, int month, int year, const ShopDay *days,
+                             int month_index) {
+    char folder[128], name[128], path[GEN_PATH_SIZE];
+    int count = days_in_month(month, year);
+    long long especes = 0, retraits = 0;
+
+    snprintf(folder, sizeof(folder), "Journal Caisse %s %d", month_names[month - 1], year);
+    GenRandom r;
+
+    gen_seed(&r, config->seed, month_index, 5);
+    snprintf(name, sizeof(name), "CAISSE-Prlv %s %d.csv", month_names[month - 1], year);
+    FILE *file = open_output(config, folder, name, path);
+    if (!file)
+        return 0;
+    fprintf(file, "SITE(S) = 0, ;;;;;08/%02d/%04d\n", month % 12 + 1, month == 12 ? year + 1 : year);
+    fprintf(file, ";;RECAPITULATIF ENCAISSEMENT;;;\n");
+    fprintf(file, "DEBUT = 01/%02d/%04d;;;;FIN = %02d/%02d/%04d;\n", month, year, count, month, year);
+    fprintf(file, "RECAPITULATIF ENCAISSEMENT;;;;;\nDATE;ENCAISSEMENT;APPORTS;SORTIES;RETRAITS;\n");
+
+    for (int d = 1; d <= count; d++) {
+        const ShopDay *day = &days[d - 1];
+        if (gen_ppm(&r, config->malformed_ppm))      // withdrawal that is not a number
+            fprintf(file, "%02d/%02d/%04d;%lld;0;0;%lldO;\n", d, month, year, day->especes, day->retrait);
+        else
+            fprintf(file, "%02d/%02d/%04d;%lld;0;0;%lld;\n", d, month, year, day->especes, day->retrait);
+        especes += day->especes;
+        retraits += day->retrait;
+    }
+    fprintf(file, ";%lld;0;0;%lld;\nNombre de lignes :;;;;;\n;;;;;1/1", especes, retraits);
+    return close_output(file, path, count, "days");
+}
+
+// -------------------------------------------------------------------------
+// Command line
+
+// Percentage with decimals ("0.5") in parts per million
+static int parse_ppm(const char *text, int *ppm) {
+    char *end;
+    double pct = strtod(text, &end);
+
+    if (end == text || *end || pct < 0 || pct > 100)
+        return 0;
+    *ppm = (int)(pct * 10000 + 0.5);
+    return 1;
+}
+
+// remise=40,carte=30,... ; the kinds not listed keep their weight
+static int parse_mix(const char *text, int *weights) {
+    const char *p = text;
+
+    while (*p) {
+        const char *eq = strchr(p, '=');
+        int kind = 0;
+        char *end;
+        if (!eq)
+            return 0;
+        while (kind < OP_KIND_COUNT && (strlen(operation_kind_names[kind]) != (size_t)(eq - p) ||
+                                        strncmp(operation_kind_names[kind], p, (size_t)(eq - p)) != 0))
+            kind++;
+        long weight = strtol(eq + 1, &end, 10);
+        if (kind == OP_KIND_COUNT || end == eq + 1 || weight < 0 || weight > 1000000)
+            return 0;
+        weights[kind] = (int)weight;
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',')
+            return 0;
+    }
+    return 1;
+}
+
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [-s seed] [-o dir] [-p MM/YYYY] [-m months] [-n operations]\n", program_name);
+    printf("       [--mix kind=weight,...] [--unknown pct] [--malformed pct] [--tool JB|JV|JC]\n");
+    printf("Writes a bank statement of n operations (default 100) and the POS exports of\n");
+    printf("each month from MM/YYYY (default 02/2025) into dir (default bench/data).\n");
+    printf("Operation kinds:");
+    for (int i = 0; i < OP_KIND_COUNT; i++)
+        printf(" %s=%d", operation_kind_names[i], default_weights[i]);
+    printf("\n--unknown: share of merchants, creditors and payees missing from the rules (default 10).\n");
+    printf("--malformed: share of lines replaced by a malformed one (default 0).\n");
+}
+
+int main(int argc, char *argv[]) {
+    GenConfig config = {
+        .seed = 1,
+        .out_dir = "bench/data",
+        .month = 2,
+        .year = 2025,
+        .months = 1,
+        .operations = 100,
+        .unknown_ppm = 100000,
+        .tools = GEN_JB | GEN_JV | GEN_JC,
+    };
+    int total = 0;
+
+    memcpy(config.weights, default_weights, sizeof(default_weights));
+    for (int i = 1; i < argc; i++) {
+        int ok = i + 1 < argc;
+        if (ok && strcmp(argv[i], "-s") == 0) config.seed = strtoull(argv[++i], NULL, 10);
+        else if (ok && strcmp(argv[i], "-o") == 0) config.out_dir = argv[++i];
+        else if (ok && strcmp(argv[i], "-p") == 0)
+            ok = sscanf(argv[++i], "%d/%d", &config.month, &config.year) == 2 && config.month >= 1 &&
+                 config.month <= 12 && config.year >= 1900;
+        else if (ok && strcmp(argv[i], "-m") == 0) ok = (config.months = atoi(argv[++i])) > 0;
+        else if (ok && strcmp(argv[i], "-n") == 0) ok = (config.operations = atoll(argv[++i])) > 0;
+        else if (ok && strcmp(argv[i], "--mix") == 0) ok = parse_mix(argv[++i], config.weights);
+        else if (ok && strcmp(argv[i], "--unknown") == 0) ok = parse_ppm(argv[++i], &config.unknown_ppm);
+        else if (ok && strcmp(argv[i], "--malformed") == 0) ok = parse_ppm(argv[++i], &config.malformed_ppm);
+        else if (ok && strcmp(argv[i], "--tool") == 0) {
+            const char *tool = argv[++i];
+            config.tools = strcmp(tool, "JB") == 0 ? GEN_JB : strcmp(tool, "JV") == 0 ? GEN_JV :
+                           strcmp(tool, "JC") == 0 ? GEN_JC : 0;
+            ok = config.tools != 0;
+        } else ok = 0;
+        if (!ok) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    for (int i = 0; i < OP_KIND_COUNT; i++)
+        total += config.weights[i];
+    if (total <= 0) {
+        fprintf(stderr, "Error: The operation mix has no weight\n");
+        return 1;
+    }
+
+    for (int m = 0; m < config.months; m++) {
+        int month = (config.month - 1 + m) % 12 + 1;
+        int year = config.year + (config.month - 1 + m) / 12;
+        ShopDay days[GEN_MAX_DAYS];
+        GenRandom pos;
+
+        gen_seed(&pos, config.seed, m, 1);
+        draw_days(&pos, month, year, days);
+        if ((config.tools & GEN_JB) && !write_statement(&config, month, year, m))
+            return 2;
+        if ((config.tools & GEN_JV) && (!write_sales(&config, month, year, days, m) ||
+                                        !write_payments(&config, month, year, days, m)))
+            return 2;
+        if ((config.tools & GEN_JC) && !write_withdrawals(&config, month, year, days, m))
+            return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,349 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   csvscan.c                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:42:47 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:22:23 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "csvscan.h"
+
+// Records and fields are found a 64-byte block at a time: one pass of vector
+// compares gives a bit per byte for the quotes, the delimiters and the
+// newlines of the block, a prefix XOR of the quote bits marks the bytes inside
+// quotes (carried from one block to the next), and the delimiters and
+// newlines left outside quotes are walked bit by bit. The cost no longer
+// depends on how many quotes and separators a line has, which on the fully
+// quoted SG lines is one every few bytes.
+
+#define CSV_BLOCK 64
+
+// Bits of the quotes, delimiters and newlines of one block, byte i at bit i
+typedef struct {
+    uint64_t quote;
+    uint64_t delimiter;
+    uint64_t newline;
+} CsvMasks;
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+# define CSV_SSE2 1
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+# include <arm_neon.h>
+# define CSV_NEON 1
+#endif
+
+// Byte by byte, for the tail of a block loop and the other architectures
+static const char *find3_scalar(const char *p, const char *end, char a, char b, char c) {
+    while (p < end && *p != a && *p != b && *p != c)
+        p++;
+    return p;
+}
+
+#ifdef CSV_SSE2
+// 16 bytes per step: compare against the three bytes, first set bit of the mask
+static const char *find3_sse2(const char *p, const char *end, char a, char b, char c) {
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c);
+
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+                                 _mm_cmpeq_epi8(v, vc));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(m);
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return find3_scalar(p, end, a, b, c);
+}
+
+// 32 bytes per step on CPUs with AVX2, selected at run time
+__attribute__((target("avx2")))
+static const char *find3_avx2(const char *p, const char *end, char a, char b, char c) {
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    const __m256i vc = _mm256_set1_epi8(c);
+
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)),
+                                    _mm256_cmpeq_epi8(v, vc));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(m);
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return find3_sse2(p, end, a, b, c);
+}
+#endif
+
+#ifdef CSV_NEON
+// 16 bytes per step; the compare result is narrowed to 4 bits per byte for the bit scan
+static const char *find3_neon(const char *p, const char *end, char a, char b, char c) {
+    const uint8x16_t va = vdupq_n_u8((uint8_t)a);
+    const uint8x16_t vb = vdupq_n_u8((uint8_t)b);
+    const uint8x16_t vc = vdupq_n_u8((uint8_t)c);
+
+    while (end - p >= 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t *)p);
+        uint8x16_t m = vorrq_u8(vorrq_u8(vceqq_u8(v, va), vceqq_u8(v, vb)), vceqq_u8(v, vc));
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+        if (mask)
+            return p + (__builtin_ctzll(mask) >> 2);
+        p += 16;
+    }
+    return find3_scalar(p, end, a, b, c);
+}
+#endif
+
+#if !defined(CSV_SSE2) && !(defined(CSV_NEON) && defined(__aarch64__))
+// Block masks, byte by byte, for the other architectures
+static void masks_scalar(const char *p, char delimiter, CsvMasks *masks) {
+    masks->quote = masks->delimiter = masks->newline = 0;
+    for (int i = 0; i < CSV_BLOCK; i++) {
+        uint64_t bit = (uint64_t)1 << i;
+        masks->quote |= p[i] == '"' ? bit : 0;
+        masks->delimiter |= p[i] == delimiter ? bit : 0;
+        masks->newline |= p[i] == '\n' ? bit : 0;
+    }
+}
+#endif
+
+#ifdef CSV_SSE2
+static uint64_t movemask_sse2(const __m128i v[4], __m128i c) {
+    return (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v[0], c)) |
+           (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v[1], c)) << 16 |
+           (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v[2], c)) << 32 |
+           (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v[3], c)) << 48;
+}
+
+static void masks_sse2(const char *p, char delimiter, CsvMasks *masks) {
+    const __m128i v[4] = {
+        _mm_loadu_si128((const __m128i *)p), _mm_loadu_si128((const __m128i *)(p + 16)),
+        _mm_loadu_si128((const __m128i *)(p + 32)), _mm_loadu_si128((const __m128i *)(p + 48)),
+    };
+    masks->quote = movemask_sse2(v, _mm_set1_epi8('"'));
+    masks->delimiter = movemask_sse2(v, _mm_set1_epi8(delimiter));
+    masks->newline = movemask_sse2(v, _mm_set1_epi8('\n'));
+}
+
+__attribute__((target("avx2")))
+static uint64_t movemask_avx2(__m256i lo, __m256i hi, __m256i c) {
+    return (uint64_t)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, c)) |
+           (uint64_t)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, c)) << 32;
+}
+
+__attribute__((target("avx2")))
+static void masks_avx2(const char *p, char delimiter, CsvMasks *masks) {
+    __m256i lo = _mm256_loadu_si256((const __m256i *)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+    masks->quote = movemask_avx2(lo, hi, _mm256_set1_epi8('"'));
+    masks->delimiter = movemask_avx2(lo, hi, _mm256_set1_epi8(delimiter));
+    masks->newline = movemask_avx2(lo, hi, _mm256_set1_epi8('\n'));
+}
+#endif
+
+#if defined(CSV_NEON) && defined(__aarch64__)
+// One bit per byte: weigh each compare lane by its bit, then add pairwise down to 8 bytes
+static uint64_t movemask_neon(const uint8x16_t v[4], uint8x16_t c) {
+    static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t w = vld1q_u8(weights);
+    uint8x16_t m0 = vandq_u8(vceqq_u8(v[0], c), w);
+    uint8x16_t m1 = vandq_u8(vceqq_u8(v[1], c), w);
+    uint8x16_t m2 = vandq_u8(vceqq_u8(v[2], c), w);
+    uint8x16_t m3 = vandq_u8(vceqq_u8(v[3], c), w);
+    uint8x16_t sum = vpaddq_u8(vpaddq_u8(m0, m1), vpaddq_u8(m2, m3));
+    sum = vpaddq_u8(sum, sum);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+}
+
+static void masks_neon(const char *p, char delimiter, CsvMasks *masks) {
+    const uint8_t *u = (const uint8_t *)p;
+    const uint8x16_t v[4] = {vld1q_u8(u), vld1q_u8(u + 16), vld1q_u8(u + 32), vld1q_u8(u + 48)};
+    masks->quote = movemask_neon(v, vdupq_n_u8('"'));
+    masks->delimiter = movemask_neon(v, vdupq_n_u8((uint8_t)delimiter));
+    masks->newline = movemask_neon(v, vdupq_n_u8('\n'));
+}
+#endif
+
+typedef const char *(*Find3Func)(const char *, const char *, char, char, char);
+typedef void (*MasksFunc)(const char *, char, CsvMasks *);
+
+static Find3Func select_find3(void) {
+#if defined(CSV_SSE2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return find3_avx2;
+    return find3_sse2;
+#elif defined(CSV_NEON)
+    return find3_neon;
+#else
+    return find3_scalar;
+#endif
+}
+
+const char *csv_find3(const char *p, const char *end, char a, char b, char c) {
+    // Selected on first use; every thread selects the same function
+    static Find3Func selected;
+    Find3Func find3 = __atomic_load_n(&selected, __ATOMIC_RELAXED);
+
+    if (!find3) {
+        find3 = select_find3();
+        __atomic_store_n(&selected, find3, __ATOMIC_RELAXED);
+    }
+    return find3(p, end, a, b, c);
+}
+
+static MasksFunc select_masks(void) {
+#if defined(CSV_SSE2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return masks_avx2;
+    return masks_sse2;
+#elif defined(CSV_NEON) && defined(__aarch64__)
+    return masks_neon;
+#else
+    return masks_scalar;
+#endif
+}
+
+// Masks of the block at p, of which only the bytes before end count: a short
+// tail is copied to a zeroed block, so nothing past end is read
+static void block_masks(const char *p, const char *end, char delimiter, CsvMasks *masks) {
+    static MasksFunc selected;
+    MasksFunc find = __atomic_load_n(&selected, __ATOMIC_RELAXED);
+    char tail[CSV_BLOCK];
+
+    if (!find) {
+        find = select_masks();
+        __atomic_store_n(&selected, find, __ATOMIC_RELAXED);
+    }
+    if (end - p < CSV_BLOCK) {
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, p, (size_t)(end - p));
+        p = tail;
+    }
+    find(p, delimiter, masks);
+}
+
+// Bytes inside quotes: bit i is the parity of the quotes up to byte i, flipped
+// when the previous block ended inside quotes; *inside carries the state on
+static uint64_t quoted_bytes(uint64_t quotes, uint64_t *inside) {
+    quotes ^= quotes << 1;
+    quotes ^= quotes << 2;
+    quotes ^= quotes << 4;
+    quotes ^= quotes << 8;
+    quotes ^= quotes << 16;
+    quotes ^= quotes << 32;
+    quotes ^= *inside;
+    *inside = (uint64_t)((int64_t)quotes >> 63);
+    return quotes;
+}
+
+void csv_init(CsvScanner *scanner, char *data, size_t len) {
+    scanner->data = data;
+    scanner->len = len;
+    scanner->pos = 0;
+}
+
+int csv_next_record(CsvScanner *scanner, Slice *record) {
+    char *start = scanner->data + scanner->pos;
+    char *end = scanner->data + scanner->len;
+    const char *p = end;
+    uint64_t inside = 0;
+    CsvMasks masks;
+
+    if (scanner->pos >= scanner->len)
+        return 0;
+    // Only quotes and newlines matter here, the delimiter is left to csv_split
+    for (const char *block = start; block < end; block += CSV_BLOCK) {
+        block_masks(block, end, '\n', &masks);
+        uint64_t newlines = masks.newline & ~quoted_bytes(masks.quote, &inside);
+        if (newlines) {
+            p = block + __builtin_ctzll(newlines);
+            break;
+        }
+    }
+    record->ptr = start;
+    record->len = (size_t)(p - start);
+    scanner->data[p - scanner->data] = '\0';
+    scanner->pos = (size_t)(p - scanner->data) + (p < end);
+    return 1;
+}
+
+int csv_split(char *record, size_t len, char delimiter, Slice *fields, int max_fields) {
+    char *end = record + len;
+    char *start = record;
+    uint64_t inside = 0;
+    CsvMasks masks;
+    int count = 0;
+
+    if (max_fields <= 0)
+        return 0;
+    for (char *block = record; block < end && count < max_fields - 1; block += CSV_BLOCK) {
+        block_masks(block, end, delimiter, &masks);
+        uint64_t delimiters = masks.delimiter & ~quoted_bytes(masks.quote, &inside);
+        while (delimiters && count < max_fields - 1) {
+            char *p = block + __builtin_ctzll(delimiters);
+            delimiters &= delimiters - 1;
+            *p = '\0';
+            fields[count++] = slice_between(start, p);
+            start = p + 1;
+        }
+    }
+    fields[count++] = slice_between(start, end);
+    return count;
+}
+
+char *csv_read_file(const char *path, size_t *len) {
+    int fd = open(path, O_RDONLY);
+    size_t cap = 1 << 16;
+    size_t used = 0;
+    char *buf;
+
+    if (fd < 0)
+        return NULL;
+    buf = malloc(cap + 1);
+    while (buf) {
+        ssize_t n;
+        if (used == cap) {
+            char *grown = realloc(buf, cap * 2 + 1);
+            if (!grown) {
+                free(buf);
+                buf = NULL;
+                break;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+        do {
+            n = read(fd, buf + used, cap - used);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) {
+            free(buf);
+            buf = NULL;
+        } else if (n == 0) {
+            break;
+        } else {
+            used += (size_t)n;
+        }
+    }
+    close(fd);
+    if (!buf)
+        return NULL;
+    buf[used] = '\0';
+    *len = used;
+    return buf;
+}
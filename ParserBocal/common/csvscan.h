@@ -0,0 +1,46 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   csvscan.h                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:42:47 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:22:23 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CSVSCAN_H
+# define CSVSCAN_H
+
+#include "slice.h"
+
+// Semicolon CSV scanned in place, a 64-byte block at a time. The buffer is
+// writable and NUL-terminated at data[len]; each record and each field is
+// NUL-terminated where its separator was, so callers get both Slices and
+// C strings without copying. A '"' toggles the quoted state, so separators
+// and newlines inside a quoted cell (the TVA cells of the sales export)
+// belong to the cell.
+typedef struct {
+    char *data;
+    size_t len;
+    size_t pos;             // start of the next record
+} CsvScanner;
+
+// Start scanning data[0, len), data[len] must be '\0'
+void csv_init(CsvScanner *scanner, char *data, size_t len);
+
+// Next record without its newline; returns 0 at the end of the data
+int csv_next_record(CsvScanner *scanner, Slice *record);
+
+// Split a record in at most max_fields fields, the last one keeps the rest of
+// the record; fields are raw (quotes and spaces kept); returns the field count
+int csv_split(char *record, size_t len, char delimiter, Slice *fields, int max_fields);
+
+// First of the bytes a, b or c in [p, end), end if none
+const char *csv_find3(const char *p, const char *end, char a, char b, char c);
+
+// Whole file in a NUL-terminated buffer for csv_init, NULL on failure
+char *csv_read_file(const char *path, size_t *len);
+
+#endif
@@ -0,0 +1,137 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   dates.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:38:41 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:55:27 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "dates.h"
+
+// Three numbers of a date field and their digit counts; 0 if the field is something else
+static int date_fields(const char *s, size_t len, int *numbers, int *digits) {
+    const char *p = s, *end = s + len;
+    char separator = 0;
+
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '"'))
+        p++;
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '"' || end[-1] == '\r'))
+        end--;
+    for (int f = 0; f < 3; f++) {
+        numbers[f] = 0;
+        digits[f] = 0;
+        while (p < end && *p >= '0' && *p <= '9' && digits[f] < 5) {
+            numbers[f] = numbers[f] * 10 + (*p++ - '0');
+            digits[f]++;
+        }
+        if (digits[f] == 0 || digits[f] > 4)
+            return 0;
+        if (f == 2)
+            break;
+        if (p == end || (*p != '/' && *p != '-' && *p != '.') || (separator && *p != separator))
+            return 0;
+        separator = *p++;
+    }
+    return p == end;
+}
+
+static int days_in_month(int year, int month) {
+    static const int days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return days[month - 1] + (month == 2 && leap);
+}
+
+// Day of year, month and day numbers, DATE_NONE if they make no date
+static Day date_of_fields(int year, int month, int day) {
+    if (year < 1 || year > 9999 || month < 1 || month > 12 || day < 1 || day > days_in_month(year, month))
+        return DATE_NONE;
+    return date_from_civil(year, month, day);
+}
+
+static Day date_of_numbers(const int *numbers, const int *digits, DateOrder order) {
+    if (digits[0] == 4)
+        return digits[1] <= 2 && digits[2] <= 2 ? date_of_fields(numbers[0], numbers[1], numbers[2]) : DATE_NONE;
+    if (digits[0] > 2 || digits[1] > 2 || (digits[2] != 2 && digits[2] != 4))
+        return DATE_NONE;
+    int year = digits[2] == 2 ? 2000 + numbers[2] : numbers[2];
+    return order == DATE_MONTH_FIRST ? date_of_fields(year, numbers[0], numbers[1])
+                                     : date_of_fields(year, numbers[1], numbers[0]);
+}
+
+Day date_from_civil(int year, int month, int day) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yoe = year - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void date_to_civil(Day date, int *year, int *month, int *day) {
+    int z = date + 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    *day = doy - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = yoe + era * 400 + (*month <= 2);
+}
+
+int date_parse(const char *s, size_t len, DateOrder order, Day *out) {
+    int numbers[3], digits[3];
+
+    *out = date_fields(s, len, numbers, digits) ? date_of_numbers(numbers, digits, order) : DATE_NONE;
+    return *out != DATE_NONE;
+}
+
+size_t date_format(Day date, char *out) {
+    int year, month, day;
+    date_to_civil(date, &year, &month, &day);
+    out[0] = (char)('0' + day / 10);
+    out[1] = (char)('0' + day % 10);
+    out[2] = '/';
+    out[3] = (char)('0' + month / 10);
+    out[4] = (char)('0' + month % 10);
+    out[5] = '/';
+    out[6] = (char)('0' + year / 1000 % 10);
+    out[7] = (char)('0' + year / 100 % 10);
+    out[8] = (char)('0' + year / 10 % 10);
+    out[9] = (char)('0' + year % 10);
+    out[10] = '\0';
+    return 10;
+}
+
+void date_sniff(DateSniffer *sniffer, const char *s, size_t len) {
+    int numbers[3], digits[3];
+
+    if (!date_fields(s, len, numbers, digits) || digits[0] == 4)
+        return;
+    int as_day_first = date_of_numbers(numbers, digits, DATE_DAY_FIRST) != DATE_NONE;
+    int as_month_first = date_of_numbers(numbers, digits, DATE_MONTH_FIRST) != DATE_NONE;
+    if (!as_day_first && !as_month_first)
+        return;
+    sniffer->day_first += as_day_first && !as_month_first;
+    sniffer->month_first += as_month_first && !as_day_first;
+    if (sniffer->count > 0 && sniffer->previous[2] == numbers[2]) {
+        int first = numbers[0] != sniffer->previous[0], second = numbers[1] != sniffer->previous[1];
+        sniffer->first_steps += first && !second;
+        sniffer->second_steps += second && !first;
+    }
+    for (int f = 0; f < 3; f++)
+        sniffer->previous[f] = numbers[f];
+    sniffer->count++;
+}
+
+DateOrder date_sniff_order(const DateSniffer *sniffer, DateOrder fallback) {
+    if (sniffer->day_first != sniffer->month_first)
+        return sniffer->day_first > sniffer->month_first ? DATE_DAY_FIRST : DATE_MONTH_FIRST;
+    if (sniffer->first_steps != sniffer->second_steps)
+        return sniffer->first_steps > sniffer->second_steps ? DATE_DAY_FIRST : DATE_MONTH_FIRST;
+    return fallback;
+}
@@ -0,0 +1,69 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   dates.h                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:38:41 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:55:27 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef DATES_H
+# define DATES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Day number: days since 1970-01-01 in the proleptic Gregorian calendar. Every
+// parser produces it and every writer formats it, so joins, sorts, month
+// buckets and ranges are integer operations.
+typedef int32_t Day;
+
+#define DATE_NONE INT32_MIN
+#define DATE_TEXT_SIZE 11
+
+// Dates of a file looked at to find the order of its fields
+#define DATE_SAMPLE_DATES 256
+
+// Order of the day and month fields in the dates of a file. A first field of
+// four digits is always a year (YYYY-MM-DD), whatever the order.
+typedef enum {
+    DATE_DAY_FIRST,         // DD/MM/YYYY, D/M/YY
+    DATE_MONTH_FIRST        // MM/DD/YYYY, M/D/YY
+} DateOrder;
+
+// What a sample of dates tells about their order: a field above 12 is a day,
+// and between consecutive dates of a daily export the day is the field that moves
+typedef struct {
+    int day_first;          // dates only valid as DD/MM
+    int month_first;        // dates only valid as MM/DD
+    int first_steps;        // consecutive dates where only the first field changed
+    int second_steps;       // ... only the second field
+    int count;
+    int previous[3];
+} DateSniffer;
+
+Day date_from_civil(int year, int month, int day);
+void date_to_civil(Day date, int *year, int *month, int *day);
+
+// Parse a whole field (spaces and quotes around it ignored): fields separated
+// by '/', '-' or '.', two-digit years in 2000-2099. Returns 0 (and DATE_NONE)
+// for anything that is not a valid date.
+int date_parse(const char *s, size_t len, DateOrder order, Day *out);
+
+// Write "DD/MM/YYYY" into out (DATE_TEXT_SIZE bytes), returns its length
+size_t date_format(Day date, char *out);
+
+// Year * 12 + month - 1, the bucket of a month
+static inline int date_month_index(Day date) {
+    int year, month, day;
+    date_to_civil(date, &year, &month, &day);
+    return year * 12 + month - 1;
+}
+
+void date_sniff(DateSniffer *sniffer, const char *s, size_t len);
+DateOrder date_sniff_order(const DateSniffer *sniffer, DateOrder fallback);
+
+#endif
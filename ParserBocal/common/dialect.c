@@ -0,0 +1,332 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   dialect.c                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:50:58 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:50:58 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "dialect.h"
+
+// The exports come from the bank, the POS and whoever saved them again from
+// Excel, so nothing about their layout is taken for granted: the first bytes
+// of a file tell its delimiter, whether its fields are quoted, its encoding,
+// where its header row is, which field holds each column and the order of its
+// dates. Records are split on newlines outside quotes, as csvscan does.
+
+// Delimiters tried, in order of preference when the sample does not tell
+static const char dialect_delimiters[] = {';', ',', '\t', '|'};
+#define DIALECT_DELIMITER_COUNT (int)sizeof(dialect_delimiters)
+
+// Longest header name compared
+#define DIALECT_NAME_SIZE 64
+
+// Lower case letter of each Latin-1 character from U+00C0, without its accent
+static const char latin1_fold[64] = "aaaaaaaceeeeiiiidnooooo*ouuuuyps"
+                                    "aaaaaaaceeeeiiiidnooooo/ouuuuypy";
+
+// Unicode of the Windows-1252 bytes 0x80 to 0x9F, the others are Latin-1
+static const unsigned short cp1252_high[32] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+};
+
+// One delimiter on the sample: how regular it splits the records, and the
+// header row it finds
+typedef struct {
+    CsvDialect dialect;
+    int found;
+    int agree;              // records split in the most common number of fields
+    int quoted;             // fields starting with a quote
+} Candidate;
+
+static unsigned cp1252_code(unsigned char c) {
+    return c >= 0x80 && c < 0xA0 ? cp1252_high[c - 0x80] : c;
+}
+
+// ASCII, UTF-8 when every high byte is part of a valid sequence (one cut by
+// the end of the sample counts, a window or a read may end anywhere),
+// Windows-1252 otherwise
+static DialectEncoding detect_encoding(const unsigned char *p, const unsigned char *end) {
+    DialectEncoding encoding = DIALECT_ASCII;
+
+    while (p < end) {
+        if (*p < 0x80) {
+            p++;
+            continue;
+        }
+        int extra = (*p & 0xE0) == 0xC0 ? 1 : (*p & 0xF0) == 0xE0 ? 2 : (*p & 0xF8) == 0xF0 ? 3 : -1;
+        if (extra < 0 || *p == 0xC0 || *p == 0xC1 || *p > 0xF4)
+            return DIALECT_CP1252;
+        for (int k = 1; k <= extra; k++) {
+            if (p + k >= end)
+                return DIALECT_UTF8;
+            if ((p[k] & 0xC0) != 0x80)
+                return DIALECT_CP1252;
+        }
+        p += extra + 1;
+        encoding = DIALECT_UTF8;
+    }
+    return encoding;
+}
+
+// End of the record starting at p: its newline outside quotes, or end;
+// `lines` counts the newlines inside it
+static const char *record_end(const char *p, const char *end, int *lines) {
+    int quoted = 0;
+
+    for (; p < end; p++) {
+        if (*p == '"')
+            quoted = !quoted;
+        else if (*p == '\n' && !quoted)
+            return p;
+        else if (*p == '\n')
+            (*lines)++;
+    }
+    return end;
+}
+
+// Fields of a record, split on the delimiter outside quotes; the last one
+// keeps the rest of the record
+static int split_fields(const char *p, const char *end, char delimiter, Slice *fields, int max) {
+    int count = 0, quoted = 0;
+    const char *field = p;
+
+    for (; p < end && count < max - 1; p++) {
+        if (*p == '"') {
+            quoted = !quoted;
+        } else if (*p == delimiter && !quoted) {
+            fields[count++] = slice_between(field, p);
+            field = p + 1;
+        }
+    }
+    if (end > field && end[-1] == '\r')
+        end--;
+    fields[count++] = slice_between(field, end > field ? end : field);
+    return count;
+}
+
+// Header name of a field as the columns write it: lower case without accents,
+// quotes and spaces around it dropped, a space for each run of spaces
+static size_t fold_name(Slice field, DialectEncoding encoding, char *out) {
+    const unsigned char *p = (const unsigned char *)field.ptr, *end = p + field.len;
+    size_t n = 0;
+
+    while (p < end && n + 1 < DIALECT_NAME_SIZE) {
+        unsigned c = *p++;
+        if (c >= 0x80 && encoding == DIALECT_UTF8) {
+            if (c == 0xC2 && p < end) {
+                c = *p++;
+            } else if (c == 0xC3 && p < end) {
+                c = *p++ + 0x40u;
+            } else if (c == 0xE2 && end - p >= 2 && p[0] == 0x80) {
+                c = p[1] == 0x98 || p[1] == 0x99 ? '\'' : p[1] == 0xAF ? ' ' : '?';
+                p += 2;
+            } else {
+                while (p < end && (*p & 0xC0) == 0x80)
+                    p++;
+                c = '?';
+            }
+        } else if (c >= 0x80) {
+            unsigned code = cp1252_code((unsigned char)c);
+            c = code == 0x2018 || code == 0x2019 ? '\'' : code;
+        }
+
+        if (c == ' ' || c == '\t' || c == '\r' || c == 0xA0) {
+            if (n > 0 && out[n - 1] != ' ')
+                out[n++] = ' ';
+        } else if (c >= 0xC0 && c <= 0xFF) {
+            out[n++] = latin1_fold[c - 0xC0];
+        } else if (c >= 'A' && c <= 'Z') {
+            out[n++] = (char)(c - 'A' + 'a');
+        } else if (c != '"') {
+            out[n++] = c < 0x80 ? (char)c : '?';
+        }
+    }
+    while (n > 0 && out[n - 1] == ' ')
+        n--;
+    out[n] = '\0';
+    return n;
+}
+
+static int name_matches(const char *folded, size_t len, const char *name) {
+    size_t n = strlen(name);
+
+    if (n > 0 && name[n - 1] == '*')
+        return len >= n - 1 && memcmp(folded, name, n - 1) == 0;
+    return len == n && memcmp(folded, name, n) == 0;
+}
+
+// Fields a record needs to hold every required column
+static void finish_columns(CsvDialect *dialect, const DialectColumn *columns, int count) {
+    dialect->required_fields = 0;
+    for (int c = 0; c < count; c++) {
+        if ((columns[c].flags & DIALECT_REQUIRED) && dialect->columns[c] >= dialect->required_fields)
+            dialect->required_fields = dialect->columns[c] + 1;
+    }
+}
+
+// Columns at their default positions, for files without a header row
+static void default_columns(CsvDialect *dialect, const DialectColumn *columns, int count) {
+    dialect->field_count = 0;
+    for (int c = 0; c < DIALECT_MAX_COLUMNS; c++)
+        dialect->columns[c] = c < count ? columns[c].position : -1;
+    for (int c = 0; c < count; c++) {
+        if (columns[c].position >= dialect->field_count)
+            dialect->field_count = columns[c].position + 1;
+    }
+    finish_columns(dialect, columns, count);
+}
+
+// The header row names every required column: map them
+static int match_header(Candidate *candidate, const Slice *fields, int field_count, const DialectColumn *columns,
+                        int count) {
+    CsvDialect *dialect = &candidate->dialect;
+    char name[DIALECT_NAME_SIZE];
+    int map[DIALECT_MAX_COLUMNS];
+
+    for (int c = 0; c < count; c++)
+        map[c] = -1;
+    for (int i = 0; i < field_count; i++) {
+        size_t len = fold_name(fields[i], dialect->encoding, name);
+        for (int c = 0; c < count; c++) {
+            if (map[c] < 0 && name_matches(name, len, columns[c].name)) {
+                map[c] = i;
+                break;
+            }
+        }
+    }
+    for (int c = 0; c < count; c++) {
+        if (map[c] < 0 && (columns[c].flags & DIALECT_REQUIRED))
+            return 0;
+    }
+    for (int c = 0; c < DIALECT_MAX_COLUMNS; c++)
+        dialect->columns[c] = c < count ? map[c] : -1;
+    dialect->field_count = field_count < DIALECT_MAX_FIELDS ? field_count : DIALECT_MAX_FIELDS - 1;
+    finish_columns(dialect, columns, count);
+    return 1;
+}
+
+// Records of the sample split on one delimiter
+static void try_delimiter(Candidate *candidate, const char *start, const char *end, int complete,
+                          const DialectColumn *columns, int count) {
+    CsvDialect *dialect = &candidate->dialect;
+    Slice fields[DIALECT_MAX_FIELDS];
+    int histogram[DIALECT_MAX_FIELDS + 1] = {0};
+    int line = 0;
+
+    for (const char *p = start; p < end;) {
+        int inner = 0;
+        const char *stop = record_end(p, end, &inner);
+        // A record cut by the end of the sample says nothing
+        if (stop == end && !complete)
+            break;
+        int field_count = split_fields(p, stop, dialect->delimiter, fields, DIALECT_MAX_FIELDS);
+        if (field_count > 1)
+            histogram[field_count]++;
+        for (int i = 0; i < field_count; i++)
+            candidate->quoted += fields[i].len > 0 && fields[i].ptr[0] == '"';
+        if (!candidate->found && count > 0 && match_header(candidate, fields, field_count, columns, count)) {
+            candidate->found = 1;
+            dialect->header_line = line;
+            dialect->data_offset = (size_t)(stop < end ? stop + 1 - start : end - start);
+        }
+        line += inner + 1;
+        p = stop < end ? stop + 1 : end;
+    }
+    for (int k = 2; k <= DIALECT_MAX_FIELDS; k++) {
+        if (histogram[k] > candidate->agree)
+            candidate->agree = histogram[k];
+    }
+}
+
+// Order of the dates in the date columns of the records after the header
+static DateOrder sniff_dates(const CsvDialect *dialect, const char *p, const char *end, int complete,
+                             const DialectColumn *columns, int count) {
+    DateSniffer sniffer = {0};
+    Slice fields[DIALECT_MAX_FIELDS];
+
+    while (p < end && sniffer.count < DATE_SAMPLE_DATES) {
+        int inner = 0;
+        const char *stop = record_end(p, end, &inner);
+        if (stop == end && !complete)
+            break;
+        int field_count = split_fields(p, stop, dialect->delimiter, fields, DIALECT_MAX_FIELDS);
+        for (int c = 0; c < count; c++) {
+            int field = dialect->columns[c];
+            if ((columns[c].flags & DIALECT_DATE) && field >= 0 && field < field_count)
+                date_sniff(&sniffer, fields[field].ptr, fields[field].len);
+        }
+        p = stop < end ? stop + 1 : end;
+    }
+    return date_sniff_order(&sniffer, DATE_DAY_FIRST);
+}
+
+int dialect_sniff(const char *data, size_t size, const DialectColumn *columns, int count, CsvDialect *dialect) {
+    const char *start = data, *end = data + (size < DIALECT_SAMPLE_SIZE ? size : DIALECT_SAMPLE_SIZE);
+    int complete = size < DIALECT_SAMPLE_SIZE;
+    Candidate candidates[DIALECT_DELIMITER_COUNT];
+    Candidate *best = NULL;
+
+    if (count > DIALECT_MAX_COLUMNS)
+        count = DIALECT_MAX_COLUMNS;
+    // A byte order mark is no part of the first field
+    if (end - start >= 3 && memcmp(start, "\xEF\xBB\xBF", 3) == 0)
+        start += 3;
+    DialectEncoding encoding = detect_encoding((const unsigned char *)start, (const unsigned char *)end);
+
+    for (int d = 0; d < DIALECT_DELIMITER_COUNT; d++) {
+        Candidate *candidate = &candidates[d];
+        memset(candidate, 0, sizeof(*candidate));
+        candidate->dialect.delimiter = dialect_delimiters[d];
+        candidate->dialect.encoding = encoding;
+        candidate->dialect.header_line = -1;
+        candidate->dialect.data_offset = 0;
+        try_delimiter(candidate, start, end, complete, columns, count);
+        // A header row first, then the most regular split, then the order of preference
+        if (!best || candidate->found > best->found ||
+            (candidate->found == best->found && candidate->agree > best->agree))
+            best = candidate;
+    }
+    *dialect = best->dialect;
+    dialect->quote = best->quoted > 0 ? '"' : 0;
+    dialect->data_offset += (size_t)(start - data);
+    if (!best->found)
+        default_columns(dialect, columns, count);
+    dialect->order = sniff_dates(dialect, data + dialect->data_offset, end, complete, columns, count);
+    return best->found;
+}
+
+size_t dialect_utf8_size(const char *src, size_t len) {
+    size_t size = len;
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned code = cp1252_code((unsigned char)src[i]);
+        size += (code >= 0x80) + (code >= 0x800);
+    }
+    return size;
+}
+
+void dialect_to_utf8(const char *src, size_t len, char *dst) {
+    char *out = dst + dialect_utf8_size(src, len);
+
+    for (size_t i = len; i-- > 0;) {
+        unsigned code = cp1252_code((unsigned char)src[i]);
+        if (code < 0x80) {
+            *--out = (char)code;
+        } else if (code < 0x800) {
+            *--out = (char)(0x80 | (code & 0x3F));
+            *--out = (char)(0xC0 | (code >> 6));
+        } else {
+            *--out = (char)(0x80 | (code & 0x3F));
+            *--out = (char)(0x80 | ((code >> 6) & 0x3F));
+            *--out = (char)(0xE0 | (code >> 12));
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   dialect.h                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:50:58 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:50:58 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef DIALECT_H
+# define DIALECT_H
+
+#include <stddef.h>
+#include "slice.h"
+#include "dates.h"
+
+// Bytes of a file looked at to find its dialect
+#define DIALECT_SAMPLE_SIZE 65536
+
+#define DIALECT_MAX_COLUMNS 16
+#define DIALECT_MAX_FIELDS 32
+
+typedef enum {
+    DIALECT_ASCII,
+    DIALECT_UTF8,
+    DIALECT_CP1252          // Windows-1252, what Excel writes on French systems
+} DialectEncoding;
+
+// Flags of a column
+#define DIALECT_REQUIRED 1  // the header row must name it
+#define DIALECT_DATE 2      // its values give the order of the dates of the file
+
+// Column a tool reads, found by name in the header row. Names are lower case
+// without accents ("debit" matches "Débit" in UTF-8 and in Windows-1252); a
+// trailing '*' matches the start of a header ("nature de l*").
+typedef struct {
+    const char *name;
+    int position;           // field used when the file has no header row
+    int flags;
+} DialectColumn;
+
+// How a file is written, decided once from its first DIALECT_SAMPLE_SIZE
+// bytes so that the parse loop runs without looking again
+typedef struct {
+    char delimiter;         // ';', ',', '\t' or '|'
+    char quote;             // '"' when fields are quoted, 0 otherwise
+    DialectEncoding encoding;
+    DateOrder order;        // order of the dates of the DIALECT_DATE columns
+    int header_line;        // line ('\n' counted) of the header row, -1 if none
+    size_t data_offset;     // first byte after the header row (after a BOM without one)
+    int field_count;        // fields of the header row, below DIALECT_MAX_FIELDS
+    int required_fields;    // fields a record needs to hold every required column
+    int columns[DIALECT_MAX_COLUMNS];  // field of each column, -1 if missing
+} CsvDialect;
+
+// Dialect of data[0, size) for the columns a tool reads: the delimiter whose
+// header row names every required column, or that splits the most records the
+// same way. Returns 1 with the header row, 0 with the default positions of the
+// columns (and the default dialect for empty data).
+int dialect_sniff(const char *data, size_t size, const DialectColumn *columns, int count, CsvDialect *dialect);
+
+// UTF-8 size of Windows-1252 text, and the text converted; dst may be src when
+// it has room for the result, the conversion runs from the end
+size_t dialect_utf8_size(const char *src, size_t len);
+void dialect_to_utf8(const char *src, size_t len, char *dst);
+
+#endif
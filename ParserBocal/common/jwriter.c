@@ -0,0 +1,166 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   jwriter.c                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:37:51 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 14:59:00 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "jwriter.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+int jwriter_init(JournalWriter *writer, int fd, JournalLayout layout) {
+    writer->fd = fd;
+    writer->len = 0;
+    writer->flushed = 0;
+    writer->cap = fd < 0 ? 4096 : JWRITER_BUFFER_SIZE;
+    writer->layout = layout;
+    writer->failed = 0;
+    writer->buf = malloc(writer->cap);
+    if (!writer->buf) {
+        writer->cap = 0;
+        writer->failed = 1;
+        return 0;
+    }
+    return 1;
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+int jwriter_flush(JournalWriter *writer) {
+    if (writer->fd >= 0 && writer->len > 0) {
+        if (!write_all(writer->fd, writer->buf, writer->len))
+            writer->failed = 1;
+        writer->flushed += writer->len;
+        writer->len = 0;
+    }
+    return !writer->failed;
+}
+
+// Make room for `need` more bytes: flush to the descriptor, or grow in memory mode
+static char *reserve(JournalWriter *writer, size_t need) {
+    if (writer->len + need <= writer->cap)
+        return writer->buf + writer->len;
+    if (writer->fd >= 0) {
+        jwriter_flush(writer);
+        if (need <= writer->cap)
+            return writer->buf;
+    }
+    size_t cap = writer->cap ? writer->cap : 4096;
+    while (cap < writer->len + need) cap *= 2;
+    char *grown = realloc(writer->buf, cap);
+    if (!grown) {
+        writer->failed = 1;
+        return NULL;
+    }
+    writer->buf = grown;
+    writer->cap = cap;
+    return writer->buf + writer->len;
+}
+
+void jwriter_write(JournalWriter *writer, const char *data, size_t len) {
+    if (writer->fd >= 0 && len > writer->cap) {
+        // Too big to be worth copying
+        jwriter_flush(writer);
+        if (!write_all(writer->fd, data, len))
+            writer->failed = 1;
+        writer->flushed += len;
+        return;
+    }
+    char *p = reserve(writer, len);
+    if (!p) return;
+    memcpy(p, data, len);
+    writer->len += len;
+}
+
+size_t jwriter_tell(const JournalWriter *writer) {
+    return writer->flushed + writer->len;
+}
+
+void jwriter_header(JournalWriter *writer) {
+    if (writer->layout == JOURNAL_LAYOUT_LIBELLE_CPTE)
+        jwriter_write(writer, "Journal;Jour;Libelle;cpte;Debit;Credit\n", 39);
+    else
+        jwriter_write(writer, "Journal;Jour;cpte;Libelle;Debit;Credit\n", 39);
+}
+
+static char *put(char *p, Slice s) {
+    memcpy(p, s.ptr, s.len);
+    return p + s.len;
+}
+
+void jwriter_row(JournalWriter *writer, Slice journal, Slice jour, Slice compte, Slice libelle,
+                 Slice debit, Slice credit) {
+    size_t need = journal.len + jour.len + compte.len + libelle.len + debit.len + credit.len + 6;
+    char *p = reserve(writer, need);
+    if (!p) return;
+
+    Slice third = writer->layout == JOURNAL_LAYOUT_LIBELLE_CPTE ? libelle : compte;
+    Slice fourth = writer->layout == JOURNAL_LAYOUT_LIBELLE_CPTE ? compte : libelle;
+    p = put(p, journal);
+    *p++ = ';';
+    p = put(p, jour);
+    *p++ = ';';
+    p = put(p, third);
+    *p++ = ';';
+    p = put(p, fourth);
+    *p++ = ';';
+    p = put(p, debit);
+    *p++ = ';';
+    p = put(p, credit);
+    *p++ = '\n';
+    writer->len += need;
+}
+
+void jwriter_row_amount(JournalWriter *writer, Slice journal, Slice jour, Slice compte, Slice libelle,
+                        Money amount, JournalSide side) {
+    char text[MONEY_TEXT_SIZE];
+    Slice value = { text, money_format(amount, text) };
+    Slice empty = { "", 0 };
+    if (side == JOURNAL_DEBIT)
+        jwriter_row(writer, journal, jour, compte, libelle, value, empty);
+    else
+        jwriter_row(writer, journal, jour, compte, libelle, empty, value);
+}
+
+int jwriter_close(JournalWriter *writer) {
+    int ok = jwriter_flush(writer);
+    free(writer->buf);
+    writer->buf = NULL;
+    writer->len = 0;
+    writer->cap = 0;
+    return ok;
+}
+
+char *jwriter_take(JournalWriter *writer, size_t *len) {
+    char *text;
+
+    jwriter_write(writer, "", 1);
+    if (writer->failed || writer->fd >= 0) {
+        jwriter_close(writer);
+        return NULL;
+    }
+    text = writer->buf;
+    *len = writer->len - 1;
+    writer->buf = NULL;
+    writer->len = 0;
+    writer->cap = 0;
+    return text;
+}
@@ -0,0 +1,74 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   jwriter.h                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:37:51 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 14:59:00 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef JWRITER_H
+# define JWRITER_H
+
+#include "money.h"
+#include "slice.h"
+
+#define JWRITER_BUFFER_SIZE (1 << 20)
+
+// Column order of a journal: JB and JV write cpte before Libelle, JC after
+typedef enum {
+    JOURNAL_LAYOUT_CPTE_LIBELLE,
+    JOURNAL_LAYOUT_LIBELLE_CPTE
+} JournalLayout;
+
+// Side of the amount of a row
+typedef enum {
+    JOURNAL_DEBIT,
+    JOURNAL_CREDIT
+} JournalSide;
+
+// Journal rows formatted straight into a large buffer, flushed with write(2);
+// with fd < 0 everything stays in memory (buf/len) until the caller takes it
+typedef struct {
+    int fd;
+    char *buf;
+    size_t len;
+    size_t cap;
+    size_t flushed;         // bytes already written to the descriptor
+    JournalLayout layout;
+    int failed;             // a write or an allocation failed
+} JournalWriter;
+
+// Start a writer on an open descriptor, or in memory when fd < 0
+int jwriter_init(JournalWriter *writer, int fd, JournalLayout layout);
+
+// Bytes written so far, flushed or not
+size_t jwriter_tell(const JournalWriter *writer);
+
+// Header line of the layout
+void jwriter_header(JournalWriter *writer);
+
+// Row with amounts already written as text
+void jwriter_row(JournalWriter *writer, Slice journal, Slice jour, Slice compte, Slice libelle,
+                 Slice debit, Slice credit);
+
+// Row with one amount, written with a decimal comma, on the given side
+void jwriter_row_amount(JournalWriter *writer, Slice journal, Slice jour, Slice compte, Slice libelle,
+                        Money amount, JournalSide side);
+
+// Raw bytes, for example a block of rows produced by another writer
+void jwriter_write(JournalWriter *writer, const char *data, size_t len);
+
+// Write out the buffer (descriptor mode); returns 0 if anything failed so far
+int jwriter_flush(JournalWriter *writer);
+
+// Flush and release the buffer, the descriptor stays open; returns 0 on failure
+int jwriter_close(JournalWriter *writer);
+
+// Memory mode: hand the rows over as a NUL-terminated string to free(), NULL on failure
+char *jwriter_take(JournalWriter *writer, size_t *len);
+
+#endif
@@ -0,0 +1,179 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   money.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:38:56 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:29:16 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <string.h>
+#include "money.h"
+
+// Runs of digits are read eight bytes at a time on little-endian machines
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+# define MONEY_SWAR 1
+#else
+# define MONEY_SWAR 0
+#endif
+
+// Units below this take eight more digits without reaching INT64_MAX / 1000
+#define MONEY_SWAR_LIMIT 10000000
+
+static const int64_t powers_of_ten[9] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000
+};
+
+static int is_digit(unsigned char c) {
+    return c >= '0' && c <= '9';
+}
+
+static uint64_t load_word(const unsigned char *p) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// Number of ASCII digits starting the word, 0 to 8. A byte is a digit when its
+// high nibble is 3, before and after adding 6; a carry out of a byte above
+// 0xF9 only reaches the bytes after it, past the first non-digit.
+static int digit_run(uint64_t word) {
+    uint64_t high = (word & 0xF0F0F0F0F0F0F0F0ULL) ^ 0x3030303030303030ULL;
+    uint64_t over = ((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) ^ 0x3030303030303030ULL;
+    uint64_t others = high | over;
+    return others ? __builtin_ctzll(others) >> 3 : 8;
+}
+
+// Value of the first run digits of the word (1 to 8): they move to the top
+// bytes, zeros in front, then pairs, quads and halves are combined
+static int64_t word_digits(uint64_t word, int run) {
+    uint64_t d = (word - 0x3030303030303030ULL) << (8 * (8 - run));
+    d = (d * 10 + (d >> 8)) & 0x00FF00FF00FF00FFULL;
+    d = (d * 100 + (d >> 16)) & 0x0000FFFF0000FFFFULL;
+    d = (d * 10000 + (d >> 32)) & 0x00000000FFFFFFFFULL;
+    return (int64_t)d;
+}
+
+// Length of a group separator at p: space, tab, Latin-1 or UTF-8 (narrow) no-break space
+static size_t group_separator(const unsigned char *p, const unsigned char *end) {
+    if (p >= end) return 0;
+    if (*p == ' ' || *p == '\t' || *p == 0xA0) return 1;
+    if (p[0] == 0xC2 && p + 1 < end && p[1] == 0xA0) return 2;
+    if (p[0] == 0xE2 && p + 2 < end && p[1] == 0x80 && p[2] == 0xAF) return 3;
+    return 0;
+}
+
+// A digit, or a decimal separator and a digit
+static int starts_number(const unsigned char *p, const unsigned char *end) {
+    return p < end && (is_digit(*p) || ((*p == ',' || *p == '.') && p + 1 < end && is_digit(p[1])));
+}
+
+int money_parse(const char *s, size_t len, Money *out) {
+    const unsigned char *p = (const unsigned char *)s;
+    const unsigned char *end = p + len;
+    int negative = 0;
+    int found = 0;
+    int64_t units = 0;
+    int64_t cents = 0;
+
+    *out = 0;
+    // Skip anything before the number; a sign is one only when the number
+    // follows it, spaces aside ("A-B 12,00" is 12,00)
+    for (; p < end && !starts_number(p, end); p++) {
+        if (*p == '-' || *p == '+') {
+            const unsigned char *q = p + 1;
+            size_t sep;
+            while ((sep = group_separator(q, end)))
+                q += sep;
+            if (starts_number(q, end)) {
+                negative = *p == '-';
+                p = q;
+                break;
+            }
+        }
+    }
+
+    // Integer part, digits may be grouped
+    while (p < end) {
+        if (MONEY_SWAR && end - p >= 8 && units < MONEY_SWAR_LIMIT) {
+            int run = digit_run(load_word(p));
+            if (run > 0) {
+                units = units * powers_of_ten[run] + word_digits(load_word(p), run);
+                found = 1;
+                p += run;
+                if (run == 8)
+                    continue;
+            }
+        } else if (is_digit(*p)) {
+            if (units < INT64_MAX / 1000)
+                units = units * 10 + (*p - '0');
+            found = 1;
+            p++;
+            continue;
+        }
+        size_t sep = group_separator(p, end);
+        if (sep && found && p + sep < end && is_digit(p[sep])) {
+            p += sep;
+            continue;
+        }
+        break;
+    }
+
+    // Decimal part
+    if (p < end && (*p == ',' || *p == '.') && p + 1 < end && is_digit(p[1])) {
+        int digits = 0;
+        int round_up = 0;
+        for (p++; p < end && is_digit(*p); p++, digits++) {
+            if (digits < 2)
+                cents = cents * 10 + (*p - '0');
+            else if (digits == 2)
+                round_up = *p >= '5';
+        }
+        if (digits == 1)
+            cents *= 10;
+        cents += round_up;
+        found = 1;
+    }
+
+    if (!found)
+        return 0;
+    *out = units * 100 + cents;
+    if (negative)
+        *out = -*out;
+    return 1;
+}
+
+size_t money_format(Money amount, char *out) {
+    char digits[24];
+    int n = 0;
+    uint64_t u = amount < 0 ? 0ULL - (uint64_t)amount : (uint64_t)amount;
+    do {
+        digits[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u > 0 || n < 3);
+
+    size_t len = 0;
+    if (amount < 0)
+        out[len++] = '-';
+    while (n > 2)
+        out[len++] = digits[--n];
+    out[len++] = ',';
+    out[len++] = digits[1];
+    out[len++] = digits[0];
+    out[len] = '\0';
+    return len;
+}
+
+Money money_muldiv(Money amount, Money num, Money den) {
+    if (den == 0)
+        return 0;
+    __int128 product = (__int128)amount * num;
+    int negative = (product < 0) != (den < 0);
+    if (product < 0) product = -product;
+    if (den < 0) den = -den;
+    __int128 quotient = (product + den / 2) / den;
+    return (Money)(negative ? -quotient : quotient);
+}
@@ -0,0 +1,47 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   money.h                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:38:56 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:46:55 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef MONEY_H
+# define MONEY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Amount in cents. Every parser produces it and every writer consumes it, so
+// sums and comparisons are exact integer operations.
+typedef int64_t Money;
+
+#define MONEY_TEXT_SIZE 32
+
+// printf("%s%lld.%02lld", MONEY_PRINTF_ARGS(m)) for log lines
+#define MONEY_PRINTF "%s%lld.%02lld"
+#define MONEY_PRINTF_ARGS(m) ((m) < 0 ? "-" : ""), \
+    (long long)((m) < 0 ? -(m) : (m)) / 100, (long long)((m) < 0 ? -(m) : (m)) % 100
+
+// Parse the first amount of a text straight to cents, without copying it:
+// leading text is skipped, spaces and no-break spaces (C2 A0, E2 80 AF) group
+// digits, ',' or '.' is the decimal separator, more than two decimals are
+// rounded half away from zero and a currency mark after it ("44,05E") ends
+// it. Returns 0 (and 0 cents) when the text holds no amount.
+int money_parse(const char *s, size_t len, Money *out);
+
+// Write "-1234,56" into out (MONEY_TEXT_SIZE bytes), returns its length
+size_t money_format(Money amount, char *out);
+
+// amount * num / den rounded half away from zero, without overflow
+Money money_muldiv(Money amount, Money num, Money den);
+
+static inline Money money_abs(Money amount) {
+    return amount < 0 ? -amount : amount;
+}
+
+#endif
@@ -0,0 +1,144 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   pool.c                                             :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:33:06 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 14:33:06 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "pool.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+    Pool *pool;
+    int index;
+} PoolWorker;
+
+int pool_default_threads(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+}
+
+static void *pool_worker(void *arg) {
+    PoolWorker *worker = arg;
+    Pool *pool = worker->pool;
+    int index = worker->index;
+    free(worker);
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->count == 0 && !pool->stop)
+            pthread_cond_wait(&pool->has_work, &pool->lock);
+        if (pool->count == 0)
+            break;
+
+        PoolTask task = pool->tasks[pool->head];
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->count--;
+        pool->running++;
+        pthread_mutex_unlock(&pool->lock);
+
+        task.func(task.arg, index);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->running--;
+        if (pool->count == 0 && pool->running == 0)
+            pthread_cond_broadcast(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int pool_init(Pool *pool, int threads) {
+    pool->thread_count = 0;
+    pool->tasks = NULL;
+    pool->head = 0;
+    pool->count = 0;
+    pool->capacity = 0;
+    pool->running = 0;
+    pool->stop = 0;
+    if (threads <= 0)
+        threads = pool_default_threads();
+
+    pool->threads = malloc((size_t)threads * sizeof(pthread_t));
+    if (!pool->threads)
+        return 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->has_work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (int i = 0; i < threads; i++) {
+        PoolWorker *worker = malloc(sizeof(PoolWorker));
+        if (!worker)
+            break;
+        worker->pool = pool;
+        worker->index = i;
+        if (pthread_create(&pool->threads[i], NULL, pool_worker, worker) != 0) {
+            free(worker);
+            break;
+        }
+        pool->thread_count++;
+    }
+    if (pool->thread_count == 0) {
+        pool_destroy(pool);
+        return 0;
+    }
+    return 1;
+}
+
+int pool_submit(Pool *pool, PoolFunc func, void *arg) {
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count == pool->capacity) {
+        size_t capacity = pool->capacity ? pool->capacity * 2 : 64;
+        PoolTask *grown = malloc(capacity * sizeof(PoolTask));
+        if (!grown) {
+            pthread_mutex_unlock(&pool->lock);
+            return 0;
+        }
+        // Unroll the ring into the new array
+        for (size_t i = 0; i < pool->count; i++)
+            grown[i] = pool->tasks[(pool->head + i) % pool->capacity];
+        free(pool->tasks);
+        pool->tasks = grown;
+        pool->capacity = capacity;
+        pool->head = 0;
+    }
+    pool->tasks[(pool->head + pool->count) % pool->capacity].func = func;
+    pool->tasks[(pool->head + pool->count) % pool->capacity].arg = arg;
+    pool->count++;
+    pthread_cond_signal(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+    return 1;
+}
+
+void pool_wait(Pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->count > 0 || pool->running > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_destroy(Pool *pool) {
+    if (!pool->threads)
+        return;
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->thread_count; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    free(pool->threads);
+    free(pool->tasks);
+    pool->threads = NULL;
+    pool->tasks = NULL;
+    pool->thread_count = 0;
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->has_work);
+    pthread_cond_destroy(&pool->done);
+}
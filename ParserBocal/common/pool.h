@@ -0,0 +1,57 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   pool.h                                             :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:33:06 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 14:33:06 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef POOL_H
+# define POOL_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+// Task run by a worker; `worker` is the index of the thread running it
+typedef void (*PoolFunc)(void *arg, int worker);
+
+typedef struct {
+    PoolFunc func;
+    void *arg;
+} PoolTask;
+
+// Fixed set of worker threads draining a FIFO of tasks
+typedef struct {
+    pthread_t *threads;
+    int thread_count;
+    PoolTask *tasks;        // ring of queued tasks
+    size_t head;
+    size_t count;
+    size_t capacity;
+    int running;            // tasks taken by a worker and not finished yet
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t has_work;
+    pthread_cond_t done;
+} Pool;
+
+// Number of online cores, at least 1
+int pool_default_threads(void);
+
+// Start `threads` workers (pool_default_threads() when <= 0)
+int pool_init(Pool *pool, int threads);
+
+// Queue a task, returns 0 when out of memory
+int pool_submit(Pool *pool, PoolFunc func, void *arg);
+
+// Wait until every queued task has finished
+void pool_wait(Pool *pool);
+
+// Finish the queued tasks and stop the workers
+void pool_destroy(Pool *pool);
+
+#endif
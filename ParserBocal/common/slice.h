@@ -0,0 +1,38 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   slice.h                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:37:51 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 14:37:51 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef SLICE_H
+# define SLICE_H
+
+#include <stddef.h>
+#include <string.h>
+
+// View of bytes owned by someone else (a line buffer, a chart, a rule set or an arena)
+typedef struct {
+    const char *ptr;
+    size_t len;
+} Slice;
+
+// Slice of a string literal, without strlen
+#define SLICE_LIT(s) ((Slice){ (s), sizeof(s) - 1 })
+
+static inline Slice slice_cstr(const char *s) {
+    Slice out = { s ? s : "", s ? strlen(s) : 0 };
+    return out;
+}
+
+static inline Slice slice_between(const char *start, const char *end) {
+    Slice out = { start, (size_t)(end - start) };
+    return out;
+}
+
+#endif
@@ -0,0 +1,166 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   stats.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:12:58 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:15:52 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "stats.h"
+
+_Thread_local Stats *stats_current;
+
+// Name of each counter in the report, and the tools that update it
+static const struct {
+    const char *name;
+    int tools;
+} counter_info[STAT_COUNTER_COUNT] = {
+    [STAT_LINES_READ] = {"lines_read", STATS_JB | STATS_JV | STATS_JC},
+    [STAT_RECORDS_PARSED] = {"records_parsed", STATS_JB | STATS_JV | STATS_JC},
+    [STAT_SKIPPED_HEADER] = {"skipped_header", STATS_JB | STATS_JV | STATS_JC},
+    [STAT_SKIPPED_EMPTY] = {"skipped_empty", STATS_JB | STATS_JV | STATS_JC},
+    [STAT_SKIPPED_NOT_DATE] = {"skipped_not_date", STATS_JB | STATS_JV | STATS_JC},
+    [STAT_SKIPPED_CONTINUATION] = {"skipped_continuation", STATS_JB},
+    [STAT_SKIPPED_SHORT] = {"skipped_short", STATS_JB},
+    [STAT_SKIPPED_UNCLASSIFIED] = {"skipped_unclassified", STATS_JB},
+    [STAT_SKIPPED_NO_WITHDRAWAL] = {"skipped_no_withdrawal", STATS_JC},
+    [STAT_SKIPPED_NO_SALES] = {"skipped_no_sales", STATS_JV},
+    [STAT_BRANCH_REMISE_CB] = {"branch_remise_cb", STATS_JB},
+    [STAT_BRANCH_CARTE] = {"branch_carte", STATS_JB},
+    [STAT_BRANCH_DEBIT] = {"branch_debit", STATS_JB},
+    [STAT_BRANCH_CREDIT] = {"branch_credit", STATS_JB},
+    [STAT_SUB_RULE_HITS] = {"sub_rule_hits", STATS_JB},
+    [STAT_LABEL_WORD_SEARCHES] = {"label_word_searches", STATS_JB},
+    [STAT_FALLBACK_RULE_DEFAULT] = {"fallback_rule_default", STATS_JB},
+    [STAT_FALLBACK_401] = {"fallback_401", STATS_JB},
+    [STAT_HISTORY_HITS] = {"history_hits", STATS_JB},
+    [STAT_CHART_LOOKUPS] = {"chart_lookups", STATS_JB},
+    [STAT_CHART_HITS] = {"chart_hits", STATS_JB},
+    [STAT_CHART_LOOKUP_NS] = {"chart_lookup_ns", STATS_JB},
+    [STAT_VAT_CELLS] = {"vat_cells", STATS_JV},
+    [STAT_UNMATCHED_DAYS] = {"unmatched_days", STATS_JV},
+    [STAT_ADJUSTED_DAYS] = {"adjusted_days", STATS_JV},
+    [STAT_ENTRIES_WRITTEN] = {"entries_written", STATS_JB | STATS_JV | STATS_JC},
+    [STAT_BYTES_WRITTEN] = {"bytes_written", STATS_JB | STATS_JV | STATS_JC},
+};
+
+static const struct {
+    const char *name;
+    int tools;
+} stage_info[STAT_STAGE_COUNT] = {
+    [STAT_STAGE_LOAD_CHART] = {"load_chart", STATS_JB},
+    [STAT_STAGE_LOAD_RULES] = {"load_rules", STATS_JB},
+    [STAT_STAGE_READ] = {"read", STATS_JB | STATS_JV | STATS_JC},
+    [STAT_STAGE_PARSE] = {"parse", STATS_JB | STATS_JV | STATS_JC},
+    [STAT_STAGE_CLASSIFY] = {"classify", STATS_JB | STATS_JV},
+    [STAT_STAGE_WRITE] = {"write", STATS_JB | STATS_JV | STATS_JC},
+};
+
+uint64_t stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void stats_start(Stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->start = stats_now();
+    stats->lap = stats->start;
+    stats_current = stats;
+}
+
+void stats_lap(Stats *stats, StatStage stage) {
+    uint64_t now = stats_now();
+    stats->stage_ns[stage] += now - stats->lap;
+    stats->lap = now;
+}
+
+void stats_merge(Stats *into, const Stats *from) {
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++)
+        into->counters[i] += from->counters[i];
+    for (int i = 0; i < STAT_STAGE_COUNT; i++)
+        into->stage_ns[i] += from->stage_ns[i];
+}
+
+int stats_option(const char *arg, const char **path) {
+    if (strcmp(arg, "--stats") == 0) {
+        *path = NULL;
+        return 1;
+    }
+    if (strncmp(arg, "--stats=", 8) == 0 && arg[8]) {
+        *path = arg + 8;
+        return 1;
+    }
+    return 0;
+}
+
+// Peak resident set size in KiB (ru_maxrss is in bytes on macOS)
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+static void write_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; s && *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+int stats_report(const Stats *stats, int tool, const char *input, int ok, const char *path) {
+    FILE *out = path ? fopen(path, "a") : stderr;
+    const char *name = tool == STATS_JB ? "JB" : tool == STATS_JV ? "JV" : "JC";
+    char date[32] = "";
+    time_t now = time(NULL);
+    struct tm tm;
+
+    if (!out) {
+        fprintf(stderr, "Error: Could not open %s\n", path);
+        return 0;
+    }
+    if (localtime_r(&now, &tm))
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &tm);
+    fprintf(out, "{\"tool\": \"%s\", \"date\": \"%s\", \"input\": ", name, date);
+    write_string(out, input);
+    fprintf(out, ", \"ok\": %s, \"wall_ms\": %.3f, \"peak_rss_kb\": %ld", ok ? "true" : "false",
+            (double)(stats_now() - stats->start) / 1e6, peak_rss_kb());
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++) {
+        if (counter_info[i].tools & tool)
+            fprintf(out, ", \"%s\": %llu", counter_info[i].name, (unsigned long long)stats->counters[i]);
+    }
+    fprintf(out, ", \"stages_ms\": {");
+    const char *sep = "";
+    for (int i = 0; i < STAT_STAGE_COUNT; i++) {
+        if (stage_info[i].tools & tool) {
+            fprintf(out, "%s\"%s\": %.3f", sep, stage_info[i].name, (double)stats->stage_ns[i] / 1e6);
+            sep = ", ";
+        }
+    }
+    fprintf(out, "}}\n");
+    if (path && fclose(out) != 0) {
+        fprintf(stderr, "Error: Could not write %s\n", path);
+        return 0;
+    }
+    return 1;
+}
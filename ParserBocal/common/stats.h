@@ -0,0 +1,103 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   stats.h                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:12:58 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:15:52 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef STATS_H
+# define STATS_H
+
+#include <stdint.h>
+
+// Counters and stage timers of one run, reported as JSON with --stats. The
+// tools only count when the thread has a Stats installed in stats_current,
+// so the library and runs without --stats pay a test of a NULL pointer.
+
+// Tools that report a counter or a stage
+#define STATS_JB 1
+#define STATS_JV 2
+#define STATS_JC 4
+
+typedef enum {
+    STAT_LINES_READ,                // CSV records for JV and JC
+    STAT_RECORDS_PARSED,            // operations (JB), days (JV, JC)
+    STAT_SKIPPED_HEADER,            // lines up to the column headers
+    STAT_SKIPPED_EMPTY,
+    STAT_SKIPPED_NOT_DATE,          // first field is not a date
+    STAT_SKIPPED_CONTINUATION,      // "";"..." line that follows no operation
+    STAT_SKIPPED_SHORT,             // fewer fields than an operation
+    STAT_SKIPPED_UNCLASSIFIED,      // no operation rule
+    STAT_SKIPPED_NO_WITHDRAWAL,     // day without or with a zero withdrawal (JC)
+    STAT_SKIPPED_NO_SALES,          // day without sales (JV)
+    STAT_BRANCH_REMISE_CB,          // templates taken by convert_to_journal_entries
+    STAT_BRANCH_CARTE,
+    STAT_BRANCH_DEBIT,
+    STAT_BRANCH_CREDIT,
+    STAT_SUB_RULE_HITS,             // merchant or creditor rules that matched
+    STAT_LABEL_WORD_SEARCHES,       // card labels searched word by word in the chart
+    STAT_FALLBACK_RULE_DEFAULT,     // account missing from the chart, rule default used
+    STAT_FALLBACK_401,              // account missing from the chart, 401<LABEL> built
+    STAT_HISTORY_HITS,              // accounts found in the labels of past journals
+    STAT_CHART_LOOKUPS,
+    STAT_CHART_HITS,
+    STAT_CHART_LOOKUP_NS,
+    STAT_VAT_CELLS,                 // TVA detail cells of the sales export
+    STAT_UNMATCHED_DAYS,            // sales days without payments, split 80/20
+    STAT_ADJUSTED_DAYS,             // payments scaled to the sales total
+    STAT_ENTRIES_WRITTEN,           // journal rows
+    STAT_BYTES_WRITTEN,
+    STAT_COUNTER_COUNT
+} StatCounter;
+
+typedef enum {
+    STAT_STAGE_LOAD_CHART,
+    STAT_STAGE_LOAD_RULES,
+    STAT_STAGE_READ,
+    STAT_STAGE_PARSE,
+    STAT_STAGE_CLASSIFY,
+    STAT_STAGE_WRITE,
+    STAT_STAGE_COUNT
+} StatStage;
+
+typedef struct {
+    uint64_t counters[STAT_COUNTER_COUNT];
+    uint64_t stage_ns[STAT_STAGE_COUNT];
+    uint64_t start;                 // stats_now() when the run started
+    uint64_t lap;                   // end of the last timed step
+} Stats;
+
+// Stats of the run on this thread, NULL when not counting
+extern _Thread_local Stats *stats_current;
+
+#define STATS_ADD(counter, n) \
+    do { if (stats_current) stats_current->counters[counter] += (uint64_t)(n); } while (0)
+
+// Charge the time since the last lap to a stage; STATS_LAP_START starts the clock
+#define STATS_LAP(stage) do { if (stats_current) stats_lap(stats_current, stage); } while (0)
+#define STATS_LAP_START() do { if (stats_current) stats_current->lap = stats_now(); } while (0)
+
+// Monotonic clock in nanoseconds
+uint64_t stats_now(void);
+
+// Reset the stats, start the run clock and count on this thread
+void stats_start(Stats *stats);
+
+void stats_lap(Stats *stats, StatStage stage);
+
+// Add the counters and stage times of a worker to the run
+void stats_merge(Stats *into, const Stats *from);
+
+// Recognize --stats (report on stderr) and --stats=FILE (appended to FILE);
+// returns 0 for other arguments
+int stats_option(const char *arg, const char **path);
+
+// Write the report of `tool` as one line of JSON, to stderr or appended to path
+int stats_report(const Stats *stats, int tool, const char *input, int ok, const char *path);
+
+#endif
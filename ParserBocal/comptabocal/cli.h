@@ -0,0 +1,36 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   cli.h                                              :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:50:17 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:26:06 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CLI_H
+# define CLI_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../lib/comptabocal.h"
+
+// Socket of the conversion service: $COMPTABOCAL_SOCKET, else /tmp/comptabocal-<uid>.sock
+void default_socket_path(char *out, size_t size);
+
+// comptabocal serve [--socket path]
+int run_serve(const char *program_name, int argc, char *argv[]);
+
+// comptabocal year [-j threads] [--year YYYY] [--chart file] [--rules file] [--manifest file] <folder>
+int run_year(const char *program_name, int argc, char *argv[]);
+
+// comptabocal ledger [-o dir] <journal|folder>...
+int run_ledger(const char *program_name, int argc, char *argv[]);
+
+// comptabocal lettrage [-o dir] [--window days] [--max-group n] <client folder|journal>...
+int run_lettrage(const char *program_name, int argc, char *argv[]);
+
+#endif
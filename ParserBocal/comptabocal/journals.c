@@ -0,0 +1,241 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   journals.c                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:26:06 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:41:44 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "journals.h"
+
+#define JOURNAL_READ_SIZE (1 << 20)
+#define JOURNAL_MAX_FIELDS 32
+
+static int journal_list_file(JournalList *list, const char *path) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 64;
+        JournalFile *grown = realloc(list->files, (size_t)capacity * sizeof(JournalFile));
+        if (!grown)
+            return 0;
+        list->files = grown;
+        list->capacity = capacity;
+    }
+    JournalFile *file = &list->files[list->count];
+    file->path = strdup(path);
+    file->order = DATE_DAY_FIRST;
+    if (!file->path)
+        return 0;
+    list->count++;
+    return 1;
+}
+
+// Journals of a folder and its subfolders: the CSV files named Journal*
+static int journal_list_walk(JournalList *list, const char *dir) {
+    struct dirent **names;
+    int count = scandir(dir, &names, NULL, alphasort);
+    int ok = count >= 0;
+
+    for (int i = 0; i < count; i++) {
+        const char *name = names[i]->d_name;
+        char path[JOURNAL_PATH_SIZE];
+        struct stat st;
+        size_t len = strlen(name);
+        int n = snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+        if (ok && name[0] != '.' && n > 0 && (size_t)n < sizeof(path) && stat(path, &st) == 0) {
+            if (S_ISDIR(st.st_mode))
+                ok = journal_list_walk(list, path);
+            else if (strncasecmp(name, "journal", 7) == 0 && len > 4 && strcasecmp(name + len - 4, ".csv") == 0)
+                ok = journal_list_file(list, path);
+        }
+        free(names[i]);
+    }
+    free(names);
+    return ok;
+}
+
+int journal_list_add(JournalList *list, const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "Warning: Could not open %s\n", path);
+        return 1;
+    }
+    return S_ISDIR(st.st_mode) ? journal_list_walk(list, path) : journal_list_file(list, path);
+}
+
+void journal_list_free(JournalList *list) {
+    for (int i = 0; i < list->count; i++)
+        free(list->files[i].path);
+    free(list->files);
+    memset(list, 0, sizeof(*list));
+}
+
+int journal_open(JournalReader *reader, const char *path) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = open(path, O_RDONLY);
+    reader->cap = JOURNAL_READ_SIZE;
+    reader->buf = malloc(reader->cap + 1);
+    if (reader->fd < 0 || !reader->buf) {
+        if (reader->fd >= 0) close(reader->fd);
+        free(reader->buf);
+        return 0;
+    }
+    return 1;
+}
+
+void journal_close(JournalReader *reader) {
+    close(reader->fd);
+    free(reader->buf);
+}
+
+// Next line, NUL-terminated without its newline and carriage return, NULL at the end
+static char *journal_line(JournalReader *reader, size_t *len) {
+    for (;;) {
+        char *line = reader->buf + reader->start;
+        char *eol = memchr(line, '\n', reader->end - reader->start);
+        if (eol || (reader->eof && reader->start < reader->end)) {
+            char *end = eol ? eol : reader->buf + reader->end;
+            reader->start = (size_t)(end - reader->buf) + (eol ? 1 : 0);
+            if (end > line && end[-1] == '\r') end--;
+            *end = '\0';
+            *len = (size_t)(end - line);
+            return line;
+        }
+        if (reader->eof)
+            return NULL;
+        memmove(reader->buf, line, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+        if (reader->end == reader->cap) {
+            char *grown = realloc(reader->buf, reader->cap * 2 + 1);
+            if (!grown)
+                return NULL;
+            reader->buf = grown;
+            reader->cap *= 2;
+        }
+        ssize_t n = read(reader->fd, reader->buf + reader->end, reader->cap - reader->end);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            reader->eof = 1;
+        else
+            reader->end += (size_t)n;
+    }
+}
+
+static Slice trim(Slice s) {
+    while (s.len > 0 && (s.ptr[s.len - 1] == ' ' || s.ptr[s.len - 1] == '"')) s.len--;
+    while (s.len > 0 && (*s.ptr == ' ' || *s.ptr == '"')) { s.ptr++; s.len--; }
+    return s;
+}
+
+// Columns of a journal header, 0 when one is missing (Journal may be)
+static int parse_header(const char *line, size_t len, int *columns) {
+    static const char *const names[JOURNAL_COL_COUNT][2] = {
+        [JOURNAL_COL_JOURNAL] = {"journal", NULL}, [JOURNAL_COL_JOUR] = {"jour", "date"},
+        [JOURNAL_COL_COMPTE] = {"cpte", "compte"}, [JOURNAL_COL_LIBELLE] = {"libelle", "libellé"},
+        [JOURNAL_COL_DEBIT] = {"debit", "débit"}, [JOURNAL_COL_CREDIT] = {"credit", "crédit"},
+    };
+    const char *p = line, *end = line + len;
+    int index = 0;
+
+    for (int c = 0; c < JOURNAL_COL_COUNT; c++)
+        columns[c] = -1;
+    while (p <= end) {
+        const char *sep = memchr(p, ';', (size_t)(end - p));
+        Slice field = trim(slice_between(p, sep ? sep : end));
+        for (int c = 0; c < JOURNAL_COL_COUNT; c++) {
+            for (int n = 0; n < 2; n++) {
+                if (names[c][n] && strlen(names[c][n]) == field.len &&
+                    strncasecmp(field.ptr, names[c][n], field.len) == 0)
+                    columns[c] = index;
+            }
+        }
+        index++;
+        if (!sep)
+            break;
+        p = sep + 1;
+    }
+    for (int c = 0; c < JOURNAL_COL_COUNT; c++) {
+        if (columns[c] < 0 && c != JOURNAL_COL_JOURNAL)
+            return 0;
+    }
+    return index;
+}
+
+// Fields of a row in header order; extra separators belong to the libelle
+static int split_row(char *line, size_t len, const int *columns, int column_count, Slice *row) {
+    Slice fields[JOURNAL_MAX_FIELDS];
+    int count = 0;
+    char *p = line, *end = line + len;
+
+    while (count < JOURNAL_MAX_FIELDS) {
+        char *sep = memchr(p, ';', (size_t)(end - p));
+        fields[count++] = slice_between(p, sep ? sep : end);
+        if (!sep)
+            break;
+        p = sep + 1;
+    }
+    if (count < column_count)
+        return 0;
+    int extra = count - column_count;
+    int libelle = columns[JOURNAL_COL_LIBELLE];
+    for (int c = 0; c < JOURNAL_COL_COUNT; c++) {
+        int i = columns[c];
+        if (i < 0)
+            row[c] = SLICE_LIT("");
+        else if (i < libelle)
+            row[c] = fields[i];
+        else if (i > libelle)
+            row[c] = fields[i + extra];
+        else
+            row[c] = slice_between(fields[i].ptr, fields[i + extra].ptr + fields[i + extra].len);
+        if (c != JOURNAL_COL_LIBELLE)
+            row[c] = trim(row[c]);
+    }
+    return row[JOURNAL_COL_COMPTE].len > 0;
+}
+
+int journal_next(JournalReader *reader, Slice *row) {
+    char *line;
+    size_t len;
+
+    while ((line = journal_line(reader, &len))) {
+        if (!reader->column_count)
+            reader->column_count = parse_header(line, len, reader->columns);
+        else if (split_row(line, len, reader->columns, reader->column_count, row))
+            return 1;
+    }
+    return 0;
+}
+
+int journal_detect(JournalFile *file) {
+    JournalReader reader;
+    DateSniffer sniffer = {0};
+    Slice row[JOURNAL_COL_COUNT];
+
+    if (!journal_open(&reader, file->path))
+        return 0;
+    while (sniffer.count < DATE_SAMPLE_DATES && journal_next(&reader, row))
+        date_sniff(&sniffer, row[JOURNAL_COL_JOUR].ptr, row[JOURNAL_COL_JOUR].len);
+    journal_close(&reader);
+    file->order = date_sniff_order(&sniffer, DATE_DAY_FIRST);
+    return 1;
+}
+
+int journal_date(const JournalFile *file, Slice jour, Day *day) {
+    return date_parse(jour.ptr, jour.len, file->order, day);
+}
@@ -0,0 +1,78 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   journals.h                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:26:06 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:41:44 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef JOURNALS_H
+# define JOURNALS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../common/slice.h"
+#include "../common/dates.h"
+
+// Journals written by the tools (BP, VE, CA), read back row by row by the
+// ledger and the lettrage. Columns come from the header of each journal, so
+// both layouts work: Journal;Jour;cpte;Libelle;... and Journal;Jour;Libelle;cpte;...
+
+#define JOURNAL_PATH_SIZE 4096
+
+typedef enum {
+    JOURNAL_COL_JOURNAL,
+    JOURNAL_COL_JOUR,
+    JOURNAL_COL_COMPTE,
+    JOURNAL_COL_LIBELLE,
+    JOURNAL_COL_DEBIT,
+    JOURNAL_COL_CREDIT,
+    JOURNAL_COL_COUNT
+} JournalColumn;
+
+typedef struct {
+    char *path;
+    DateOrder order;        // of the Jour column, see journal_detect
+} JournalFile;
+
+typedef struct {
+    JournalFile *files;
+    int count;
+    int capacity;
+} JournalList;
+
+// Lines of a file read through a fixed buffer, which only grows for a longer line
+typedef struct {
+    int fd;
+    char *buf;
+    size_t cap;
+    size_t start;
+    size_t end;
+    int eof;
+    int columns[JOURNAL_COL_COUNT];
+    int column_count;       // fields of the header, 0 until it is read
+} JournalReader;
+
+// Add a journal, or the Journal*.csv files of a folder and its subfolders
+int journal_list_add(JournalList *list, const char *path);
+void journal_list_free(JournalList *list);
+
+int journal_open(JournalReader *reader, const char *path);
+void journal_close(JournalReader *reader);
+
+// Next row of the journal in row[JOURNAL_COL_COUNT], in header order; the
+// header and rows without an account are skipped. Returns 0 at the end.
+int journal_next(JournalReader *reader, Slice *row);
+
+// Order of the dates of a journal from its first rows: the tools write
+// DD/MM/YYYY, older sales journals MM/DD/YYYY. Returns 0 if it cannot be read.
+int journal_detect(JournalFile *file);
+
+// Day of the Jour cell of a row of the file, 0 (and DATE_NONE) if it is no date
+int journal_date(const JournalFile *file, Slice jour, Day *day);
+
+#endif
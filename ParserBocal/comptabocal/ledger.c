@@ -0,0 +1,522 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ledger.c                                           :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:21:06 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:41:44 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "cli.h"
+#include "journals.h"
+#include "../common/money.h"
+
+// General ledger (grand livre) and trial balance (balance) of any set of
+// journals written by the tools: BP from JB, VE from JV, CA from JC. Memory
+// follows the number of accounts, not the number of rows:
+//
+//  1. The journals are streamed once. An open addressing table keyed by the
+//     account sums its debits and credits and the bytes of its ledger rows.
+//  2. The accounts are sorted, which gives each one its region of the ledger
+//     file, sized up front. The journals are streamed again and each row is
+//     appended to its account's buffer, written with pwrite at the account's
+//     cursor when full. The balance is written from the table.
+//  3. Rows reach an account in the order of the journals. An account whose
+//     rows came out of date order has its region read back and sorted;
+//     only that region is in memory.
+//
+// Dates are written DD/MM/YYYY. A journal whose dates have a second field
+// above 12 (the sales exports of the cash register) is read as MM/DD/YYYY.
+
+#define LEDGER_ROW_MAX (1 << 20)
+#define LEDGER_BUFFER_BUDGET (64u << 20)  // account buffers of pass 2, all together
+#define LEDGER_BUFFER_MIN 512
+#define LEDGER_BUFFER_MAX (64 << 10)
+#define LEDGER_HEADER "Compte;Jour;Journal;Libelle;Debit;Credit;Solde\n"
+#define BALANCE_HEADER "Compte;Debit;Credit;Solde debiteur;Solde crediteur\n"
+
+typedef struct {
+    uint64_t hash;          // 0 marks an empty slot
+    uint32_t name;          // offset of the account number in the strings
+    Money debit;
+    Money credit;
+    long long rows;
+    long long bytes;        // ledger rows, total line excluded
+    long long offset;       // start of the region in the ledger
+    long long cursor;       // next write in the region
+    Day last_day;           // of the last row written
+    int unsorted;
+    char *pending;          // rows not written yet
+    size_t pending_len;
+} LedgerAccount;
+
+typedef struct {
+    JournalList journals;
+    char *strings;
+    size_t strings_len;
+    size_t strings_cap;
+    LedgerAccount *slots;
+    size_t mask;
+    int count;
+    size_t buffer_size;     // of each account in pass 2
+    int ledger_fd;
+    long long rows;
+} Ledger;
+
+static uint64_t hash_account(const char *s, size_t len) {
+    // 64-bit FNV-1a, never 0 which marks an empty slot
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ull;
+    }
+    return h ? h : 1;
+}
+
+static const char *account_name(const Ledger *ledger, const LedgerAccount *account) {
+    return ledger->strings + account->name;
+}
+
+static size_t find_slot(const Ledger *ledger, uint64_t hash, Slice name) {
+    size_t i = (size_t)hash & ledger->mask;
+    while (ledger->slots[i].hash) {
+        const char *known = ledger->strings + ledger->slots[i].name;
+        if (ledger->slots[i].hash == hash && strncmp(known, name.ptr, name.len) == 0 && known[name.len] == '\0')
+            break;
+        i = (i + 1) & ledger->mask;
+    }
+    return i;
+}
+
+static int grow_table(Ledger *ledger) {
+    size_t size = ledger->slots ? (ledger->mask + 1) * 2 : 1024;
+    LedgerAccount *slots = calloc(size, sizeof(LedgerAccount));
+    if (!slots)
+        return 0;
+    for (size_t i = 0; ledger->slots && i <= ledger->mask; i++) {
+        if (!ledger->slots[i].hash)
+            continue;
+        size_t j = (size_t)ledger->slots[i].hash & (size - 1);
+        while (slots[j].hash)
+            j = (j + 1) & (size - 1);
+        slots[j] = ledger->slots[i];
+    }
+    free(ledger->slots);
+    ledger->slots = slots;
+    ledger->mask = size - 1;
+    return 1;
+}
+
+// Account of the table, added on first sight; NULL when out of memory
+static LedgerAccount *ledger_account(Ledger *ledger, Slice name) {
+    uint64_t hash = hash_account(name.ptr, name.len);
+    size_t slot = find_slot(ledger, hash, name);
+
+    if (ledger->slots[slot].hash)
+        return &ledger->slots[slot];
+    if ((size_t)(ledger->count + 1) * 2 > ledger->mask + 1) {
+        if (!grow_table(ledger))
+            return NULL;
+        slot = find_slot(ledger, hash, name);
+    }
+    if (ledger->strings_len + name.len + 1 > ledger->strings_cap) {
+        size_t cap = ledger->strings_cap ? ledger->strings_cap * 2 : 4096;
+        while (cap < ledger->strings_len + name.len + 1)
+            cap *= 2;
+        char *grown = realloc(ledger->strings, cap);
+        if (!grown)
+            return NULL;
+        ledger->strings = grown;
+        ledger->strings_cap = cap;
+    }
+    LedgerAccount *account = &ledger->slots[slot];
+    account->hash = hash;
+    account->last_day = DATE_NONE;
+    account->name = (uint32_t)ledger->strings_len;
+    memcpy(ledger->strings + ledger->strings_len, name.ptr, name.len);
+    ledger->strings[ledger->strings_len + name.len] = '\0';
+    ledger->strings_len += name.len + 1;
+    ledger->count++;
+    return account;
+}
+
+static size_t amount_text(Slice cell, char *out) {
+    Money amount;
+    if (cell.len == 0 || !money_parse(cell.ptr, cell.len, &amount)) {
+        out[0] = '\0';
+        return 0;
+    }
+    return money_format(amount, out);
+}
+
+static Money cell_amount(Slice cell) {
+    Money amount = 0;
+    if (cell.len)
+        money_parse(cell.ptr, cell.len, &amount);
+    return amount;
+}
+
+// Jour of a row written DD/MM/YYYY whatever the order of its journal, kept
+// as it is when it is no date; returns its length
+static size_t jour_text(const JournalFile *file, Slice jour, char *out, Day *day) {
+    if (journal_date(file, jour, day))
+        return date_format(*day, out);
+    memcpy(out, jour.ptr, jour.len);
+    return jour.len;
+}
+
+// Ledger row of a journal row in out, returns its length; out holds len + 2 * MONEY_TEXT_SIZE + 16
+static size_t format_row(const JournalFile *file, const Slice *row, char *out, Day *day) {
+    char debit[MONEY_TEXT_SIZE], credit[MONEY_TEXT_SIZE];
+    size_t n = 0;
+
+    memcpy(out + n, row[JOURNAL_COL_COMPTE].ptr, row[JOURNAL_COL_COMPTE].len);
+    n += row[JOURNAL_COL_COMPTE].len;
+    out[n++] = ';';
+    n += jour_text(file, row[JOURNAL_COL_JOUR], out + n, day);
+    out[n++] = ';';
+    memcpy(out + n, row[JOURNAL_COL_JOURNAL].ptr, row[JOURNAL_COL_JOURNAL].len);
+    n += row[JOURNAL_COL_JOURNAL].len;
+    out[n++] = ';';
+    memcpy(out + n, row[JOURNAL_COL_LIBELLE].ptr, row[JOURNAL_COL_LIBELLE].len);
+    n += row[JOURNAL_COL_LIBELLE].len;
+    out[n++] = ';';
+    size_t len = amount_text(row[JOURNAL_COL_DEBIT], debit);
+    memcpy(out + n, debit, len);
+    n += len;
+    out[n++] = ';';
+    len = amount_text(row[JOURNAL_COL_CREDIT], credit);
+    memcpy(out + n, credit, len);
+    n += len;
+    out[n++] = ';';
+    out[n++] = '\n';
+    return n;
+}
+
+// Total line closing the region of an account
+static size_t format_total(const Ledger *ledger, const LedgerAccount *account, char *out, size_t size) {
+    char debit[MONEY_TEXT_SIZE], credit[MONEY_TEXT_SIZE], balance[MONEY_TEXT_SIZE];
+    money_format(account->debit, debit);
+    money_format(account->credit, credit);
+    money_format(account->debit - account->credit, balance);
+    int n = snprintf(out, size, "%s;;;Total %s;%s;%s;%s\n", account_name(ledger, account),
+                     account_name(ledger, account), debit, credit, balance);
+    return n > 0 && (size_t)n < size ? (size_t)n : 0;
+}
+
+typedef int (*RowFunc)(Ledger *ledger, JournalFile *file, const Slice *row);
+
+// Stream the rows of every journal through func
+static int ledger_scan(Ledger *ledger, RowFunc func) {
+    for (int f = 0; f < ledger->journals.count; f++) {
+        JournalFile *file = &ledger->journals.files[f];
+        JournalReader reader;
+        Slice row[JOURNAL_COL_COUNT];
+
+        if (!journal_open(&reader, file->path)) {
+            fprintf(stderr, "Error: Could not read %s\n", file->path);
+            return 0;
+        }
+        while (journal_next(&reader, row)) {
+            if (!func(ledger, file, row)) {
+                journal_close(&reader);
+                return 0;
+            }
+        }
+        journal_close(&reader);
+        if (!reader.column_count)
+            fprintf(stderr, "Warning: No journal header in %s\n", file->path);
+    }
+    return 1;
+}
+
+// Pass 1: totals and row sizes
+static int count_row(Ledger *ledger, JournalFile *file, const Slice *row) {
+    LedgerAccount *account = ledger_account(ledger, row[JOURNAL_COL_COMPTE]);
+    char debit[MONEY_TEXT_SIZE], credit[MONEY_TEXT_SIZE], jour[DATE_TEXT_SIZE];
+    Day day;
+
+    if (!account)
+        return 0;
+    account->debit += cell_amount(row[JOURNAL_COL_DEBIT]);
+    account->credit += cell_amount(row[JOURNAL_COL_CREDIT]);
+    account->rows++;
+    size_t jour_len = journal_date(file, row[JOURNAL_COL_JOUR], &day) ? date_format(day, jour) : row[JOURNAL_COL_JOUR].len;
+    account->bytes += (long long)(row[JOURNAL_COL_COMPTE].len + jour_len + row[JOURNAL_COL_JOURNAL].len +
+                                  row[JOURNAL_COL_LIBELLE].len + amount_text(row[JOURNAL_COL_DEBIT], debit) +
+                                  amount_text(row[JOURNAL_COL_CREDIT], credit) + 7);
+    ledger->rows++;
+    return 1;
+}
+
+static int flush_account(Ledger *ledger, LedgerAccount *account) {
+    size_t done = 0;
+    while (done < account->pending_len) {
+        ssize_t n = pwrite(ledger->ledger_fd, account->pending + done, account->pending_len - done,
+                           (off_t)account->cursor);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        done += (size_t)n;
+        account->cursor += n;
+    }
+    account->pending_len = 0;
+    return 1;
+}
+
+// Pass 2: each row appended to the region of its account
+static int write_row(Ledger *ledger, JournalFile *file, const Slice *row) {
+    LedgerAccount *account = &ledger->slots[find_slot(ledger, hash_account(row[JOURNAL_COL_COMPTE].ptr,
+                                                                             row[JOURNAL_COL_COMPTE].len), row[JOURNAL_COL_COMPTE])];
+    size_t max = row[JOURNAL_COL_COMPTE].len + row[JOURNAL_COL_JOUR].len + row[JOURNAL_COL_JOURNAL].len + row[JOURNAL_COL_LIBELLE].len +
+                 2 * MONEY_TEXT_SIZE + 16;
+
+    if (!account->pending) {
+        account->pending = malloc(ledger->buffer_size);
+        if (!account->pending)
+            return 0;
+    }
+    if (account->pending_len + max > ledger->buffer_size && !flush_account(ledger, account))
+        return 0;
+    char *out = account->pending + account->pending_len;
+    static char big[LEDGER_ROW_MAX];
+    if (max > ledger->buffer_size) {
+        // A row longer than the buffer goes straight to the file
+        if (max > sizeof(big))
+            return 0;
+        out = big;
+    }
+    Day day;
+    size_t len = format_row(file, row, out, &day);
+    if (day < account->last_day)
+        account->unsorted = 1;
+    account->last_day = day;
+    if (out == big) {
+        if (pwrite(ledger->ledger_fd, big, len, (off_t)account->cursor) != (ssize_t)len)
+            return 0;
+        account->cursor += (long long)len;
+    } else {
+        account->pending_len += len;
+    }
+    return 1;
+}
+
+typedef struct {
+    Day day;
+    uint32_t index;         // position in the journals, keeps equal dates in order
+    const char *line;
+    size_t len;
+} SortLine;
+
+static int compare_lines(const void *a, const void *b) {
+    const SortLine *x = a, *y = b;
+    if (x->day != y->day) return x->day < y->day ? -1 : 1;
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+// Pass 3: put the rows of an account back in date order
+static int sort_region(Ledger *ledger, const LedgerAccount *account, size_t name_len) {
+    size_t size = (size_t)account->bytes;
+    char *region = malloc(size ? size : 1);
+    char *sorted = malloc(size ? size : 1);
+    SortLine *lines = malloc((size_t)account->rows * sizeof(SortLine));
+    int ok = region && sorted && lines &&
+             pread(ledger->ledger_fd, region, size, (off_t)account->offset) == (ssize_t)size;
+
+    size_t count = 0;
+    for (char *p = region; ok && p < region + size && count < (size_t)account->rows; count++) {
+        char *eol = memchr(p, '\n', (size_t)(region + size - p));
+        size_t len = eol ? (size_t)(eol - p) + 1 : (size_t)(region + size - p);
+        char *jour = p + name_len + 1;
+        char *end = len > name_len + 1 ? memchr(jour, ';', len - name_len - 1) : NULL;
+        if (!end || !date_parse(jour, (size_t)(end - jour), DATE_DAY_FIRST, &lines[count].day))
+            lines[count].day = DATE_NONE;
+        lines[count].index = (uint32_t)count;
+        lines[count].line = p;
+        lines[count].len = len;
+        p += len;
+    }
+    if (ok) {
+        qsort(lines, count, sizeof(SortLine), compare_lines);
+        size_t n = 0;
+        for (size_t i = 0; i < count; i++) {
+            memcpy(sorted + n, lines[i].line, lines[i].len);
+            n += lines[i].len;
+        }
+        ok = pwrite(ledger->ledger_fd, sorted, n, (off_t)account->offset) == (ssize_t)n;
+    }
+    free(region);
+    free(sorted);
+    free(lines);
+    return ok;
+}
+
+static Ledger *sort_ledger;
+
+static int compare_accounts(const void *a, const void *b) {
+    const LedgerAccount *x = *(LedgerAccount *const *)a, *y = *(LedgerAccount *const *)b;
+    return strcmp(account_name(sort_ledger, x), account_name(sort_ledger, y));
+}
+
+static int write_balance(const Ledger *ledger, LedgerAccount **order, const char *path) {
+    FILE *out = fopen(path, "w");
+    char debit[MONEY_TEXT_SIZE], credit[MONEY_TEXT_SIZE], balance[MONEY_TEXT_SIZE];
+    Money total_debit = 0, total_credit = 0, total_db = 0, total_cr = 0;
+
+    if (!out)
+        return 0;
+    fputs(BALANCE_HEADER, out);
+    for (int i = 0; i < ledger->count; i++) {
+        const LedgerAccount *account = order[i];
+        Money solde = account->debit - account->credit;
+        money_format(account->debit, debit);
+        money_format(account->credit, credit);
+        money_format(money_abs(solde), balance);
+        fprintf(out, "%s;%s;%s;%s;%s\n", account_name(ledger, account), debit, credit,
+                solde > 0 ? balance : "", solde < 0 ? balance : "");
+        total_debit += account->debit;
+        total_credit += account->credit;
+        if (solde > 0) total_db += solde;
+        else total_cr -= solde;
+    }
+    money_format(total_debit, debit);
+    money_format(total_credit, credit);
+    fprintf(out, "Total;%s;%s;", debit, credit);
+    money_format(total_db, balance);
+    fprintf(out, "%s;", balance);
+    money_format(total_cr, balance);
+    fprintf(out, "%s\n", balance);
+    return fclose(out) == 0;
+}
+
+static double ledger_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void ledger_usage(const char *program_name) {
+    printf("Usage: %s ledger [-o dir] <journal|folder>...\n", program_name);
+    printf("Adds up the journals (the Journal*.csv files of the folders) into a general ledger,\n");
+    printf("\"Grand livre.csv\", rows by account then date with a total per account, and a trial\n");
+    printf("balance, \"Balance.csv\", written in dir (default: the current directory).\n");
+}
+
+int run_ledger(const char *program_name, int argc, char *argv[]) {
+    Ledger ledger;
+    const char *out_dir = ".";
+    char ledger_path[JOURNAL_PATH_SIZE], balance_path[JOURNAL_PATH_SIZE];
+    int paths = 0;
+
+    memset(&ledger, 0, sizeof(ledger));
+    ledger.ledger_fd = -1;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (argv[i][0] == '-') {
+            ledger_usage(program_name);
+            journal_list_free(&ledger.journals);
+            return 1;
+        } else {
+            if (!journal_list_add(&ledger.journals, argv[i])) {
+                fprintf(stderr, "Error: Could not list the journals of %s\n", argv[i]);
+                journal_list_free(&ledger.journals);
+                return 2;
+            }
+            paths++;
+        }
+    }
+    if (!paths) {
+        ledger_usage(program_name);
+        return 1;
+    }
+    if (ledger.journals.count == 0) {
+        fprintf(stderr, "Error: No journal found\n");
+        return 2;
+    }
+    snprintf(ledger_path, sizeof(ledger_path), "%s/Grand livre.csv", out_dir);
+    snprintf(balance_path, sizeof(balance_path), "%s/Balance.csv", out_dir);
+
+    double start = ledger_now();
+    int ok = grow_table(&ledger);
+    for (int f = 0; ok && f < ledger.journals.count; f++) {
+        // Date order of each journal, from its first rows
+        ok = journal_detect(&ledger.journals.files[f]);
+        if (!ok)
+            fprintf(stderr, "Error: Could not read %s\n", ledger.journals.files[f].path);
+    }
+    ok = ok && ledger_scan(&ledger, count_row);
+
+    // Regions of the accounts in account order, each closed by its total line
+    LedgerAccount **order = ok ? malloc((size_t)(ledger.count ? ledger.count : 1) * sizeof(LedgerAccount *)) : NULL;
+    ok = ok && order;
+    long long size = (long long)strlen(LEDGER_HEADER);
+    for (size_t i = 0, n = 0; ok && i <= ledger.mask; i++) {
+        if (ledger.slots[i].hash)
+            order[n++] = &ledger.slots[i];
+    }
+    if (ok) {
+        sort_ledger = &ledger;
+        qsort(order, (size_t)ledger.count, sizeof(LedgerAccount *), compare_accounts);
+        for (int i = 0; i < ledger.count; i++) {
+            char total[JOURNAL_PATH_SIZE];
+            order[i]->offset = order[i]->cursor = size;
+            size += order[i]->bytes + (long long)format_total(&ledger, order[i], total, sizeof(total));
+        }
+        size_t share = LEDGER_BUFFER_BUDGET / (size_t)(ledger.count ? ledger.count : 1);
+        ledger.buffer_size = share < LEDGER_BUFFER_MIN ? LEDGER_BUFFER_MIN
+                           : share > LEDGER_BUFFER_MAX ? LEDGER_BUFFER_MAX : share;
+        ledger.ledger_fd = open(ledger_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        ok = ledger.ledger_fd >= 0 && ftruncate(ledger.ledger_fd, (off_t)size) == 0 &&
+             pwrite(ledger.ledger_fd, LEDGER_HEADER, strlen(LEDGER_HEADER), 0) == (ssize_t)strlen(LEDGER_HEADER);
+        if (!ok)
+            fprintf(stderr, "Error: Could not create %s\n", ledger_path);
+    }
+
+    // Second pass, then the total lines and the regions out of date order
+    ok = ok && ledger_scan(&ledger, write_row);
+    int resorted = 0;
+    for (int i = 0; ok && i < ledger.count; i++) {
+        LedgerAccount *account = order[i];
+        char total[JOURNAL_PATH_SIZE];
+        ok = flush_account(&ledger, account);
+        if (ok && account->unsorted) {
+            ok = sort_region(&ledger, account, strlen(account_name(&ledger, account)));
+            resorted++;
+        }
+        size_t len = format_total(&ledger, account, total, sizeof(total));
+        ok = ok && pwrite(ledger.ledger_fd, total, len, (off_t)(account->offset + account->bytes)) == (ssize_t)len;
+        free(account->pending);
+        account->pending = NULL;
+    }
+    if (ledger.ledger_fd >= 0 && close(ledger.ledger_fd) != 0)
+        ok = 0;
+    if (ok && !write_balance(&ledger, order, balance_path)) {
+        fprintf(stderr, "Error: Could not write %s\n", balance_path);
+        ok = 0;
+    }
+    double seconds = ledger_now() - start;
+
+    if (ok) {
+        printf("Ledger: %d journal(s), %lld rows, %d account(s) (%d sorted again) in %.3f s\n",
+               ledger.journals.count, ledger.rows, ledger.count, resorted, seconds);
+        printf("Output written to %s and %s\n", ledger_path, balance_path);
+    } else {
+        fprintf(stderr, "Error: Could not build the ledger\n");
+    }
+    for (size_t i = 0; ledger.slots && i <= ledger.mask; i++)
+        free(ledger.slots[i].pending);
+    free(order);
+    journal_list_free(&ledger.journals);
+    free(ledger.slots);
+    free(ledger.strings);
+    return ok ? 0 : 4;
+}
@@ -0,0 +1,555 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   lettrage.c                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:26:06 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:41:44 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <ctype.h>
+#include <time.h>
+#include "cli.h"
+#include "journals.h"
+#include "../common/money.h"
+
+// Lettrage of the clearing accounts 580*. The takings of a day go through
+// 580 twice: JV debits 580CB with the card takings and JC debits 580 with
+// the cash taken out of the register ("Prlv caisse"), then JB credits it
+// when the bank pays: REMISE CB for the cards, VRST GAB for the cash
+// deposits. Every debit should meet its credits a few days later.
+//
+// Each client folder on the command line is a dossier, matched on its own.
+// Entries are split into card entries (libelle CB, or account 580CB) and
+// cash entries, debits first, credits within --window days after:
+//
+//  1. One debit, one credit of the same amount: credits are sorted by
+//     amount then date and found by binary search, the nearest date wins.
+//     A skip list over the sorted credits jumps over the ones matched, so
+//     runs of equal amounts (cash deposits of 100,00) stay linear.
+//  2. One credit, several debits: a remittance or a deposit covering
+//     several days. The unmatched debits of the window are searched for a
+//     subset of at most --max-group entries summing to the credit, nearest
+//     entries first so that the days just before a deposit are tried
+//     before older ones, with a bounded number of steps.
+//  3. One debit, several credits: the takings of a day paid in several
+//     remittances, one per card terminal.
+//
+// Sorting dominates; the subset search is bounded per entry, so a year of
+// daily entries for many shops stays n log n. Matched groups get a letter
+// (AAA, AAB, ...) and go to "Lettrage 580.csv", the rest to "Non lettre 580.csv".
+
+#define LETTRAGE_WINDOW 10             // days from a debit to its credits
+#define LETTRAGE_MAX_GROUP 6
+#define LETTRAGE_GROUP_LIMIT 8
+#define LETTRAGE_CANDIDATES 16         // nearest entries tried by the subset search
+#define LETTRAGE_SEARCH_STEPS 4096     // subsets tried per entry
+#define LETTRAGE_HEADER "Dossier;Lettre;Compte;Jour;Journal;Libelle;Debit;Credit\n"
+#define UNMATCHED_HEADER "Dossier;Compte;Jour;Journal;Libelle;Debit;Credit\n"
+
+typedef enum {
+    CLEARING_CARD,
+    CLEARING_CASH
+} ClearingKind;
+
+typedef struct {
+    Day day;
+    uint32_t text;          // "Compte;Jour;Journal;Libelle" in the strings
+    Money amount;           // always positive, the side says which
+    uint32_t letter;        // group number plus one, 0 while unmatched
+    uint16_t dossier;
+    uint8_t kind;
+    uint8_t credit;
+} ClearingEntry;
+
+typedef struct {
+    ClearingEntry *entries;
+    size_t count;
+    size_t capacity;
+    char *strings;
+    size_t strings_len;
+    size_t strings_cap;
+    int window;
+    int max_group;
+    uint32_t groups;        // letters handed out in the current dossier
+} Lettrage;
+
+// Entries of one dossier and kind, each side sorted by date
+typedef struct {
+    ClearingEntry *debits;
+    size_t debit_count;
+    ClearingEntry *credits;
+    size_t credit_count;
+} ClearingSet;
+
+static int is_card(Slice compte, Slice libelle) {
+    while (libelle.len > 0 && libelle.ptr[libelle.len - 1] == ' ') libelle.len--;
+    while (libelle.len > 0 && *libelle.ptr == ' ') { libelle.ptr++; libelle.len--; }
+    return (libelle.len == 2 && toupper((unsigned char)libelle.ptr[0]) == 'C' &&
+            toupper((unsigned char)libelle.ptr[1]) == 'B') ||
+           (compte.len >= 2 && toupper((unsigned char)compte.ptr[compte.len - 2]) == 'C' &&
+            toupper((unsigned char)compte.ptr[compte.len - 1]) == 'B');
+}
+
+static uint32_t lettrage_string(Lettrage *lettrage, const Slice *parts, int count) {
+    size_t len = 0;
+    for (int i = 0; i < count; i++)
+        len += parts[i].len + 1;
+    if (lettrage->strings_len + len > lettrage->strings_cap) {
+        size_t cap = lettrage->strings_cap ? lettrage->strings_cap * 2 : 65536;
+        while (cap < lettrage->strings_len + len)
+            cap *= 2;
+        char *grown = cap <= UINT32_MAX ? realloc(lettrage->strings, cap) : NULL;
+        if (!grown)
+            return UINT32_MAX;
+        lettrage->strings = grown;
+        lettrage->strings_cap = cap;
+    }
+    uint32_t offset = (uint32_t)lettrage->strings_len;
+    char *out = lettrage->strings + offset;
+    for (int i = 0; i < count; i++) {
+        memcpy(out, parts[i].ptr, parts[i].len);
+        out += parts[i].len;
+        *out++ = i + 1 < count ? ';' : '\0';
+    }
+    lettrage->strings_len += len;
+    return offset;
+}
+
+// The 580 entries of a journal, dates read in the order found from its first rows
+static int load_journal(Lettrage *lettrage, JournalFile *file, uint16_t dossier) {
+    JournalReader reader;
+    Slice row[JOURNAL_COL_COUNT];
+
+    if (!journal_detect(file) || !journal_open(&reader, file->path)) {
+        fprintf(stderr, "Error: Could not read %s\n", file->path);
+        return 0;
+    }
+    while (journal_next(&reader, row)) {
+        Slice compte = row[JOURNAL_COL_COMPTE];
+        Money debit = 0, credit = 0;
+        char jour[DATE_TEXT_SIZE];
+        Day day;
+
+        if (compte.len < 3 || memcmp(compte.ptr, "580", 3) != 0 || !journal_date(file, row[JOURNAL_COL_JOUR], &day))
+            continue;
+        if (row[JOURNAL_COL_DEBIT].len)
+            money_parse(row[JOURNAL_COL_DEBIT].ptr, row[JOURNAL_COL_DEBIT].len, &debit);
+        if (row[JOURNAL_COL_CREDIT].len)
+            money_parse(row[JOURNAL_COL_CREDIT].ptr, row[JOURNAL_COL_CREDIT].len, &credit);
+        if (debit == credit)
+            continue;
+        if (lettrage->count == lettrage->capacity) {
+            size_t capacity = lettrage->capacity ? lettrage->capacity * 2 : 4096;
+            ClearingEntry *grown = realloc(lettrage->entries, capacity * sizeof(ClearingEntry));
+            if (!grown) {
+                journal_close(&reader);
+                return 0;
+            }
+            lettrage->entries = grown;
+            lettrage->capacity = capacity;
+        }
+        // Dates written DD/MM/YYYY whatever the order of the journal
+        Slice parts[4] = {compte, slice_between(jour, jour + date_format(day, jour)), row[JOURNAL_COL_JOURNAL],
+                          row[JOURNAL_COL_LIBELLE]};
+        uint32_t text = lettrage_string(lettrage, parts, 4);
+        if (text == UINT32_MAX) {
+            journal_close(&reader);
+            return 0;
+        }
+        ClearingEntry *entry = &lettrage->entries[lettrage->count++];
+        entry->text = text;
+        entry->day = day;
+        entry->amount = money_abs(debit - credit);
+        entry->credit = credit > debit;
+        entry->letter = 0;
+        entry->dossier = dossier;
+        entry->kind = is_card(compte, row[JOURNAL_COL_LIBELLE]) ? CLEARING_CARD : CLEARING_CASH;
+    }
+    journal_close(&reader);
+    return 1;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const ClearingEntry *x = a, *y = b;
+    if (x->dossier != y->dossier) return x->dossier < y->dossier ? -1 : 1;
+    if (x->kind != y->kind) return x->kind < y->kind ? -1 : 1;
+    if (x->credit != y->credit) return x->credit < y->credit ? -1 : 1;
+    if (x->day != y->day) return x->day < y->day ? -1 : 1;
+    if (x->amount != y->amount) return x->amount < y->amount ? -1 : 1;
+    return x->text < y->text ? -1 : x->text > y->text;
+}
+
+
+static const ClearingEntry *sort_base;
+
+static int compare_by_amount(const void *a, const void *b) {
+    uint32_t i = *(const uint32_t *)a, j = *(const uint32_t *)b;
+    const ClearingEntry *x = &sort_base[i], *y = &sort_base[j];
+    if (x->amount != y->amount) return x->amount < y->amount ? -1 : 1;
+    if (x->day != y->day) return x->day < y->day ? -1 : 1;
+    return i < j ? -1 : i > j;
+}
+
+// First position from i on that is still free; matched positions point further
+static uint32_t next_free(uint32_t *next, uint32_t i) {
+    uint32_t root = i;
+    while (next[root] != root)
+        root = next[root];
+    while (next[i] != root) {
+        uint32_t up = next[i];
+        next[i] = root;
+        i = up;
+    }
+    return root;
+}
+
+static void letter_group(Lettrage *lettrage, ClearingEntry **group, int count) {
+    lettrage->groups++;
+    for (int i = 0; i < count; i++)
+        group[i]->letter = lettrage->groups;
+}
+
+// Pass 1: each debit with the free credit of the same amount nearest after it
+static int match_pairs(Lettrage *lettrage, ClearingSet *set) {
+    size_t n = set->credit_count;
+    uint32_t *order = malloc((n + 1) * sizeof(uint32_t));
+    uint32_t *next = malloc((n + 1) * sizeof(uint32_t));
+
+    if (!order || !next) {
+        free(order);
+        free(next);
+        return 0;
+    }
+    for (size_t i = 0; i <= n; i++)
+        order[i] = next[i] = (uint32_t)i;
+    sort_base = set->credits;
+    qsort(order, n, sizeof(uint32_t), compare_by_amount);
+
+    for (size_t d = 0; d < set->debit_count; d++) {
+        ClearingEntry *debit = &set->debits[d];
+        size_t lo = 0, hi = n;
+        // First credit of the amount dated on or after the debit
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            const ClearingEntry *credit = &set->credits[order[mid]];
+            if (credit->amount < debit->amount || (credit->amount == debit->amount && credit->day < debit->day))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        uint32_t pos = next_free(next, (uint32_t)lo);
+        if (pos == n)
+            continue;
+        ClearingEntry *credit = &set->credits[order[pos]];
+        if (credit->amount != debit->amount || credit->day > debit->day + lettrage->window)
+            continue;
+        ClearingEntry *group[2] = {debit, credit};
+        letter_group(lettrage, group, 2);
+        next[pos] = pos + 1;
+    }
+    free(order);
+    free(next);
+    return 1;
+}
+
+typedef struct {
+    ClearingEntry *candidates[LETTRAGE_CANDIDATES];
+    Money rest[LETTRAGE_CANDIDATES + 1];   // sum of the candidates from i on
+    int count;
+    ClearingEntry *chosen[LETTRAGE_GROUP_LIMIT + 1];  // and the entry matched
+    int max_group;
+    int steps;
+} SubsetSearch;
+
+// Candidates from i on summing to target with at most max_group - depth of them
+static int find_subset(SubsetSearch *search, int i, int depth, Money target) {
+    if (target == 0)
+        return depth;
+    if (depth == search->max_group || search->steps-- <= 0)
+        return 0;
+    for (; i < search->count && search->rest[i] >= target; i++) {
+        ClearingEntry *candidate = search->candidates[i];
+        if (candidate->amount > target)
+            continue;
+        search->chosen[depth] = candidate;
+        int found = find_subset(search, i + 1, depth + 1, target - candidate->amount);
+        if (found)
+            return found;
+        if (search->steps <= 0)
+            return 0;
+    }
+    return 0;
+}
+
+// Passes 2 and 3: each free entry of one side against a subset of the free
+// entries of the other side within the window, from -window to 0 days
+// around a credit, 0 to window days around a debit
+static void match_groups(Lettrage *lettrage, ClearingEntry *targets, size_t target_count,
+                         ClearingEntry *others, size_t other_count, int after) {
+    for (size_t t = 0; t < target_count; t++) {
+        ClearingEntry *target = &targets[t];
+        SubsetSearch search;
+        int32_t from = after ? target->day : target->day - lettrage->window;
+        int32_t to = after ? target->day + lettrage->window : target->day;
+
+        if (target->letter)
+            continue;
+        // Nearest first: forward from the debit, backward from the credit
+        size_t lo = 0, hi = other_count;
+        int32_t start = after ? from : to + 1;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (others[mid].day < start) lo = mid + 1;
+            else hi = mid;
+        }
+        search.count = 0;
+        for (size_t i = lo; after ? i < other_count : i > 0; after ? i++ : i--) {
+            ClearingEntry *other = after ? &others[i] : &others[i - 1];
+            if (other->day < from || other->day > to || search.count == LETTRAGE_CANDIDATES)
+                break;
+            if (!other->letter && other->amount <= target->amount)
+                search.candidates[search.count++] = other;
+        }
+        if (search.count < 2)
+            continue;
+        search.rest[search.count] = 0;
+        for (int i = search.count - 1; i >= 0; i--)
+            search.rest[i] = search.rest[i + 1] + search.candidates[i]->amount;
+        search.max_group = lettrage->max_group;
+        search.steps = LETTRAGE_SEARCH_STEPS;
+        int found = find_subset(&search, 0, 0, target->amount);
+        if (found) {
+            search.chosen[found] = target;
+            letter_group(lettrage, search.chosen, found + 1);
+        }
+    }
+}
+
+// Letters of the groups: AAA, AAB, ... ZZZ, then AAAA
+static void letter_code(uint32_t letter, char *out) {
+    uint32_t v = letter - 1;
+    uint64_t codes = 26 * 26 * 26;
+    int width = 3;
+
+    while (v >= codes) {
+        v -= (uint32_t)codes;
+        codes *= 26;
+        width++;
+    }
+    out[width] = '\0';
+    for (int i = width - 1; i >= 0; i--) {
+        out[i] = (char)('A' + v % 26);
+        v /= 26;
+    }
+}
+
+static int compare_report(const void *a, const void *b) {
+    const ClearingEntry *x = a, *y = b;
+    if (x->dossier != y->dossier) return x->dossier < y->dossier ? -1 : 1;
+    if (x->letter != y->letter) return x->letter < y->letter ? -1 : 1;
+    if (x->credit != y->credit) return x->credit < y->credit ? -1 : 1;
+    if (x->day != y->day) return x->day < y->day ? -1 : 1;
+    return x->text < y->text ? -1 : x->text > y->text;
+}
+
+static void write_entry(FILE *out, const Lettrage *lettrage, const ClearingEntry *entry) {
+    char amount[MONEY_TEXT_SIZE];
+    money_format(entry->amount, amount);
+    fprintf(out, "%s;%s;%s\n", lettrage->strings + entry->text, entry->credit ? "" : amount,
+            entry->credit ? amount : "");
+}
+
+// Both reports, and a line per dossier on stdout
+static int write_reports(const Lettrage *lettrage, char **dossiers, int dossier_count,
+                         const char *matched_path, const char *unmatched_path) {
+    FILE *matched = fopen(matched_path, "w");
+    FILE *unmatched = fopen(unmatched_path, "w");
+    size_t i = 0;
+
+    if (!matched || !unmatched) {
+        fprintf(stderr, "Error: Could not create %s\n", !matched ? matched_path : unmatched_path);
+        if (matched) fclose(matched);
+        if (unmatched) fclose(unmatched);
+        return 0;
+    }
+    fputs(LETTRAGE_HEADER, matched);
+    fputs(UNMATCHED_HEADER, unmatched);
+    for (int d = 0; d < dossier_count; d++) {
+        size_t entries = 0, open_debits = 0, open_credits = 0;
+        Money open_debit = 0, open_credit = 0;
+        uint32_t groups = 0;
+        char code[16], debit[MONEY_TEXT_SIZE], credit[MONEY_TEXT_SIZE];
+
+        for (; i < lettrage->count && lettrage->entries[i].dossier == d; i++) {
+            const ClearingEntry *entry = &lettrage->entries[i];
+            entries++;
+            if (entry->letter) {
+                letter_code(entry->letter, code);
+                fprintf(matched, "%s;%s;", dossiers[d], code);
+                write_entry(matched, lettrage, entry);
+                groups = entry->letter;
+                continue;
+            }
+            fprintf(unmatched, "%s;", dossiers[d]);
+            write_entry(unmatched, lettrage, entry);
+            if (entry->credit) {
+                open_credits++;
+                open_credit += entry->amount;
+            } else {
+                open_debits++;
+                open_debit += entry->amount;
+            }
+        }
+        money_format(open_debit, debit);
+        money_format(open_credit, credit);
+        printf("%s: %zu entries, %u groups, unmatched %zu debit(s) %s and %zu credit(s) %s\n",
+               dossiers[d], entries, groups, open_debits, debit, open_credits, credit);
+    }
+    int ok = !ferror(matched) && !ferror(unmatched);
+    ok = (fclose(matched) == 0) && ok;
+    ok = (fclose(unmatched) == 0) && ok;
+    if (!ok)
+        fprintf(stderr, "Error: Could not write the reports\n");
+    return ok;
+}
+
+// Every dossier and kind: pairs first, then the groups
+static int match_all(Lettrage *lettrage) {
+    size_t i = 0;
+    int dossier = -1;
+
+    while (i < lettrage->count) {
+        ClearingEntry *first = &lettrage->entries[i];
+        ClearingSet set;
+        size_t end = i;
+
+        if (first->dossier != dossier) {
+            dossier = first->dossier;
+            lettrage->groups = 0;
+        }
+        while (end < lettrage->count && lettrage->entries[end].dossier == first->dossier &&
+               lettrage->entries[end].kind == first->kind && !lettrage->entries[end].credit)
+            end++;
+        set.debits = first;
+        set.debit_count = end - i;
+        set.credits = &lettrage->entries[end];
+        while (end < lettrage->count && lettrage->entries[end].dossier == first->dossier &&
+               lettrage->entries[end].kind == first->kind)
+            end++;
+        set.credit_count = (size_t)(&lettrage->entries[end] - set.credits);
+        if (!match_pairs(lettrage, &set))
+            return 0;
+        match_groups(lettrage, set.credits, set.credit_count, set.debits, set.debit_count, 0);
+        match_groups(lettrage, set.debits, set.debit_count, set.credits, set.credit_count, 1);
+        i = end;
+    }
+    return 1;
+}
+
+static double lettrage_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void lettrage_usage(const char *program_name) {
+    printf("Usage: %s lettrage [-o dir] [--window days] [--max-group n] <client folder|journal>...\n",
+           program_name);
+    printf("Matches the 580 entries of the sales, cash and bank journals (the Journal*.csv files\n");
+    printf("of each client folder): card takings with their REMISE CB, cash withdrawals with their\n");
+    printf("deposits, the credits within --window days (default %d) after the debits, up to\n",
+           LETTRAGE_WINDOW);
+    printf("--max-group entries (default %d) for one. Writes \"Lettrage 580.csv\" and\n",
+           LETTRAGE_MAX_GROUP);
+    printf("\"Non lettre 580.csv\" in dir (default: the current directory).\n");
+}
+
+int run_lettrage(const char *program_name, int argc, char *argv[]) {
+    Lettrage lettrage;
+    const char *out_dir = ".";
+    char matched_path[JOURNAL_PATH_SIZE], unmatched_path[JOURNAL_PATH_SIZE];
+    char **dossiers = calloc((size_t)argc + 1, sizeof(char *));
+    int dossier_count = 0;
+    int ok = dossiers != NULL;
+
+    memset(&lettrage, 0, sizeof(lettrage));
+    lettrage.window = LETTRAGE_WINDOW;
+    lettrage.max_group = LETTRAGE_MAX_GROUP;
+    for (int i = 0; ok && i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+            lettrage.window = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-group") == 0 && i + 1 < argc) {
+            lettrage.max_group = atoi(argv[++i]);
+        } else if (argv[i][0] == '-' || dossier_count == UINT16_MAX) {
+            dossier_count = 0;
+            break;
+        } else {
+            // The dossier is named after its folder
+            size_t len = strlen(argv[i]);
+            while (len > 1 && argv[i][len - 1] == '/')
+                len--;
+            const char *name = argv[i] + len;
+            while (name > argv[i] && name[-1] != '/')
+                name--;
+            dossiers[dossier_count] = strndup(name, (size_t)(argv[i] + len - name));
+            ok = dossiers[dossier_count++] != NULL;
+        }
+    }
+    if (ok && (dossier_count == 0 || lettrage.window < 0 || lettrage.max_group < 2 ||
+               lettrage.max_group > LETTRAGE_GROUP_LIMIT)) {
+        lettrage_usage(program_name);
+        for (int d = 0; d < argc; d++)
+            free(dossiers[d]);
+        free(dossiers);
+        return 1;
+    }
+    snprintf(matched_path, sizeof(matched_path), "%s/Lettrage 580.csv", out_dir);
+    snprintf(unmatched_path, sizeof(unmatched_path), "%s/Non lettre 580.csv", out_dir);
+
+    double start = lettrage_now();
+    int files = 0;
+    for (int i = 0, d = 0; ok && i < argc; i++) {
+        JournalList journals;
+        if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--window") == 0 ||
+            strcmp(argv[i], "--max-group") == 0) {
+            i++;
+            continue;
+        }
+        memset(&journals, 0, sizeof(journals));
+        ok = journal_list_add(&journals, argv[i]);
+        for (int f = 0; ok && f < journals.count; f++)
+            ok = load_journal(&lettrage, &journals.files[f], (uint16_t)d);
+        if (ok && journals.count == 0)
+            fprintf(stderr, "Warning: No journal in %s\n", argv[i]);
+        files += journals.count;
+        journal_list_free(&journals);
+        d++;
+    }
+    if (ok) {
+        qsort(lettrage.entries, lettrage.count, sizeof(ClearingEntry), compare_entries);
+        ok = match_all(&lettrage);
+    }
+    if (ok) {
+        qsort(lettrage.entries, lettrage.count, sizeof(ClearingEntry), compare_report);
+        ok = write_reports(&lettrage, dossiers, dossier_count, matched_path, unmatched_path);
+    }
+    if (ok) {
+        printf("Lettrage: %d journal(s), %zu entries in %.3f s\n", files, lettrage.count,
+               lettrage_now() - start);
+        printf("Output written to %s and %s\n", matched_path, unmatched_path);
+    } else {
+        fprintf(stderr, "Error: Could not match the 580 entries\n");
+    }
+    for (int d = 0; d < dossier_count; d++)
+        free(dossiers[d]);
+    free(dossiers);
+    free(lettrage.entries);
+    free(lettrage.strings);
+    return ok ? 0 : 4;
+}
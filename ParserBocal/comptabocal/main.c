@@ -0,0 +1,52 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   main.c                                             :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:50:17 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:26:06 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <unistd.h>
+#include "cli.h"
+
+void default_socket_path(char *out, size_t size) {
+    const char *env = getenv("COMPTABOCAL_SOCKET");
+    if (env && *env)
+        snprintf(out, size, "%s", env);
+    else
+        snprintf(out, size, "/tmp/comptabocal-%u.sock", (unsigned)getuid());
+}
+
+static void print_usage(const char *program_name) {
+    printf("Usage: %s serve [--socket path]\n", program_name);
+    printf("Runs the conversion service: JB, JV and JC jobs sent on a Unix socket are converted\n");
+    printf("with charts and rules kept in memory. The socket defaults to $COMPTABOCAL_SOCKET,\n");
+    printf("else /tmp/comptabocal-<uid>.sock.\n");
+    printf("       %s year [-j threads] [--year YYYY] [--chart file] [--rules file] [--manifest file]\n",
+           program_name);
+    printf("       <client folder>\n");
+    printf("Converts every month of the bank, sales and cash journals of a client folder at once,\n");
+    printf("see %s year for details.\n", program_name);
+    printf("       %s ledger [-o dir] <journal|folder>...\n", program_name);
+    printf("Adds up journals into a general ledger and a trial balance.\n");
+    printf("       %s lettrage [-o dir] [--window days] [--max-group n] <client folder|journal>...\n",
+           program_name);
+    printf("Matches the 580 clearing entries of the sales, cash and bank journals.\n");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "serve") == 0)
+        return run_serve(argv[0], argc - 2, argv + 2);
+    if (argc >= 2 && strcmp(argv[1], "year") == 0)
+        return run_year(argv[0], argc - 2, argv + 2);
+    if (argc >= 2 && strcmp(argv[1], "ledger") == 0)
+        return run_ledger(argv[0], argc - 2, argv + 2);
+    if (argc >= 2 && strcmp(argv[1], "lettrage") == 0)
+        return run_lettrage(argv[0], argc - 2, argv + 2);
+    print_usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,280 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   serve.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:50:17 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 14:50:17 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "cli.h"
+
+// Conversion service. A client connects to the Unix socket and sends one job
+// per line, fields separated by tabs, paths as seen by the service:
+//
+//   JB <statement> <chart> [rules]     (rules empty or absent: built-in rules)
+//   JV <CAISSE-CA> <CAISSE-Reglement>
+//   JC <CAISSE-Prlv>
+//   PING
+//
+// Each job is answered on the same connection, in order:
+//
+//   OK <rows> <length> <journal name>  followed by <length> bytes of journal
+//   ERR <status> <message>
+//
+// Every connection has its own thread and library context; charts and rules
+// are shared by all of them and loaded again only when their files change,
+// so a job costs the parse of its statement.
+
+#define SERVE_LINE_SIZE 8192
+#define SERVE_MAX_FIELDS 5
+
+static volatile sig_atomic_t serve_stop;
+
+typedef struct {
+    int fd;
+    char buf[SERVE_LINE_SIZE];
+    size_t start;
+    size_t end;
+} Connection;
+
+static void on_signal(int sig) {
+    (void)sig;
+    serve_stop = 1;
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+// Next request line without its newline, NULL at the end of the connection
+static char *read_line(Connection *conn) {
+    for (;;) {
+        char *line = conn->buf + conn->start;
+        char *eol = memchr(line, '\n', conn->end - conn->start);
+        if (eol) {
+            *eol = '\0';
+            if (eol > line && eol[-1] == '\r')
+                eol[-1] = '\0';
+            conn->start = (size_t)(eol - conn->buf) + 1;
+            return line;
+        }
+        if (conn->start > 0) {
+            memmove(conn->buf, line, conn->end - conn->start);
+            conn->end -= conn->start;
+            conn->start = 0;
+        }
+        if (conn->end == sizeof(conn->buf) - 1)
+            return NULL; // Longer than any valid request
+        ssize_t n = read(conn->fd, conn->buf + conn->end, sizeof(conn->buf) - 1 - conn->end);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return NULL;
+        conn->end += (size_t)n;
+    }
+}
+
+static int split_fields(char *line, char **fields) {
+    int count = 0;
+    fields[count++] = line;
+    for (char *p = line; *p && count < SERVE_MAX_FIELDS; p++) {
+        if (*p == '\t') {
+            *p = '\0';
+            fields[count++] = p + 1;
+        }
+    }
+    return count;
+}
+
+static int send_error(int fd, int status, const char *message) {
+    char header[600];
+    int len = snprintf(header, sizeof(header), "ERR\t%d\t%s", status, message);
+    if (len < 0 || (size_t)len >= sizeof(header) - 1)
+        len = (int)sizeof(header) - 2;
+    for (int i = 4; i < len; i++)
+        if (header[i] == '\n' || header[i] == '\r') header[i] = ' ';
+    header[len++] = '\n';
+    return write_all(fd, header, (size_t)len);
+}
+
+static double elapsed_ms(const struct timeval *since) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (double)(now.tv_sec - since->tv_sec) * 1000.0 + (double)(now.tv_usec - since->tv_usec) / 1000.0;
+}
+
+// Run one job and answer it; returns 0 when the connection is lost
+static int serve_job(CbContext *ctx, int fd, char *line) {
+    char *fields[SERVE_MAX_FIELDS];
+    int count = split_fields(line, fields);
+    CbJournal journal;
+    struct timeval start;
+    int status;
+
+    if (strcmp(fields[0], "PING") == 0)
+        return write_all(fd, "PONG\n", 5);
+
+    gettimeofday(&start, NULL);
+    if (strcmp(fields[0], "JB") == 0 && count >= 3) {
+        const char *rules = count >= 4 && *fields[3] ? fields[3] : NULL;
+        status = cb_jb_file(ctx, fields[1], fields[2], rules, &journal);
+    } else if (strcmp(fields[0], "JV") == 0 && count >= 3) {
+        status = cb_jv_files(ctx, fields[1], fields[2], &journal);
+    } else if (strcmp(fields[0], "JC") == 0 && count >= 2) {
+        status = cb_jc_file(ctx, fields[1], &journal);
+    } else {
+        return send_error(fd, CB_ERR_INPUT, "Unknown request");
+    }
+
+    if (status != CB_OK) {
+        fprintf(stderr, "%s: error %d: %s\n", fields[0], status, cb_last_error(ctx));
+        return send_error(fd, status, cb_last_error(ctx));
+    }
+
+    char header[512];
+    int len = snprintf(header, sizeof(header), "OK\t%d\t%zu\t%s\n", journal.rows, journal.len, journal.name);
+    int sent = write_all(fd, header, (size_t)len) && write_all(fd, journal.text, journal.len);
+    fprintf(stderr, "%s: %s, %d rows in %.1f ms\n", fields[0], journal.name, journal.rows, elapsed_ms(&start));
+    cb_journal_free(&journal);
+    return sent;
+}
+
+static void *serve_connection(void *arg) {
+    Connection *conn = arg;
+    CbContext *ctx = cb_context_new();
+    char *line;
+
+    if (!ctx) {
+        send_error(conn->fd, CB_ERR_MEMORY, "Out of memory");
+    } else {
+        while ((line = read_line(conn))) {
+            if (strcmp(line, "QUIT") == 0 || !serve_job(ctx, conn->fd, line))
+                break;
+        }
+    }
+    cb_context_free(ctx);
+    close(conn->fd);
+    free(conn);
+    return NULL;
+}
+
+// Bind the socket, replacing the file of a service that is no longer running
+static int open_socket(const char *path) {
+    struct sockaddr_un addr;
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Socket path too long: %s\n", path);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Error: socket: %s\n", strerror(errno));
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        fprintf(stderr, "Error: A service is already listening on %s\n", path);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    unlink(path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    mode_t mask = umask(077); // Only the owner may send jobs
+    int bound = fd >= 0 && bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    umask(mask);
+    if (!bound || listen(fd, 64) != 0) {
+        fprintf(stderr, "Error: Could not listen on %s: %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int run_serve(const char *program_name, int argc, char *argv[]) {
+    char path[256];
+    struct sigaction sa;
+    pthread_attr_t attr;
+    int listen_fd;
+
+    default_socket_path(path, sizeof(path));
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            snprintf(path, sizeof(path), "%s", argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s serve [--socket path]\n", program_name);
+            return 1;
+        }
+    }
+
+    // Library messages (charts loaded, warnings) show up as they happen in the service log
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    listen_fd = open_socket(path);
+    if (listen_fd < 0)
+        return 2;
+
+    // No SA_RESTART: a signal interrupts accept() and stops the service
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    fprintf(stderr, "Listening on %s\n", path);
+
+    while (!serve_stop) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EINTR && errno != ECONNABORTED)
+                fprintf(stderr, "Error: accept: %s\n", strerror(errno));
+            continue;
+        }
+        Connection *conn = calloc(1, sizeof(*conn));
+        pthread_t thread;
+        if (!conn) {
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        if (pthread_create(&thread, &attr, serve_connection, conn) != 0) {
+            send_error(fd, CB_ERR_MEMORY, "Could not start a worker");
+            close(fd);
+            free(conn);
+        }
+    }
+
+    pthread_attr_destroy(&attr);
+    close(listen_fd);
+    unlink(path);
+    fprintf(stderr, "Stopped\n");
+    return 0;
+}
@@ -0,0 +1,459 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   year.c                                             :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:17:19 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:17:19 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <ctype.h>
+#include <dirent.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "cli.h"
+#include "../common/pool.h"
+
+// Year mode: every journal of every month of a client folder in one run. The
+// client folder holds a folder per journal and month, as the exports come:
+//
+//   Journal Banque {Mois} {Annee}/BQ-*.csv
+//   Journal Vente {Mois} {Annee}/CAISSE-CA*.csv and CAISSE-Reglement*.csv
+//   Journal Caisse {Mois} {Annee}/CAISSE-Prlv*.csv
+//
+// Each folder is a job. All jobs go to one worker pool, the largest inputs
+// first so that a long statement does not start last, and every worker has
+// its own library context while the chart and rules are loaded once for the
+// process. A journal is written in its month folder under the name the
+// command-line tool would give it, and a manifest lists every job with its
+// inputs, journal, rows, size, time and status.
+
+#define YEAR_PATH_SIZE 4096
+#define YEAR_MANIFEST "comptabocal-year.json"
+
+typedef enum {
+    YEAR_JB,
+    YEAR_JV,
+    YEAR_JC
+} YearKind;
+
+static const struct {
+    const char *folder;     // second word of the month folder
+    const char *tool;
+    const char *input;      // prefix of the input file
+} year_kinds[] = {
+    [YEAR_JB] = {"Banque", "JB", "BQ-"},
+    [YEAR_JV] = {"Vente", "JV", "CAISSE-CA"},
+    [YEAR_JC] = {"Caisse", "JC", "CAISSE-Prlv"},
+};
+
+// Month names of the folders, without accents
+static const char *const year_months[] = {
+    "janvier", "fevrier", "mars", "avril", "mai", "juin",
+    "juillet", "aout", "septembre", "octobre", "novembre", "decembre"
+};
+
+typedef struct Year Year;
+
+typedef struct {
+    Year *year;
+    YearKind kind;
+    int month;
+    int number;             // year of the folder
+    char dir[YEAR_PATH_SIZE];
+    char input[YEAR_PATH_SIZE];
+    char payments[YEAR_PATH_SIZE];  // CAISSE-Reglement of a sales journal
+    long long input_bytes;
+    char output[YEAR_PATH_SIZE];
+    int rows;
+    size_t bytes;
+    double seconds;
+    int status;
+    char error[512];
+} YearJob;
+
+struct Year {
+    YearJob *jobs;
+    int count;
+    int capacity;
+    const char *chart;
+    const char *rules;
+    CbContext **contexts;   // one per worker, the last one for the calling thread
+    int context_count;
+};
+
+static double year_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Lower-cased month name without its accents (é, è, ê, û in UTF-8)
+static void fold_month(const char *s, char *out, size_t size) {
+    size_t n = 0;
+    for (; *s && n + 1 < size; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == 0xC3 && s[1]) {
+            unsigned char next = (unsigned char)*++s | 0x20;
+            out[n++] = next == 0xBB ? 'u' : 'e';
+        } else {
+            out[n++] = (char)tolower(c);
+        }
+    }
+    out[n] = '\0';
+}
+
+// Journal, month and year of a folder named Journal {Banque|Vente|Caisse} {Mois} {Annee}
+static int parse_folder(const char *name, YearKind *kind, int *month, int *number) {
+    char word[32], month_name[32], folded[32];
+    int end = 0;
+
+    if (sscanf(name, "Journal %31s %31s %d%n", word, month_name, number, &end) != 3 || name[end] != '\0')
+        return 0;
+    *kind = (YearKind)-1;
+    for (int k = YEAR_JB; k <= YEAR_JC; k++) {
+        if (strcasecmp(word, year_kinds[k].folder) == 0)
+            *kind = (YearKind)k;
+    }
+    fold_month(month_name, folded, sizeof(folded));
+    *month = 0;
+    for (int m = 0; m < 12; m++) {
+        if (strcmp(folded, year_months[m]) == 0)
+            *month = m + 1;
+    }
+    return (int)*kind >= 0 && *month > 0;
+}
+
+static int has_suffix(const char *name, const char *suffix) {
+    size_t len = strlen(name), slen = strlen(suffix);
+    return len >= slen && strcasecmp(name + len - slen, suffix) == 0;
+}
+
+// First CSV of dir, in name order, whose name starts with prefix
+static int find_input(const char *dir, const char *prefix, char *path, size_t size, long long *bytes) {
+    struct dirent **names;
+    int count = scandir(dir, &names, NULL, alphasort);
+    int found = 0;
+
+    for (int i = 0; i < count; i++) {
+        const char *name = names[i]->d_name;
+        struct stat st;
+        if (!found && strncasecmp(name, prefix, strlen(prefix)) == 0 && has_suffix(name, ".csv")) {
+            int n = snprintf(path, size, "%s/%s", dir, name);
+            if (n > 0 && (size_t)n < size && stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+                *bytes += (long long)st.st_size;
+                found = 1;
+            }
+        }
+        free(names[i]);
+    }
+    free(names);
+    return found;
+}
+
+static YearJob *year_add(Year *year) {
+    if (year->count == year->capacity) {
+        int capacity = year->capacity ? year->capacity * 2 : 64;
+        YearJob *grown = realloc(year->jobs, (size_t)capacity * sizeof(YearJob));
+        if (!grown)
+            return NULL;
+        year->jobs = grown;
+        year->capacity = capacity;
+    }
+    YearJob *job = &year->jobs[year->count++];
+    memset(job, 0, sizeof(*job));
+    job->year = year;
+    return job;
+}
+
+// One job per month folder of the client folder, with its inputs
+static int year_discover(Year *year, const char *root, int only_year) {
+    struct dirent **names;
+    int count = scandir(root, &names, NULL, alphasort);
+
+    if (count < 0) {
+        fprintf(stderr, "Error: Could not open %s\n", root);
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        YearKind kind;
+        int month, number;
+        char dir[YEAR_PATH_SIZE];
+        struct stat st;
+        int n = snprintf(dir, sizeof(dir), "%s/%s", root, names[i]->d_name);
+
+        if (parse_folder(names[i]->d_name, &kind, &month, &number) && (!only_year || number == only_year) &&
+            n > 0 && (size_t)n < sizeof(dir) && stat(dir, &st) == 0 && S_ISDIR(st.st_mode)) {
+            YearJob *job = year_add(year);
+            if (!job) {
+                fprintf(stderr, "Error: Out of memory\n");
+                free(names[i]);
+                continue;
+            }
+            job->kind = kind;
+            job->month = month;
+            job->number = number;
+            snprintf(job->dir, sizeof(job->dir), "%s", dir);
+            int found = find_input(dir, year_kinds[kind].input, job->input, sizeof(job->input),
+                                   &job->input_bytes);
+            if (found && kind == YEAR_JV)
+                found = find_input(dir, "CAISSE-Reglement", job->payments, sizeof(job->payments),
+                                   &job->input_bytes);
+            if (!found) {
+                job->status = CB_ERR_INPUT;
+                snprintf(job->error, sizeof(job->error), "no %s*.csv in the folder",
+                         job->input[0] ? "CAISSE-Reglement" : year_kinds[kind].input);
+            }
+        }
+        free(names[i]);
+    }
+    free(names);
+    return 1;
+}
+
+static void year_convert(void *arg, int worker) {
+    YearJob *job = arg;
+    Year *year = job->year;
+    CbContext *ctx = year->contexts[worker < year->context_count - 1 ? worker : year->context_count - 1];
+    CbJournal journal;
+    double start = year_now();
+
+    if (job->kind == YEAR_JB)
+        job->status = cb_jb_file(ctx, job->input, year->chart, year->rules, &journal);
+    else if (job->kind == YEAR_JV)
+        job->status = cb_jv_files(ctx, job->input, job->payments, &journal);
+    else
+        job->status = cb_jc_file(ctx, job->input, &journal);
+    if (job->status == CB_OK) {
+        job->rows = journal.rows;
+        job->bytes = journal.len;
+        job->status = cb_journal_save(ctx, &journal, job->dir, job->output, sizeof(job->output));
+    }
+    if (job->status != CB_OK)
+        snprintf(job->error, sizeof(job->error), "%s", cb_last_error(ctx));
+    cb_journal_free(&journal);
+    job->seconds = year_now() - start;
+}
+
+// Year, month, then journal
+static int compare_jobs(const void *a, const void *b) {
+    const YearJob *x = a, *y = b;
+    if (x->number != y->number) return x->number - y->number;
+    if (x->month != y->month) return x->month - y->month;
+    return (int)x->kind - (int)y->kind;
+}
+
+static Year *sort_year;
+
+// Largest inputs first
+static int compare_sizes(const void *a, const void *b) {
+    long long x = sort_year->jobs[*(const int *)a].input_bytes;
+    long long y = sort_year->jobs[*(const int *)b].input_bytes;
+    return (x < y) - (x > y);
+}
+
+static void json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; s && *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+static void json_string_or_null(FILE *out, const char *s) {
+    if (s)
+        json_string(out, s);
+    else
+        fprintf(out, "null");
+}
+
+static int write_manifest(const Year *year, const char *path, const char *root, int threads, double seconds) {
+    FILE *out = fopen(path, "w");
+    char date[32] = "";
+    time_t now = time(NULL);
+    struct tm tm;
+
+    if (!out) {
+        fprintf(stderr, "Error: Could not create %s\n", path);
+        return 0;
+    }
+    if (localtime_r(&now, &tm))
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &tm);
+    fprintf(out, "{\n  \"folder\": ");
+    json_string(out, root);
+    fprintf(out, ",\n  \"date\": \"%s\",\n  \"threads\": %d,\n  \"seconds\": %.3f,\n  \"chart\": ", date,
+            threads, seconds);
+    json_string_or_null(out, year->chart);
+    fprintf(out, ",\n  \"rules\": ");
+    json_string_or_null(out, year->rules);
+    fprintf(out, ",\n  \"journals\": [");
+    for (int i = 0; i < year->count; i++) {
+        const YearJob *job = &year->jobs[i];
+        fprintf(out, "%s\n    {\"journal\": \"%s\", \"month\": %d, \"year\": %d, \"inputs\": [",
+                i ? "," : "", year_kinds[job->kind].tool, job->month, job->number);
+        if (job->input[0])
+            json_string(out, job->input);
+        if (job->payments[0]) {
+            fprintf(out, ", ");
+            json_string(out, job->payments);
+        }
+        fprintf(out, "], \"output\": ");
+        json_string_or_null(out, job->status == CB_OK ? job->output : NULL);
+        fprintf(out, ", \"rows\": %d, \"bytes\": %zu, \"seconds\": %.3f, \"status\": \"%s\"", job->rows,
+                job->bytes, job->seconds, job->status == CB_OK ? "ok" : "failed");
+        if (job->status != CB_OK) {
+            fprintf(out, ", \"error\": ");
+            json_string(out, job->error);
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Error: Could not write %s\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+// Chart of the client: Plan Comptable*.csv in the client folder, else the tools' default
+static const char *find_chart(const char *root, char *path, size_t size) {
+    long long bytes = 0;
+    return find_input(root, "Plan Comptable", path, size, &bytes) ? path : NULL;
+}
+
+static void year_usage(const char *program_name) {
+    printf("Usage: %s year [-j threads] [--year YYYY] [--chart file] [--rules file] [--manifest file]\n",
+           program_name);
+    printf("       <client folder>\n");
+    printf("Converts every Journal {Banque,Vente,Caisse} {Mois} {Annee} folder of the client folder\n");
+    printf("at once on a pool of workers (-j, default one per core), each journal written in its\n");
+    printf("month folder. The chart defaults to Plan Comptable*.csv in the client folder and the\n");
+    printf("rules to its Regles JB.csv, else the built-in rules. The manifest of the run goes to\n");
+    printf("%s in the client folder.\n", YEAR_MANIFEST);
+}
+
+int run_year(const char *program_name, int argc, char *argv[]) {
+    Year year;
+    int threads = 0;
+    int only_year = 0;
+    const char *manifest = NULL;
+    const char *root = NULL;
+    char chart_path[YEAR_PATH_SIZE], rules_path[YEAR_PATH_SIZE], manifest_path[YEAR_PATH_SIZE];
+
+    memset(&year, 0, sizeof(year));
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--year") == 0 && i + 1 < argc) {
+            only_year = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--chart") == 0 && i + 1 < argc) {
+            year.chart = argv[++i];
+        } else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            year.rules = argv[++i];
+        } else if (strcmp(argv[i], "--manifest") == 0 && i + 1 < argc) {
+            manifest = argv[++i];
+        } else if (argv[i][0] != '-' && !root) {
+            root = argv[i];
+        } else {
+            year_usage(program_name);
+            return 1;
+        }
+    }
+    if (!root) {
+        year_usage(program_name);
+        return 1;
+    }
+    if (!year.chart)
+        year.chart = find_chart(root, chart_path, sizeof(chart_path));
+    if (!year.rules) {
+        snprintf(rules_path, sizeof(rules_path), "%s/Regles JB.csv", root);
+        if (access(rules_path, R_OK) == 0)
+            year.rules = rules_path;
+    }
+    if (!manifest) {
+        snprintf(manifest_path, sizeof(manifest_path), "%s/%s", root, YEAR_MANIFEST);
+        manifest = manifest_path;
+    }
+
+    if (!year_discover(&year, root, only_year))
+        return 2;
+    if (year.count == 0) {
+        fprintf(stderr, "Error: No Journal {Banque,Vente,Caisse} {Mois} {Annee} folder in %s\n", root);
+        free(year.jobs);
+        return 2;
+    }
+    qsort(year.jobs, (size_t)year.count, sizeof(YearJob), compare_jobs);
+
+    Pool pool;
+    if (!pool_init(&pool, threads)) {
+        fprintf(stderr, "Error: Could not start worker threads\n");
+        free(year.jobs);
+        return 2;
+    }
+    year.context_count = pool.thread_count + 1;
+    year.contexts = calloc((size_t)year.context_count, sizeof(CbContext *));
+    int *order = malloc((size_t)year.count * sizeof(int));
+    int ok = year.contexts && order;
+    for (int i = 0; ok && i < year.context_count; i++)
+        ok = (year.contexts[i] = cb_context_new()) != NULL;
+    if (!ok) {
+        fprintf(stderr, "Error: Out of memory\n");
+        pool_destroy(&pool);
+    } else {
+        double start = year_now();
+        for (int i = 0; i < year.count; i++)
+            order[i] = i;
+        sort_year = &year;
+        qsort(order, (size_t)year.count, sizeof(int), compare_sizes);
+        for (int i = 0; i < year.count; i++) {
+            YearJob *job = &year.jobs[order[i]];
+            if (job->status != CB_OK)
+                continue;
+            if (!pool_submit(&pool, year_convert, job))
+                year_convert(job, year.context_count - 1);
+        }
+        pool_wait(&pool);
+        pool_destroy(&pool);
+        double seconds = year_now() - start;
+
+        // Summary, in calendar order
+        int failed = 0;
+        long long rows = 0;
+        for (int i = 0; i < year.count; i++) {
+            YearJob *job = &year.jobs[i];
+            if (job->status != CB_OK) {
+                failed++;
+                printf("%s %02d/%d: failed, %s (%s)\n", year_kinds[job->kind].tool, job->month, job->number,
+                       job->error, job->dir);
+            } else {
+                rows += job->rows;
+                printf("%s %02d/%d -> %s (%d rows)\n", year_kinds[job->kind].tool, job->month, job->number,
+                       job->output, job->rows);
+            }
+        }
+        printf("Year: %d journal(s), %d converted, %d failed, %lld rows in %.3f s on %d thread(s)\n",
+               year.count, year.count - failed, failed, rows, seconds, year.context_count - 1);
+        ok = write_manifest(&year, manifest, root, year.context_count - 1, seconds);
+        if (ok)
+            printf("Manifest written to %s\n", manifest);
+        ok = ok && failed == 0;
+    }
+
+    for (int i = 0; year.contexts && i < year.context_count; i++)
+        cb_context_free(year.contexts[i]);
+    free(year.contexts);
+    free(order);
+    free(year.jobs);
+    return ok ? 0 : 4;
+}
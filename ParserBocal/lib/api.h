@@ -0,0 +1,43 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   api.h                                              :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:47:29 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 14:47:29 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef API_H
+# define API_H
+
+#include <stdarg.h>
+#include "comptabocal.h"
+#include "../common/jwriter.h"
+
+typedef struct JbCache JbCache;
+
+struct CbContext {
+    int verbose;
+    char error[512];
+    JbCache *jb;            // chart and rules of the last bank journals
+};
+
+// Record the failure of a call and return its status
+int api_fail(CbContext *ctx, int status, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+// Start a call: clear the error and the journal
+void api_begin(CbContext *ctx, CbJournal *journal);
+
+// Move the rows of a memory writer into the journal
+int api_take_rows(CbContext *ctx, JournalWriter *rows, CbJournal *journal);
+
+// Writable NUL-terminated copy of a caller's buffer
+char *api_copy(const char *data, size_t len);
+
+void api_jb_cache_free(JbCache *cache);
+
+#endif
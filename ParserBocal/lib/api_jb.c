@@ -0,0 +1,251 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   api_jb.c                                           :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:47:29 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:33:34 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "api.h"
+#include "../process_JB/process.h"
+
+// Identity of a file as seen at load time, to notice it was replaced or edited
+typedef struct {
+    char *path;             // NULL for the built-in rules
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+} FileStamp;
+
+typedef enum {
+    CACHED_CHART,
+    CACHED_RULES
+} CachedKind;
+
+// A chart or a rule set shared by every context of the process
+typedef struct Cached {
+    struct Cached *next;
+    CachedKind kind;
+    FileStamp stamp;
+    int refs;               // contexts holding it
+    int stale;              // replaced in the store, freed by its last holder
+    int loading;            // being read without the lock, other users of the path wait
+    union {
+        ChartOfAccounts chart;
+        RuleSet rules;
+    } u;
+} Cached;
+
+// Charts and rules last used by a context, kept warm for its next run
+struct JbCache {
+    Cached *chart;
+    Cached *rules;
+};
+
+// Process-wide store: contexts on different threads (the conversion service)
+// load each chart once and share it read-only. A file is read outside the
+// lock; contexts wanting the same file meanwhile wait for store_loaded.
+static pthread_mutex_t store_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t store_loaded = PTHREAD_COND_INITIALIZER;
+static Cached *store;
+
+static void stamp_file(FileStamp *stamp, const char *path) {
+    struct stat st;
+    memset(stamp, 0, sizeof(*stamp));
+    stamp->size = -1;
+    if (path && stat(path, &st) == 0) {
+        stamp->dev = st.st_dev;
+        stamp->ino = st.st_ino;
+        stamp->size = st.st_size;
+        stamp->mtime = st.st_mtime;
+    }
+}
+
+static int same_path(const FileStamp *stamp, const char *path) {
+    if (!stamp->path || !path)
+        return stamp->path == path;
+    return strcmp(stamp->path, path) == 0;
+}
+
+static int same_file(const FileStamp *a, const FileStamp *b) {
+    return a->dev == b->dev && a->ino == b->ino && a->size == b->size && a->mtime == b->mtime;
+}
+
+static void cached_free(Cached *entry) {
+    if (entry->kind == CACHED_CHART)
+        free_chart_of_accounts(&entry->u.chart);
+    else
+        free_classification_rules(&entry->u.rules);
+    free(entry->stamp.path);
+    free(entry);
+}
+
+static void cached_release(Cached *entry) {
+    if (!entry) return;
+    pthread_mutex_lock(&store_lock);
+    if (--entry->refs == 0 && entry->stale)
+        cached_free(entry);
+    pthread_mutex_unlock(&store_lock);
+}
+
+// The store entry of a file, loaded again when the file changed since; NULL on failure
+static Cached *cached_acquire(CachedKind kind, const char *path) {
+    FileStamp stamp;
+    Cached **link;
+    Cached *entry;
+
+    stamp_file(&stamp, path);
+    pthread_mutex_lock(&store_lock);
+retry:
+    for (link = &store; (entry = *link); link = &entry->next) {
+        if (entry->kind != kind || !same_path(&entry->stamp, path))
+            continue;
+        if (entry->loading) {
+            // Another context is reading this file, its result may be the one wanted
+            pthread_cond_wait(&store_loaded, &store_lock);
+            goto retry;
+        }
+        if (same_file(&entry->stamp, &stamp)) {
+            entry->refs++;
+            pthread_mutex_unlock(&store_lock);
+            return entry;
+        }
+        // Edited since it was loaded: out of the store, gone with its last holder
+        *link = entry->next;
+        entry->stale = 1;
+        if (entry->refs == 0)
+            cached_free(entry);
+        break;
+    }
+
+    entry = calloc(1, sizeof(*entry));
+    if (!entry) {
+        pthread_mutex_unlock(&store_lock);
+        return NULL;
+    }
+    entry->kind = kind;
+    entry->stamp = stamp;
+    entry->stamp.path = path ? strdup(path) : NULL;
+    entry->refs = 1;
+    entry->loading = 1;
+    entry->next = store;
+    store = entry;
+    pthread_mutex_unlock(&store_lock);
+
+    int loaded = 1;
+    if (kind == CACHED_CHART) {
+        if (load_chart_of_accounts(path, &entry->u.chart) == 0)
+            fprintf(stderr, "Warning: No accounts loaded from %s. Using default account codes.\n", path);
+    } else if (load_classification_rules(path, &entry->u.rules) == 0) {
+        loaded = 0;
+    }
+
+    pthread_mutex_lock(&store_lock);
+    entry->loading = 0;
+    if (!loaded) {
+        for (link = &store; *link != entry; link = &(*link)->next)
+            ;
+        *link = entry->next;
+        cached_free(entry);
+        entry = NULL;
+    }
+    pthread_cond_broadcast(&store_loaded);
+    pthread_mutex_unlock(&store_lock);
+    return entry;
+}
+
+void api_jb_cache_free(JbCache *cache) {
+    if (!cache) return;
+    cached_release(cache->chart);
+    cached_release(cache->rules);
+    free(cache);
+}
+
+// Chart and rules for this run, loaded again only when their files changed
+static int load_cached(CbContext *ctx, const char *chart, const char *rules) {
+    if (!ctx->jb && !(ctx->jb = calloc(1, sizeof(JbCache))))
+        return api_fail(ctx, CB_ERR_MEMORY, "Out of memory");
+    JbCache *cache = ctx->jb;
+    if (!chart)
+        chart = "Plan Comptable 2025.csv";
+
+    Cached *chart_entry = cached_acquire(CACHED_CHART, chart);
+    if (!chart_entry)
+        return api_fail(ctx, CB_ERR_MEMORY, "Out of memory");
+    Cached *rules_entry = cached_acquire(CACHED_RULES, rules);
+    if (!rules_entry) {
+        cached_release(chart_entry);
+        return api_fail(ctx, CB_ERR_INPUT, "No classification rules available");
+    }
+    cached_release(cache->chart);
+    cached_release(cache->rules);
+    cache->chart = chart_entry;
+    cache->rules = rules_entry;
+    return CB_OK;
+}
+
+static int convert(CbContext *ctx, RecordReader *reader, const char *chart, const char *rules,
+                   CbJournal *journal) {
+    JournalWriter rows;
+    int status = load_cached(ctx, chart, rules);
+    if (status != CB_OK)
+        return status;
+
+    journal_file_name(reader, journal->name, sizeof(journal->name));
+    if (!jwriter_init(&rows, -1, JOURNAL_LAYOUT_CPTE_LIBELLE))
+        return api_fail(ctx, CB_ERR_MEMORY, "Out of memory");
+    journal->rows = convert_statement(reader, &rows, &ctx->jb->chart->u.chart, &ctx->jb->rules->u.rules);
+    if (journal->rows == CONVERT_NO_MEMORY) {
+        jwriter_close(&rows);
+        return api_fail(ctx, CB_ERR_MEMORY, "Out of memory");
+    }
+    if (journal->rows <= 0) {
+        jwriter_close(&rows);
+        return api_fail(ctx, CB_ERR_NO_DATA, "No operation converted");
+    }
+    return api_take_rows(ctx, &rows, journal);
+}
+
+int cb_jb_file(CbContext *ctx, const char *statement, const char *chart, const char *rules,
+               CbJournal *journal) {
+    RecordReader reader;
+    int status;
+
+    api_begin(ctx, journal);
+    int fd = open(statement, O_RDONLY);
+    if (fd < 0)
+        return api_fail(ctx, CB_ERR_INPUT, "Could not open input file %s", statement);
+    if (!reader_init(&reader, fd)) {
+        close(fd);
+        return api_fail(ctx, CB_ERR_MEMORY, "Out of memory");
+    }
+    status = convert(ctx, &reader, chart, rules, journal);
+    reader_free(&reader);
+    close(fd);
+    return status;
+}
+
+int cb_jb_buffer(CbContext *ctx, const char *data, size_t len, const char *chart, const char *rules,
+                 CbJournal *journal) {
+    RecordReader reader;
+    int status;
+
+    api_begin(ctx, journal);
+    char *copy = api_copy(data, len);
+    if (!copy)
+        return api_fail(ctx, CB_ERR_MEMORY, "Out of memory");
+    reader_init_memory(&reader, copy, len);
+    status = convert(ctx, &reader, chart, rules, journal);
+    reader_free(&reader);
+    free(copy);
+    return status;
+}
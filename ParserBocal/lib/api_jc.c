@@ -0,0 +1,56 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   api_jc.c                                           :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:47:29 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:55:27 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "api.h"
+#include "../process_JC/Journal_Caisse.h"
+
+static int convert(CbContext *ctx, char *data, size_t len, CbJournal *journal) {
+    JournalWriter rows;
+
+    if (!jwriter_init(&rows, -1, JOURNAL_LAYOUT_LIBELLE_CPTE))
+        return api_fail(ctx, CB_ERR_MEMORY, "Out of memory");
+    journal->rows = convert_cash_withdrawals(data, len, &rows, journal->name, sizeof(journal->name));
+    if (journal->rows < 0) {
+        jwriter_close(&rows);
+        return api_fail(ctx, CB_ERR_INPUT, "Input file has no DATE and RETRAITS header row");
+    }
+    if (journal->rows == 0) {
+        jwriter_close(&rows);
+        return api_fail(ctx, CB_ERR_NO_DATA, "No valid data found in input file");
+    }
+    return api_take_rows(ctx, &rows, journal);
+}
+
+int cb_jc_file(CbContext *ctx, const char *withdrawals, CbJournal *journal) {
+    size_t len;
+    int status;
+
+    api_begin(ctx, journal);
+    char *data = csv_read_file(withdrawals, &len);
+    if (!data)
+        return api_fail(ctx, CB_ERR_INPUT, "Could not open input file %s", withdrawals);
+    status = convert(ctx, data, len, journal);
+    free(data);
+    return status;
+}
+
+int cb_jc_buffer(CbContext *ctx, const char *data, size_t len, CbJournal *journal) {
+    int status;
+
+    api_begin(ctx, journal);
+    char *copy = api_copy(data, len);
+    if (!copy)
+        return api_fail(ctx, CB_ERR_MEMORY, "Out of memory");
+    status = convert(ctx, copy, len, journal);
+    free(copy);
+    return status;
+}
@@ -0,0 +1,93 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   api_jv.c                                           :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:47:29 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:37:05 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <pthread.h>
+#include "api.h"
+#include "../process_JV/process.h"
+
+static pthread_once_t vat_once = PTHREAD_ONCE_INIT;
+
+// Accounts of the other VAT rates, read once from the working directory as process_JV does
+static void load_vat_accounts(void) {
+    if (access(VAT_ACCOUNTS_FILE, R_OK) == 0 && !vat_load_accounts(VAT_ACCOUNTS_FILE))
+        fprintf(stderr, "Warning: Could not read %s\n", VAT_ACCOUNTS_FILE);
+}
+
+static int convert(CbContext *ctx, SalesStream *sales, char *payments, size_t payments_len,
+                   const char *sales_name, CbJournal *journal) {
+    JournalWriter rows;
+
+    if (!jwriter_init(&rows, -1, JOURNAL_LAYOUT_CPTE_LIBELLE))
+        return api_fail(ctx, CB_ERR_MEMORY, "Out of memory");
+    if (sales_name)
+        journal_output_name(sales_name, journal->name, sizeof(journal->name));
+    else
+        create_output_filename(journal->name, sizeof(journal->name));
+
+    jv_verbose = ctx->verbose;
+    pthread_once(&vat_once, load_vat_accounts);
+    journal->rows = generate_sales_journal(sales, payments, payments_len, &rows);
+    if (journal->rows < 0) {
+        jwriter_close(&rows);
+        return api_fail(ctx, CB_ERR_NO_DATA, "No data read from input files");
+    }
+    if (journal->rows == 0) {
+        jwriter_close(&rows);
+        return api_fail(ctx, CB_ERR_NO_DATA, "No matching entries found. Check date formats in input files");
+    }
+    return api_take_rows(ctx, &rows, journal);
+}
+
+int cb_jv_files(CbContext *ctx, const char *sales, const char *payments, CbJournal *journal) {
+    SalesStream stream;
+    size_t payments_len;
+    int status;
+
+    api_begin(ctx, journal);
+    int fd = open(sales, O_RDONLY);
+    if (fd < 0)
+        return api_fail(ctx, CB_ERR_INPUT, "Could not open input file %s", sales);
+    if (!sales_stream_open(&stream, fd)) {
+        close(fd);
+        return api_fail(ctx, CB_ERR_MEMORY, "Out of memory");
+    }
+    char *payments_data = csv_read_file(payments, &payments_len);
+    if (!payments_data) {
+        sales_stream_free(&stream);
+        close(fd);
+        return api_fail(ctx, CB_ERR_INPUT, "Could not open input file %s", payments);
+    }
+    status = convert(ctx, &stream, payments_data, payments_len, sales, journal);
+    sales_stream_free(&stream);
+    close(fd);
+    free(payments_data);
+    return status;
+}
+
+int cb_jv_buffers(CbContext *ctx, const char *sales, size_t sales_len, const char *payments,
+                  size_t payments_len, const char *sales_name, CbJournal *journal) {
+    SalesStream stream;
+    int status = CB_ERR_MEMORY;
+
+    api_begin(ctx, journal);
+    char *sales_data = api_copy(sales, sales_len);
+    char *payments_data = api_copy(payments, payments_len);
+    if (sales_data && payments_data) {
+        sales_stream_init(&stream, sales_data, sales_len);
+        status = convert(ctx, &stream, payments_data, payments_len, sales_name, journal);
+    } else {
+        api_fail(ctx, status, "Out of memory");
+    }
+    free(sales_data);
+    free(payments_data);
+    return status;
+}
@@ -0,0 +1,110 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   comptabocal.c                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:47:29 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 14:47:29 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "api.h"
+
+int cb_api_version(void) {
+    return CB_API_VERSION;
+}
+
+CbContext *cb_context_new(void) {
+    return calloc(1, sizeof(CbContext));
+}
+
+void cb_context_free(CbContext *ctx) {
+    if (!ctx) return;
+    api_jb_cache_free(ctx->jb);
+    free(ctx);
+}
+
+void cb_set_verbose(CbContext *ctx, int verbose) {
+    ctx->verbose = verbose;
+}
+
+const char *cb_last_error(const CbContext *ctx) {
+    return ctx ? ctx->error : "No context";
+}
+
+int api_fail(CbContext *ctx, int status, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(ctx->error, sizeof(ctx->error), format, args);
+    va_end(args);
+    return status;
+}
+
+void api_begin(CbContext *ctx, CbJournal *journal) {
+    ctx->error[0] = '\0';
+    memset(journal, 0, sizeof(*journal));
+}
+
+int api_take_rows(CbContext *ctx, JournalWriter *rows, CbJournal *journal) {
+    journal->text = jwriter_take(rows, &journal->len);
+    if (!journal->text)
+        return api_fail(ctx, CB_ERR_MEMORY, "Out of memory while building the journal");
+    return CB_OK;
+}
+
+char *api_copy(const char *data, size_t len) {
+    char *copy = malloc(len + 1);
+    if (!copy) return NULL;
+    memcpy(copy, data, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+int cb_journal_save(CbContext *ctx, const CbJournal *journal, const char *dir, char *path,
+                    size_t path_size) {
+    char full[4096];
+    size_t done = 0;
+    int fd;
+
+    ctx->error[0] = '\0';
+    if (!journal->text || !journal->name[0])
+        return api_fail(ctx, CB_ERR_NO_DATA, "Empty journal");
+    if (dir && *dir)
+        snprintf(full, sizeof(full), "%s/%s", dir, journal->name);
+    else
+        snprintf(full, sizeof(full), "%s", journal->name);
+
+    fd = open(full, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return api_fail(ctx, CB_ERR_OUTPUT, "Could not create %s: %s", full, strerror(errno));
+    while (done < journal->len) {
+        ssize_t n = write(fd, journal->text + done, journal->len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            int err = errno;
+            close(fd);
+            return api_fail(ctx, CB_ERR_OUTPUT, "Could not write %s: %s", full, strerror(err));
+        }
+        done += (size_t)n;
+    }
+    if (close(fd) != 0)
+        return api_fail(ctx, CB_ERR_OUTPUT, "Could not write %s: %s", full, strerror(errno));
+    if (path && path_size)
+        snprintf(path, path_size, "%s", full);
+    return CB_OK;
+}
+
+void cb_journal_free(CbJournal *journal) {
+    if (!journal) return;
+    free(journal->text);
+    journal->text = NULL;
+    journal->len = 0;
+}
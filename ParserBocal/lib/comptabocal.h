@@ -0,0 +1,82 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   comptabocal.h                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:47:29 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 14:50:17 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef COMPTABOCAL_H
+# define COMPTABOCAL_H
+
+#include <stddef.h>
+
+// In-process API of the journal generators (libcomptabocal.so). The journals
+// are the ones process_JB, process_JV and process_JC write, byte for byte.
+// Charts and rules are loaded once per process and shared read-only by all
+// contexts; a context is meant to be used by one thread at a time.
+
+#define CB_API_VERSION 1
+
+// Only the cb_ functions are exported, the library is built with -fvisibility=hidden
+#define CB_API __attribute__((visibility("default")))
+
+// Status of a call; cb_last_error describes the last failure
+typedef enum {
+    CB_OK = 0,
+    CB_ERR_INPUT = 1,       // an input could not be read
+    CB_ERR_NO_DATA = 2,     // nothing to convert in the input
+    CB_ERR_OUTPUT = 3,      // the journal could not be written
+    CB_ERR_MEMORY = 4
+} CbStatus;
+
+typedef struct CbContext CbContext;
+
+// Journal produced by a run, released with cb_journal_free
+typedef struct {
+    char name[256];         // file name the command-line tool would use
+    char *text;             // CSV text, header included, NUL-terminated
+    size_t len;
+    int rows;               // operations (JB), days (JV, JC) converted
+} CbJournal;
+
+CB_API int cb_api_version(void);
+
+CB_API CbContext *cb_context_new(void);
+CB_API void cb_context_free(CbContext *ctx);
+
+// Progress messages of the generators on stdout (off by default)
+CB_API void cb_set_verbose(CbContext *ctx, int verbose);
+
+// Message of the last failed call of the context, "" if none
+CB_API const char *cb_last_error(const CbContext *ctx);
+
+// Bank journal of a statement; chart and rules are cached by path and
+// reloaded when the file changes; chart NULL reads Plan Comptable 2025.csv
+// like process_JB, rules NULL selects the built-in rules
+CB_API int cb_jb_file(CbContext *ctx, const char *statement, const char *chart, const char *rules,
+                      CbJournal *journal);
+CB_API int cb_jb_buffer(CbContext *ctx, const char *data, size_t len, const char *chart,
+                        const char *rules, CbJournal *journal);
+
+// Sales journal of the CAISSE-CA and CAISSE-Reglement exports; the buffer
+// variant names the journal after sales_name (NULL: the current month)
+CB_API int cb_jv_files(CbContext *ctx, const char *sales, const char *payments, CbJournal *journal);
+CB_API int cb_jv_buffers(CbContext *ctx, const char *sales, size_t sales_len, const char *payments,
+                         size_t payments_len, const char *sales_name, CbJournal *journal);
+
+// Cash journal of a CAISSE-Prlv export
+CB_API int cb_jc_file(CbContext *ctx, const char *withdrawals, CbJournal *journal);
+CB_API int cb_jc_buffer(CbContext *ctx, const char *data, size_t len, CbJournal *journal);
+
+// Write the journal as dir/name; the path written is copied to path when not NULL
+CB_API int cb_journal_save(CbContext *ctx, const CbJournal *journal, const char *dir, char *path,
+                           size_t path_size);
+
+CB_API void cb_journal_free(CbJournal *journal);
+
+#endif
@@ -0,0 +1,535 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   batch.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:34:12 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:28:48 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "process.h"
+#include "../common/pool.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Batch mode: convert many statements in one run. Every distinct chart of
+// accounts and rules file is loaded once on the main thread, then the
+// statements are converted in parallel by a pool of workers that only read
+// them. Each journal is written next to its statement, never over a file
+// already there: the journal then takes the next free " (n)" name.
+
+#define BATCH_SNIFF_SIZE 8192
+#define DEFAULT_CHART "Plan Comptable 2025.csv"
+#define DEFAULT_RULES "Regles JB.csv"
+
+typedef struct {
+    char *path;
+    ChartOfAccounts chart;
+} BatchChart;
+
+typedef struct {
+    char *path;             // NULL for the built-in rules
+    RuleSet rules;
+} BatchRules;
+
+struct Batch;
+
+typedef struct {
+    struct Batch *batch;
+    char *path;
+    int chart;
+    int rules;
+    char out_path[PATH_MAX];
+    char kept[PATH_MAX];    // file found at the journal name and left alone, "" if none
+    int entries;
+    long long bytes;
+    char error[160];
+} BatchJob;
+
+typedef struct Batch {
+    BatchJob *jobs;
+    int job_count;
+    int job_capacity;
+    BatchChart *charts;
+    int chart_count;
+    int chart_capacity;
+    BatchRules *rules;
+    int rules_count;
+    int rules_capacity;
+    const char *chart_option;
+    const char *rules_option;
+    pthread_mutex_t names_lock;     // journal names claimed by the workers
+    char **names;
+    int name_count;
+    int name_capacity;
+} Batch;
+
+static char *batch_strdup(const char *s) {
+    char *copy = malloc(strlen(s) + 1);
+    if (!copy) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return strcpy(copy, s);
+}
+
+static void *batch_grow(void *array, int *capacity, size_t item_size) {
+    int grown_capacity = *capacity ? *capacity * 2 : 16;
+    void *grown = realloc(array, (size_t)grown_capacity * item_size);
+    if (!grown) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = grown_capacity;
+    return grown;
+}
+
+static double elapsed_since(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// A statement has a header row naming its columns near its top
+static int looks_like_statement(const char *path) {
+    char buf[BATCH_SNIFF_SIZE + 1];
+    CsvDialect dialect;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    ssize_t n = read(fd, buf, BATCH_SNIFF_SIZE);
+    close(fd);
+    if (n <= 0) return 0;
+    buf[n] = '\0';
+    return sniff_statement(buf, (size_t)n, &dialect);
+}
+
+static int has_csv_suffix(const char *name) {
+    size_t len = strlen(name);
+    return len > 4 && strcasecmp(name + len - 4, ".csv") == 0;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Join a folder and a file name; 0 when the path does not fit
+static int join_path(char *out, size_t outsz, const char *dir, const char *name) {
+    int n = snprintf(out, outsz, "%s/%s", dir, name);
+    return n >= 0 && (size_t)n < outsz;
+}
+
+// Folder of a file path, "." when it has none
+static void parent_dir(const char *path, char *out, size_t outsz) {
+    const char *slash = strrchr(path, '/');
+    if (!slash)
+        snprintf(out, outsz, ".");
+    else if (slash == path)
+        snprintf(out, outsz, "/");
+    else
+        snprintf(out, outsz, "%.*s", (int)(slash - path), path);
+}
+
+// Look for `name` (or, with `prefix`, the first file named prefix*.csv) in dir;
+// -1 when the path is too long
+static int find_in_dir(const char *dir, const char *name, const char *prefix, char *out, size_t outsz) {
+    if (!join_path(out, outsz, dir, name))
+        return -1;
+    if (access(out, R_OK) == 0)
+        return 1;
+    if (!prefix)
+        return 0;
+
+    DIR *d = opendir(dir);
+    if (!d) return 0;
+    struct dirent *entry;
+    char best[NAME_MAX + 1] = "";
+    while ((entry = readdir(d))) {
+        if (strncmp(entry->d_name, prefix, strlen(prefix)) == 0 && has_csv_suffix(entry->d_name) &&
+            (!best[0] || strcmp(entry->d_name, best) < 0))
+            snprintf(best, sizeof(best), "%s", entry->d_name);
+    }
+    closedir(d);
+    if (!best[0])
+        return 0;
+    return join_path(out, outsz, dir, best) ? 1 : -1;
+}
+
+// Search the statement folder, then its parents up to the folder given on the
+// command line; -1 when a path is too long
+static int find_upwards(const char *statement, const char *root, const char *name, const char *prefix,
+                        char *out, size_t outsz) {
+    char dir[PATH_MAX];
+    char up[PATH_MAX];
+    parent_dir(statement, dir, sizeof(dir));
+
+    for (;;) {
+        int found = find_in_dir(dir, name, prefix, out, outsz);
+        if (found != 0)
+            return found;
+        parent_dir(dir, up, sizeof(up));
+        if (strcmp(dir, root) == 0 || strcmp(up, dir) == 0 || strlen(up) < strlen(root) ||
+            strchr(dir, '/') == NULL)
+            return 0;
+        snprintf(dir, sizeof(dir), "%s", up);
+    }
+}
+
+static int batch_chart_index(Batch *batch, const char *path) {
+    for (int i = 0; i < batch->chart_count; i++) {
+        if (strcmp(batch->charts[i].path, path) == 0)
+            return i;
+    }
+    if (batch->chart_count == batch->chart_capacity)
+        batch->charts = batch_grow(batch->charts, &batch->chart_capacity, sizeof(BatchChart));
+    batch->charts[batch->chart_count].path = batch_strdup(path);
+    return batch->chart_count++;
+}
+
+static int batch_rules_index(Batch *batch, const char *path) {
+    for (int i = 0; i < batch->rules_count; i++) {
+        const char *known = batch->rules[i].path;
+        if ((!known && !path) || (known && path && strcmp(known, path) == 0))
+            return i;
+    }
+    if (batch->rules_count == batch->rules_capacity)
+        batch->rules = batch_grow(batch->rules, &batch->rules_capacity, sizeof(BatchRules));
+    batch->rules[batch->rules_count].path = path ? batch_strdup(path) : NULL;
+    return batch->rules_count++;
+}
+
+// A statement whose chart or rules path does not fit fails without being converted
+static void batch_add_statement(Batch *batch, const char *path, const char *root) {
+    char found[PATH_MAX];
+    const char *chart = batch->chart_option;
+    const char *rules = batch->rules_option;
+    int found_chart = 0, found_rules = 0;
+
+    if (!chart) {
+        found_chart = find_upwards(path, root, DEFAULT_CHART, "Plan Comptable", found, sizeof(found));
+        chart = found_chart > 0 ? found : DEFAULT_CHART;
+    }
+    int chart_index = batch_chart_index(batch, chart);
+
+    if (!rules) {
+        found_rules = find_upwards(path, root, DEFAULT_RULES, NULL, found, sizeof(found));
+        if (found_rules > 0)
+            rules = found;
+        else if (access(DEFAULT_RULES, R_OK) == 0)
+            rules = DEFAULT_RULES;
+    }
+    int rules_index = batch_rules_index(batch, rules);
+
+    if (batch->job_count == batch->job_capacity)
+        batch->jobs = batch_grow(batch->jobs, &batch->job_capacity, sizeof(BatchJob));
+    BatchJob *job = &batch->jobs[batch->job_count++];
+    memset(job, 0, sizeof(*job));
+    job->batch = batch;
+    job->path = batch_strdup(path);
+    job->chart = chart_index;
+    job->rules = rules_index;
+    if (found_chart < 0 || found_rules < 0)
+        snprintf(job->error, sizeof(job->error), "path of the chart or rules too long");
+}
+
+// Collect the statements of a directory tree, in name order
+static void batch_walk(Batch *batch, const char *dir, const char *root) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "Warning: Could not open directory %s\n", dir);
+        return;
+    }
+    char **names = NULL;
+    int count = 0, capacity = 0;
+    struct dirent *entry;
+    while ((entry = readdir(d))) {
+        if (entry->d_name[0] == '.')
+            continue;
+        if (count == capacity)
+            names = batch_grow(names, &capacity, sizeof(char *));
+        names[count++] = batch_strdup(entry->d_name);
+    }
+    closedir(d);
+    qsort(names, (size_t)count, sizeof(char *), compare_names);
+
+    for (int i = 0; i < count; i++) {
+        char path[PATH_MAX];
+        struct stat st;
+        if (!join_path(path, sizeof(path), dir, names[i])) {
+            fprintf(stderr, "Warning: Path too long, skipped: %s/%s\n", dir, names[i]);
+        } else if (stat(path, &st) == 0) {
+            if (S_ISDIR(st.st_mode))
+                batch_walk(batch, path, root);
+            else if (S_ISREG(st.st_mode) && has_csv_suffix(names[i]) && looks_like_statement(path))
+                batch_add_statement(batch, path, root);
+        }
+        free(names[i]);
+    }
+    free(names);
+}
+
+// Create the journal under a name no other job claimed and no file has: a
+// second statement of the same month in a folder, or a journal already there
+// (made by hand or by an earlier run), gets " (2)". The file found at the name
+// of the journal is noted in job->kept. Returns the open journal, -1 with
+// job->error set.
+static int batch_create_journal(BatchJob *job, const char *dir, const char *name) {
+    Batch *batch = job->batch;
+    size_t stem = strlen(name) - 4;     // without ".csv"
+    int fd = -1;
+
+    pthread_mutex_lock(&batch->names_lock);
+    for (int n = 1; fd < 0; n++) {
+        int len = n == 1 ? snprintf(job->out_path, sizeof(job->out_path), "%s/%s", dir, name)
+                         : snprintf(job->out_path, sizeof(job->out_path), "%s/%.*s (%d).csv", dir, (int)stem,
+                                    name, n);
+        if (len < 0 || (size_t)len >= sizeof(job->out_path)) {
+            snprintf(job->error, sizeof(job->error), "journal path too long");
+            break;
+        }
+        int taken = 0;
+        for (int i = 0; i < batch->name_count && !taken; i++)
+            taken = strcmp(batch->names[i], job->out_path) == 0;
+        if (taken)
+            continue;
+        fd = open(job->out_path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (fd < 0 && errno != EEXIST) {
+            snprintf(job->error, sizeof(job->error), "cannot create journal: %s", strerror(errno));
+            break;
+        }
+        if (fd < 0 && !job->kept[0])
+            snprintf(job->kept, sizeof(job->kept), "%s", job->out_path);
+    }
+    if (fd >= 0) {
+        if (batch->name_count == batch->name_capacity)
+            batch->names = batch_grow(batch->names, &batch->name_capacity, sizeof(char *));
+        batch->names[batch->name_count++] = batch_strdup(job->out_path);
+    }
+    pthread_mutex_unlock(&batch->names_lock);
+    return fd;
+}
+
+static void batch_convert(void *arg, int worker) {
+    BatchJob *job = arg;
+    Batch *batch = job->batch;
+    RecordReader reader;
+    struct stat st;
+    (void)worker;
+
+    if (job->error[0])
+        return;
+    int fd = open(job->path, O_RDONLY);
+    if (fd < 0) {
+        snprintf(job->error, sizeof(job->error), "cannot open: %s", strerror(errno));
+        return;
+    }
+    if (fstat(fd, &st) == 0)
+        job->bytes = (long long)st.st_size;
+    if (!reader_init(&reader, fd)) {
+        snprintf(job->error, sizeof(job->error), "out of memory");
+        close(fd);
+        return;
+    }
+
+    char name[256];
+    char dir[PATH_MAX];
+    journal_file_name(&reader, name, sizeof(name));
+    parent_dir(job->path, dir, sizeof(dir));
+
+    JournalWriter output;
+    int out_fd = batch_create_journal(job, dir, name);
+    if (out_fd >= 0 && !jwriter_init(&output, out_fd, JOURNAL_LAYOUT_CPTE_LIBELLE)) {
+        snprintf(job->error, sizeof(job->error), "out of memory");
+        close(out_fd);
+        unlink(job->out_path);
+    } else if (out_fd >= 0) {
+        job->entries = convert_statement(&reader, &output, &batch->charts[job->chart].chart,
+                                         &batch->rules[job->rules].rules);
+        int written = jwriter_close(&output);
+        if (close(out_fd) != 0)
+            written = 0;
+        if (!written && job->entries > 0)
+            snprintf(job->error, sizeof(job->error), "cannot write journal");
+        else if (job->entries == CONVERT_NO_MEMORY)
+            snprintf(job->error, sizeof(job->error), "out of memory");
+        else if (job->entries < 0)
+            snprintf(job->error, sizeof(job->error), "no statement header line");
+        else if (job->entries == 0)
+            snprintf(job->error, sizeof(job->error), "no operation converted");
+        if (job->error[0])
+            unlink(job->out_path);
+    }
+    reader_free(&reader);
+    close(fd);
+}
+
+static void batch_usage(const char *program_name) {
+    printf("Usage: %s --batch [-j threads] [--chart file] [--rules file] [--history journal]...\n",
+           program_name);
+    printf("       <statement|directory>...\n");
+    printf("Converts every statement given or found under the directories (files with a\n");
+    printf("Date, Nature de l'operation, Debit, Credit header row), writing each journal next\n");
+    printf("to its statement. A file already at the name of a journal is kept, the journal\n");
+    printf("is written as \"<name> (2).csv\" instead.\n");
+    printf("The chart (Plan Comptable*.csv) and Regles JB.csv are looked up in the statement\n");
+    printf("folder and its parents, and each distinct file is loaded once.\n");
+    printf("The --history journals are learned once and used for every statement.\n");
+}
+
+int run_batch(const char *program_name, int argc, char *argv[]) {
+    Batch batch;
+    int threads = 0;
+    int first_path = argc;
+    char *history_files[MAX_HISTORY_FILES];
+    int history_count = 0;
+
+    memset(&batch, 0, sizeof(batch));
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--chart") == 0 && i + 1 < argc) {
+            batch.chart_option = argv[++i];
+        } else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            batch.rules_option = argv[++i];
+        } else if (strcmp(argv[i], "--history") == 0 && i + 1 < argc && history_count < MAX_HISTORY_FILES) {
+            history_files[history_count++] = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1]) {
+            batch_usage(program_name);
+            return 1;
+        } else {
+            first_path = i;
+            break;
+        }
+    }
+    if (first_path == argc) {
+        batch_usage(program_name);
+        return 1;
+    }
+
+    // Collect the statements and the charts and rules they use
+    for (int i = first_path; i < argc; i++) {
+        char root[PATH_MAX];
+        struct stat st;
+        size_t len = strlen(argv[i]);
+        if (len >= sizeof(root)) {
+            fprintf(stderr, "Warning: Path too long: %s\n", argv[i]);
+            continue;
+        }
+        memcpy(root, argv[i], len + 1);
+        while (len > 1 && root[len - 1] == '/')
+            root[--len] = '\0';
+        if (stat(root, &st) != 0) {
+            fprintf(stderr, "Warning: Could not open %s\n", argv[i]);
+        } else if (S_ISDIR(st.st_mode)) {
+            batch_walk(&batch, root, root);
+        } else {
+            char dir[PATH_MAX];
+            parent_dir(root, dir, sizeof(dir));
+            batch_add_statement(&batch, root, dir);
+        }
+    }
+    if (batch.job_count == 0) {
+        fprintf(stderr, "Error: No bank statement found\n");
+        return 2;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Load each distinct chart and rules file once
+    for (int i = 0; i < batch.chart_count; i++) {
+        if (load_chart_of_accounts(batch.charts[i].path, &batch.charts[i].chart) == 0)
+            fprintf(stderr, "Warning: No accounts loaded from %s. Using default account codes.\n",
+                    batch.charts[i].path);
+    }
+    for (int i = 0; i < batch.rules_count; i++) {
+        if (load_classification_rules(batch.rules[i].path, &batch.rules[i].rules) == 0)
+            fprintf(stderr, "Warning: No classification rules loaded from %s\n", batch.rules[i].path);
+    }
+
+    // Learn the history journals once, then share the mapping with every rules file
+    LabelHistory history;
+    memset(&history, 0, sizeof(history));
+    if (!learn_history_files(&history, history_files, history_count)) {
+        free_history(&history);
+        return 2;
+    }
+    for (int i = 0; i < batch.rules_count; i++)
+        batch.rules[i].rules.history = history;
+
+    // Convert the statements on the pool
+    Pool pool;
+    pthread_mutex_init(&batch.names_lock, NULL);
+    if (!pool_init(&pool, threads)) {
+        fprintf(stderr, "Error: Could not start worker threads\n");
+        return 2;
+    }
+    for (int i = 0; i < batch.job_count; i++) {
+        if (!pool_submit(&pool, batch_convert, &batch.jobs[i]))
+            batch_convert(&batch.jobs[i], 0);
+    }
+    pool_wait(&pool);
+    int thread_count = pool.thread_count;
+    pool_destroy(&pool);
+    pthread_mutex_destroy(&batch.names_lock);
+    double seconds = elapsed_since(&start);
+
+    // Summary
+    int failed = 0, renamed = 0;
+    long long entries = 0, bytes = 0;
+    for (int i = 0; i < batch.job_count; i++) {
+        BatchJob *job = &batch.jobs[i];
+        bytes += job->bytes;
+        if (job->error[0]) {
+            failed++;
+        } else {
+            entries += job->entries;
+            renamed += job->kept[0] != '\0';
+            printf("%s -> %s (%d entries)\n", job->path, job->out_path, job->entries);
+        }
+    }
+    double mb = (double)bytes / (1024.0 * 1024.0);
+    printf("Batch: %d statement(s), %d converted, %d failed, %d renamed, %lld journal entries\n",
+           batch.job_count, batch.job_count - failed, failed, renamed, entries);
+    printf("       %.2f MB in %.3f s (%.1f MB/s, %.1f statements/s), %d thread(s), %d chart(s)\n",
+           mb, seconds, seconds > 0 ? mb / seconds : 0.0, seconds > 0 ? batch.job_count / seconds : 0.0,
+           thread_count, batch.chart_count);
+    for (int i = 0; i < batch.job_count; i++) {
+        if (!batch.jobs[i].error[0] && batch.jobs[i].kept[0])
+            printf("Kept: %s already exists, journal written to %s\n", batch.jobs[i].kept,
+                   batch.jobs[i].out_path);
+    }
+    for (int i = 0; i < batch.job_count; i++) {
+        if (batch.jobs[i].error[0])
+            printf("Failed: %s: %s\n", batch.jobs[i].path, batch.jobs[i].error);
+    }
+
+    // Release everything
+    for (int i = 0; i < batch.job_count; i++)
+        free(batch.jobs[i].path);
+    for (int i = 0; i < batch.chart_count; i++) {
+        free_chart_of_accounts(&batch.charts[i].chart);
+        free(batch.charts[i].path);
+    }
+    for (int i = 0; i < batch.rules_count; i++) {
+        memset(&batch.rules[i].rules.history, 0, sizeof(LabelHistory));
+        free_classification_rules(&batch.rules[i].rules);
+        free(batch.rules[i].path);
+    }
+    free_history(&history);
+    for (int i = 0; i < batch.name_count; i++)
+        free(batch.names[i]);
+    free(batch.jobs);
+    free(batch.charts);
+    free(batch.rules);
+    free(batch.names);
+
+    return failed ? 4 : 0;
+}
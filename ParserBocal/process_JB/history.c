@@ -0,0 +1,244 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   history.c                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:15:34 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/16 15:15:34 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "process.h"
+
+// Accounts learned from past journals (--history). Every row of a journal
+// books a libelle to an account; the rows of the bank account itself (512*)
+// say nothing about the operation and are left out. Libelles are normalized
+// (letters upper-cased, digits kept, every other run of ASCII bytes turned
+// into one space) and hashed into an open addressing table. Each label keeps
+// the accounts it was booked to with their counts, and the account booked
+// most often; a lookup answers that account only when it has the majority
+// of the bookings of the label, so a generic libelle such as "Prelevement"
+// booked to many suppliers is never learned.
+
+#define HISTORY_KEY_SIZE 256
+#define HISTORY_MAX_FIELDS 16
+
+static uint64_t hash_label(const char *s, size_t len) {
+    // 64-bit FNV-1a, never 0 which marks an empty slot
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ull;
+    }
+    return h ? h : 1;
+}
+
+// Normalized form of a libelle in out, returns its length; bytes of UTF-8
+// sequences are kept so that accented labels stay apart
+static size_t normalize_label(const char *s, size_t len, char *out, size_t size) {
+    size_t n = 0;
+    int space = 0;
+
+    for (size_t i = 0; i < len && n + 1 < size; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (isalnum(c) || c >= 0x80) {
+            if (space && n > 0 && n + 2 < size)
+                out[n++] = ' ';
+            out[n++] = (char)toupper(c);
+            space = 0;
+        } else {
+            space = 1;
+        }
+    }
+    out[n] = '\0';
+    return n;
+}
+
+static uint32_t history_string(LabelHistory *history, const char *s, size_t len) {
+    if (history->strings_len + len + 1 > history->strings_cap) {
+        size_t cap = history->strings_cap ? history->strings_cap * 2 : 4096;
+        while (cap < history->strings_len + len + 1)
+            cap *= 2;
+        char *grown = realloc(history->strings, cap);
+        if (!grown)
+            return UINT32_MAX;
+        history->strings = grown;
+        history->strings_cap = cap;
+    }
+    uint32_t offset = (uint32_t)history->strings_len;
+    memcpy(history->strings + offset, s, len);
+    history->strings[offset + len] = '\0';
+    history->strings_len += len + 1;
+    return offset;
+}
+
+static size_t find_slot(const LabelHistory *history, uint64_t hash, const char *key) {
+    size_t i = (size_t)hash & history->mask;
+    while (history->slots[i].hash &&
+           (history->slots[i].hash != hash || strcmp(history->strings + history->slots[i].label, key) != 0))
+        i = (i + 1) & history->mask;
+    return i;
+}
+
+static int grow_table(LabelHistory *history) {
+    size_t size = history->slots ? (history->mask + 1) * 2 : 256;
+    HistoryLabel *slots = calloc(size, sizeof(HistoryLabel));
+    if (!slots)
+        return 0;
+    for (size_t i = 0; history->slots && i <= history->mask; i++) {
+        if (!history->slots[i].hash)
+            continue;
+        size_t j = (size_t)history->slots[i].hash & (size - 1);
+        while (slots[j].hash)
+            j = (j + 1) & (size - 1);
+        slots[j] = history->slots[i];
+    }
+    free(history->slots);
+    history->slots = slots;
+    history->mask = size - 1;
+    return 1;
+}
+
+static int same_account(Slice account, const char *known) {
+    return strncmp(account.ptr, known, account.len) == 0 && known[account.len] == '\0';
+}
+
+// Count one booking of label to account
+static int history_add(LabelHistory *history, Slice label, Slice account) {
+    char key[HISTORY_KEY_SIZE];
+    size_t len = normalize_label(label.ptr, label.len, key, sizeof(key));
+
+    if (len == 0)
+        return 1;
+    if ((size_t)(history->count + 1) * 2 > (history->slots ? history->mask + 1 : 0) && !grow_table(history))
+        return 0;
+    uint64_t hash = hash_label(key, len);
+    HistoryLabel *slot = &history->slots[find_slot(history, hash, key)];
+    if (!slot->hash) {
+        uint32_t offset = history_string(history, key, len);
+        if (offset == UINT32_MAX)
+            return 0;
+        slot->hash = hash;
+        slot->label = offset;
+        slot->accounts = -1;
+        history->count++;
+    }
+
+    // The accounts of a label, most labels have one or two
+    int32_t a = slot->accounts;
+    while (a >= 0 && !same_account(account, history->strings + history->accounts[a].account))
+        a = history->accounts[a].next;
+    if (a < 0) {
+        if (history->account_count == history->account_capacity) {
+            int capacity = history->account_capacity ? history->account_capacity * 2 : 256;
+            HistoryAccount *grown = realloc(history->accounts, (size_t)capacity * sizeof(HistoryAccount));
+            if (!grown)
+                return 0;
+            history->accounts = grown;
+            history->account_capacity = capacity;
+        }
+        uint32_t offset = history_string(history, account.ptr, account.len);
+        if (offset == UINT32_MAX)
+            return 0;
+        a = history->account_count++;
+        history->accounts[a].account = offset;
+        history->accounts[a].count = 0;
+        history->accounts[a].next = slot->accounts;
+        slot->accounts = a;
+    }
+    history->accounts[a].count++;
+    slot->total++;
+    if (history->accounts[a].count > slot->best_count) {
+        slot->best = history->accounts[a].account;
+        slot->best_count = history->accounts[a].count;
+    }
+    return 1;
+}
+
+static int is_column(Slice field, const char *name) {
+    field = slice_clean(field);
+    return field.len >= strlen(name) && strncasecmp(field.ptr, name, strlen(name)) == 0;
+}
+
+int learn_history(LabelHistory *history, const char *filename) {
+    size_t size;
+    char *data = csv_read_file(filename, &size);
+    if (!data) {
+        fprintf(stderr, "Warning: Could not open history journal %s\n", filename);
+        return 0;
+    }
+
+    CsvScanner scanner;
+    Slice record;
+    Slice fields[HISTORY_MAX_FIELDS];
+    int account_column = -1;
+    int label_column = -1;
+    int rows = 0;
+
+    csv_init(&scanner, data, size);
+    while (csv_next_record(&scanner, &record)) {
+        char delimiter = memchr(record.ptr, ';', record.len) ? ';' : ',';
+        int count = csv_split((char *)record.ptr, record.len, delimiter, fields, HISTORY_MAX_FIELDS);
+
+        // Column headers first: cpte or Compte, Libelle, in the order of the journal
+        if (label_column < 0 || account_column < 0) {
+            account_column = label_column = -1;
+            for (int i = 0; i < count; i++) {
+                if (is_column(fields[i], "cpte") || is_column(fields[i], "compte"))
+                    account_column = i;
+                else if (is_column(fields[i], "libell"))
+                    label_column = i;
+            }
+            continue;
+        }
+        if (count <= account_column || count <= label_column)
+            continue;
+        Slice account = slice_clean(fields[account_column]);
+        Slice label = slice_clean(fields[label_column]);
+        if (account.len == 0 || (account.len >= 3 && memcmp(account.ptr, "512", 3) == 0))
+            continue;
+        if (!history_add(history, label, account)) {
+            fprintf(stderr, "Error: Out of memory while learning %s\n", filename);
+            free(data);
+            return -1;
+        }
+        rows++;
+    }
+    free(data);
+    if (label_column < 0 || account_column < 0)
+        fprintf(stderr, "Warning: No cpte and Libelle columns in %s\n", filename);
+    else
+        printf("Learned %d bookings from %s\n", rows, filename);
+    return rows;
+}
+
+int learn_history_files(LabelHistory *history, char *const *paths, int count) {
+    for (int i = 0; i < count; i++) {
+        if (learn_history(history, paths[i]) < 0)
+            return 0;
+    }
+    return 1;
+}
+
+const char *history_account(const LabelHistory *history, Slice label) {
+    char key[HISTORY_KEY_SIZE];
+
+    if (history->count == 0)
+        return NULL;
+    size_t len = normalize_label(label.ptr, label.len, key, sizeof(key));
+    if (len == 0)
+        return NULL;
+    const HistoryLabel *slot = &history->slots[find_slot(history, hash_label(key, len), key)];
+    if (!slot->hash || slot->best_count * 2 <= slot->total)
+        return NULL;
+    return history->strings + slot->best;
+}
+
+void free_history(LabelHistory *history) {
+    free(history->strings);
+    free(history->slots);
+    free(history->accounts);
+    memset(history, 0, sizeof(*history));
+}
@@ -0,0 +1,361 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   incremental.c                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:58:05 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:28:48 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "process.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Incremental mode (-i): the statement of the current month is downloaded
+// again and again as it grows, and only its new operations need converting.
+// A state file next to the journal, .<journal>.state, lists a fingerprint of
+// each record already converted with the size of the journal once it was
+// written. The next run reads the records that follow the column headers and
+// only fingerprints them as long as they match the state; the journal is cut
+// after the last matching record and the rest is classified and appended.
+// The state is ignored, and the journal written again, when the journal, the
+// chart, the rules or the history journals changed since the last run.
+
+#define STATE_MAGIC "JBSTATE"
+#define STATE_FORMAT 2
+#define STATE_PATH_SIZE 1024
+
+// Size and mtime of a file, zero if it does not exist
+typedef struct {
+    long long size;
+    long long mtime;
+    long long mtime_nsec;
+} FileStamp;
+
+typedef struct {
+    unsigned long long fingerprint;
+    unsigned long long end;         // journal size once the record is converted
+    int entries;                    // journal entries up to this record included
+} StateRecord;
+
+typedef struct {
+    FileStamp journal;
+    FileStamp chart;
+    FileStamp rules;
+    unsigned long long history;     // hash of the paths and stamps of the history journals
+    unsigned long long header_end;  // journal size after its header line
+    StateRecord *records;
+    int count;
+    int capacity;
+} JournalState;
+
+// Chart, rules and classifier, loaded only when a record has to be converted
+typedef struct {
+    ChartOfAccounts chart;
+    RuleSet rules;
+    Classifier classifier;
+    int loaded;
+} Converter;
+
+static void file_stamp(const char *path, FileStamp *stamp) {
+    struct stat st;
+
+    memset(stamp, 0, sizeof(*stamp));
+    if (path && stat(path, &st) == 0) {
+        stamp->size = (long long)st.st_size;
+        stamp->mtime = (long long)st.st_mtime;
+        stamp->mtime_nsec = (long long)STAT_MTIME_NSEC(st);
+    }
+}
+
+static int same_stamp(const FileStamp *a, const FileStamp *b) {
+    return a->size == b->size && a->mtime == b->mtime && a->mtime_nsec == b->mtime_nsec;
+}
+
+// 64-bit FNV-1a of the history journals, in the order given
+static unsigned long long history_stamp(char *const *paths, int count) {
+    unsigned long long h = 14695981039346656037ull;
+    for (int i = 0; i < count; i++) {
+        FileStamp stamp;
+        file_stamp(paths[i], &stamp);
+        const unsigned char *bytes[2] = {(const unsigned char *)paths[i], (const unsigned char *)&stamp};
+        size_t lens[2] = {strlen(paths[i]) + 1, sizeof(stamp)};
+        for (int p = 0; p < 2; p++) {
+            for (size_t j = 0; j < lens[p]; j++) {
+                h ^= bytes[p][j];
+                h *= 1099511628211ull;
+            }
+        }
+    }
+    return h;
+}
+
+// 64-bit FNV-1a of the record line and its continuation lines
+static unsigned long long record_fingerprint(const StatementRecord *record) {
+    unsigned long long h = 14695981039346656037ull;
+    const Slice parts[2] = {slice_between(record->line, record->line + record->len), record->continuation};
+
+    for (int p = 0; p < 2; p++) {
+        for (size_t i = 0; i < parts[p].len; i++) {
+            h ^= (unsigned char)parts[p].ptr[i];
+            h *= 1099511628211ull;
+        }
+        h ^= 0xff;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static int state_push(JournalState *state, unsigned long long fingerprint, unsigned long long end,
+                      int entries) {
+    if (state->count == state->capacity) {
+        int capacity = state->capacity ? state->capacity * 2 : 256;
+        StateRecord *grown = realloc(state->records, (size_t)capacity * sizeof(StateRecord));
+        if (!grown)
+            return 0;
+        state->records = grown;
+        state->capacity = capacity;
+    }
+    state->records[state->count].fingerprint = fingerprint;
+    state->records[state->count].end = end;
+    state->records[state->count++].entries = entries;
+    return 1;
+}
+
+// .<name>.state in the directory of the journal
+static int state_path(const char *out_path, char *out, size_t outsz) {
+    const char *slash = strrchr(out_path, '/');
+    int n;
+
+    if (slash)
+        n = snprintf(out, outsz, "%.*s/.%s.state", (int)(slash - out_path), out_path, slash + 1);
+    else
+        n = snprintf(out, outsz, ".%s.state", out_path);
+    return n > 0 && (size_t)n < outsz;
+}
+
+static int read_stamp(FILE *file, const char *name, FileStamp *stamp) {
+    char key[16];
+    return fscanf(file, "%15s %lld %lld %lld", key, &stamp->size, &stamp->mtime, &stamp->mtime_nsec) == 4 &&
+           strcmp(key, name) == 0;
+}
+
+static int state_load(const char *path, JournalState *state) {
+    FILE *file = fopen(path, "r");
+    char magic[16];
+    int format, count;
+
+    if (!file)
+        return 0;
+    int ok = fscanf(file, "%15s %d", magic, &format) == 2 && strcmp(magic, STATE_MAGIC) == 0 &&
+             format == STATE_FORMAT && read_stamp(file, "journal", &state->journal) &&
+             read_stamp(file, "chart", &state->chart) && read_stamp(file, "rules", &state->rules) &&
+             fscanf(file, " history %llx", &state->history) == 1 &&
+             fscanf(file, " header %llu records %d", &state->header_end, &count) == 2 && count >= 0;
+    for (int i = 0; ok && i < count; i++) {
+        StateRecord r;
+        ok = fscanf(file, "%llx %llu %d", &r.fingerprint, &r.end, &r.entries) == 3 &&
+             state_push(state, r.fingerprint, r.end, r.entries);
+    }
+    fclose(file);
+    return ok;
+}
+
+// Written to a temporary file renamed over the state, so a run interrupted
+// half way leaves the previous state or none
+static int state_save(const char *path, const JournalState *state) {
+    char tmp[STATE_PATH_SIZE + 32];
+    FILE *file;
+
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+    file = fopen(tmp, "w");
+    if (!file)
+        return 0;
+    fprintf(file, "%s %d\n", STATE_MAGIC, STATE_FORMAT);
+    fprintf(file, "journal %lld %lld %lld\n", state->journal.size, state->journal.mtime, state->journal.mtime_nsec);
+    fprintf(file, "chart %lld %lld %lld\n", state->chart.size, state->chart.mtime, state->chart.mtime_nsec);
+    fprintf(file, "rules %lld %lld %lld\n", state->rules.size, state->rules.mtime, state->rules.mtime_nsec);
+    fprintf(file, "history %016llx\n", state->history);
+    fprintf(file, "header %llu\nrecords %d\n", state->header_end, state->count);
+    for (int i = 0; i < state->count; i++) {
+        const StateRecord *r = &state->records[i];
+        fprintf(file, "%016llx %llu %d\n", r->fingerprint, r->end, r->entries);
+    }
+    if (fclose(file) != 0 || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+static int converter_load(Converter *conv, const char *chart_file, const char *rules_file,
+                          char *const *history_files, int history_count) {
+    STATS_LAP_START();
+    if (load_chart_of_accounts(chart_file, &conv->chart) == 0) {
+        fprintf(stderr, "Warning: No accounts loaded from %s. Using default account codes.\n", chart_file);
+    }
+    STATS_LAP(STAT_STAGE_LOAD_CHART);
+    if (load_classification_rules(rules_file, &conv->rules) == 0) {
+        fprintf(stderr, "Error: No classification rules available\n");
+        free_classification_rules(&conv->rules);
+        free_chart_of_accounts(&conv->chart);
+        return 0;
+    }
+    if (!learn_history_files(&conv->rules.history, history_files, history_count)) {
+        free_classification_rules(&conv->rules);
+        free_chart_of_accounts(&conv->chart);
+        return 0;
+    }
+    if (!classifier_init(&conv->classifier, &conv->chart, &conv->rules)) {
+        fprintf(stderr, "Error: Out of memory\n");
+        free_classification_rules(&conv->rules);
+        free_chart_of_accounts(&conv->chart);
+        return 0;
+    }
+    STATS_LAP(STAT_STAGE_LOAD_RULES);
+    conv->loaded = 1;
+    return 1;
+}
+
+static void converter_free(Converter *conv) {
+    if (!conv->loaded)
+        return;
+    classifier_free(&conv->classifier);
+    free_classification_rules(&conv->rules);
+    free_chart_of_accounts(&conv->chart);
+}
+
+// Cut the journal after the records kept and start appending to it; a journal
+// without a usable state is written again from its header
+static int start_output(JournalWriter *output, int fd, JournalState *state, unsigned long long keep,
+                        int resume) {
+    if (!resume)
+        keep = 0;
+    if (ftruncate(fd, (off_t)keep) != 0 || lseek(fd, (off_t)keep, SEEK_SET) < 0 ||
+        !jwriter_init(output, fd, JOURNAL_LAYOUT_CPTE_LIBELLE))
+        return 0;
+    if (!resume) {
+        jwriter_header(output);
+        state->header_end = jwriter_tell(output);
+    }
+    output->flushed = (size_t)keep;
+    return 1;
+}
+
+// Bring the journal at out_path up to date with the statement
+int update_bank_journal(RecordReader *reader, const char *out_path, const char *chart_of_accounts_file,
+                        const char *rules_file, char *const *history_files, int history_count) {
+    JournalState old, state;
+    JournalWriter output;
+    Converter conv;
+    StatementRecord record;
+    FileStamp journal_stamp;
+    char path[STATE_PATH_SIZE];
+    int kept = 0;
+    int writing = 0;
+    int entries = 0;
+    int ok = 1;
+    unsigned long long written_from = 0;
+
+    memset(&old, 0, sizeof(old));
+    memset(&state, 0, sizeof(state));
+    memset(&conv, 0, sizeof(conv));
+    if (!state_path(out_path, path, sizeof(path))) {
+        fprintf(stderr, "Error: Output path too long: %s\n", out_path);
+        return -1;
+    }
+    file_stamp(out_path, &journal_stamp);
+    file_stamp(chart_of_accounts_file, &state.chart);
+    file_stamp(rules_file, &state.rules);
+    state.history = history_stamp(history_files, history_count);
+
+    // The state only describes a journal nobody touched, made with the same chart, rules and history
+    int resume = state_load(path, &old) && journal_stamp.size > 0 && same_stamp(&old.journal, &journal_stamp) &&
+                 same_stamp(&old.chart, &state.chart) && same_stamp(&old.rules, &state.rules) &&
+                 old.history == state.history;
+    if (!resume)
+        old.count = 0;
+    state.header_end = old.header_end;
+    unsigned long long keep = old.header_end;
+
+    if (!find_statement_header(reader)) {
+        free(old.records);
+        return -1;
+    }
+    int fd = open(out_path, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not create output file %s\n", out_path);
+        free(old.records);
+        return -1;
+    }
+
+    STATS_LAP_START();
+    while (ok && reader_next_record(reader, &record)) {
+        STATS_LAP(STAT_STAGE_READ);
+        if (record.len == 0)
+            continue;
+        unsigned long long fingerprint = record_fingerprint(&record);
+
+        // Already in the journal: nothing to classify
+        if (!writing && kept < old.count && old.records[kept].fingerprint == fingerprint) {
+            const StateRecord *r = &old.records[kept++];
+            keep = r->end;
+            entries = r->entries;
+            ok = state_push(&state, fingerprint, r->end, r->entries);
+            continue;
+        }
+
+        if (!writing) {
+            if (!start_output(&output, fd, &state, keep, resume)) {
+                ok = 0;
+                break;
+            }
+            writing = 1;
+            written_from = resume ? keep : 0;
+            if (!converter_load(&conv, chart_of_accounts_file, rules_file, history_files, history_count)) {
+                ok = 0;
+                break;
+            }
+        }
+        int converted = convert_statement_record(&record, &output, &conv.classifier);
+        if (converted < 0) {
+            fprintf(stderr, "Error: Out of memory\n");
+            ok = 0;
+            break;
+        }
+        entries += converted;
+        ok = state_push(&state, fingerprint, jwriter_tell(&output), entries);
+    }
+
+    // A fresh journal, or a statement shorter than the last one, still needs writing
+    if (ok && !writing && (!resume || kept < old.count)) {
+        ok = start_output(&output, fd, &state, keep, resume);
+        writing = ok;
+        written_from = resume ? keep : 0;
+    }
+    if (writing)
+        STATS_ADD(STAT_BYTES_WRITTEN, jwriter_tell(&output) - written_from);
+    if (writing && !jwriter_close(&output))
+        ok = 0;
+    if (close(fd) != 0)
+        ok = 0;
+    converter_free(&conv);
+
+    if (ok) {
+        file_stamp(out_path, &state.journal);
+        if (!state_save(path, &state))
+            fprintf(stderr, "Warning: Could not save %s, the next run converts everything\n", path);
+        printf("%d records unchanged, %d converted\n", kept, state.count - kept);
+    } else {
+        fprintf(stderr, "Error: Could not write output file %s\n", out_path);
+        unlink(path);
+        entries = -1;
+    }
+    free(old.records);
+    free(state.records);
+    return entries;
+}
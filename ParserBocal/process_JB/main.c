@@ -6,109 +6,165 @@
 /*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/05/03 12:12:34 by igilbert          #+#    #+#             */
-/*   Updated: 2025/09/24 11:27:34 by igilbert         ###   ########.fr       */
+/*   Updated: 2026/10/16 15:15:52 by igilbert         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
 #include "process.h"
+#include "../common/pool.h"
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <fcntl.h>
 #include <unistd.h>
-#include <time.h>
-
-static void get_month_name(int month, char *out, size_t outsz) {
-    const char *months[] = {"Janvier","Fevrier","Mars","Avril","Mai","Juin","Juillet","Aout","Septembre","Octobre","Novembre","Decembre"};
-    if (month >= 1 && month <= 12) {
-        snprintf(out, outsz, "%s", months[month-1]);
-    } else {
-        snprintf(out, outsz, "Inconnu");
-    }
-}
-
-static int extract_first_date_mm_yyyy(FILE *in, int *out_month, int *out_year) {
-    char line[MAX_LINE_SIZE];
-    long pos = ftell(in);
-    int d = 0, m = 0, y = 0;
-    while (fgets(line, sizeof(line), in)) {
-        // Look for DD/MM/YYYY at start or anywhere in line
-        for (char *p = line; *p; ++p) {
-            if (sscanf(p, "%2d/%2d/%4d", &d, &m, &y) == 3) {
-                if (m >= 1 && m <= 12 && y >= 1900) {
-                    *out_month = m; *out_year = y;
-                    fseek(in, pos, SEEK_SET);
-                    return 1;
-                }
-            }
-        }
-    }
-    fseek(in, pos, SEEK_SET);
-    return 0;
-}
 
 void print_usage(const char *program_name) {
-    printf("Usage: %s <input_file> [chart_of_accounts_file]\n", program_name);
+    printf("Usage: %s [-j threads] [-i] [--history journal]... [--stats[=file]] <input_file>\n", program_name);
+    printf("       [chart_of_accounts_file] [rules_file]\n");
+    printf("Use - as input_file to read the statement from stdin.\n");
+    printf("With -j, a large statement is split in chunks converted in parallel (0 = all cores).\n");
+    printf("With -i, only the operations missing from the journal are converted and appended;\n");
+    printf("the journal keeps its state in .{journal}.state next to it.\n");
+    printf("With --history, the libelles of past journals go to the account most of their\n");
+    printf("bookings went to, before the accounts of the rules; the option can be repeated.\n");
+    printf("With --stats, counters and stage timings are reported as a JSON line on stderr,\n");
+    printf("or appended to file.\n");
+    printf("       %s --batch [-j threads] [--chart file] [--rules file] <statement|directory>...\n",
+           program_name);
+    printf("Converts many statements in parallel, see %s --batch for details.\n", program_name);
     printf("Creates ./Journal Bq {Mois} {Annee}.csv based on the input data date.\n");
     printf("If chart_of_accounts_file is not specified, Plan Comptable 2025.csv will be used.\n");
+    printf("If rules_file is not specified, Regles JB.csv is used when present, built-in rules otherwise.\n");
 }
 
 int main(int argc, char *argv[]) {
-    FILE *input_file;
-    FILE *output_file;
+    RecordReader input;
+    int input_fd;
+    JournalWriter output;
+    int output_fd;
     int lines_processed;
     const char *chart_of_accounts_file = "Plan Comptable 2025.csv";
+    const char *rules_file = NULL;
+    int threads = 1;
+    int incremental = 0;
+    int counting = 0;
+    const char *stats_path = NULL;
+    Stats stats;
+    char *history_files[MAX_HISTORY_FILES];
+    int history_count = 0;
     
+    // Batch mode: many statements, each chart loaded once
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {
+        return run_batch(argv[0], argc - 2, argv + 2);
+    }
+
+    // Options before the input file
+    while (argc >= 2) {
+        if (argc >= 3 && strcmp(argv[1], "-j") == 0) {
+            // Parallel conversion of one large statement
+            threads = atoi(argv[2]);
+            if (threads <= 0)
+                threads = pool_default_threads();
+            argv[2] = argv[0];
+            argv += 2;
+            argc -= 2;
+        } else if (strcmp(argv[1], "-i") == 0) {
+            // Incremental update of the journal of a growing statement
+            incremental = 1;
+            argv[1] = argv[0];
+            argv++;
+            argc--;
+        } else if (argc >= 3 && strcmp(argv[1], "--history") == 0) {
+            // Past journal to learn the accounts of its libelles from
+            if (history_count == MAX_HISTORY_FILES) {
+                fprintf(stderr, "Error: More than %d history journals\n", MAX_HISTORY_FILES);
+                return 1;
+            }
+            history_files[history_count++] = argv[2];
+            argv[2] = argv[0];
+            argv += 2;
+            argc -= 2;
+        } else if (stats_option(argv[1], &stats_path)) {
+            counting = 1;
+            argv[1] = argv[0];
+            argv++;
+            argc--;
+        } else {
+            break;
+        }
+    }
+
     // Check command line arguments
-    if (argc < 2 || argc > 3) {
+    if (argc < 2 || argc > 4) {
         print_usage(argv[0]);
         return 1;
     }
     
     // If chart of accounts file is provided, use it
-    if (argc == 3) {
+    if (argc >= 3) {
         chart_of_accounts_file = argv[2];
     }
+
+    // Classification rules: explicit file, else Regles JB.csv if present, else built-in
+    if (argc == 4) {
+        rules_file = argv[3];
+    } else if (access("Regles JB.csv", R_OK) == 0) {
+        rules_file = "Regles JB.csv";
+    }
+    if (counting)
+        stats_start(&stats);
     
-    // Open input file
-    input_file = fopen(argv[1], "r");
-    if (!input_file) {
+    // Open input file, or read stdin for "-"
+    input_fd = strcmp(argv[1], "-") == 0 ? STDIN_FILENO : open(argv[1], O_RDONLY);
+    if (input_fd < 0) {
         fprintf(stderr, "Error: Could not open input file %s\n", argv[1]);
         return 2;
     }
-    
-    // Determine month/year from input and build output path ./stuffs/Journal Bq {Mois} {Annee}.csv
-    int month = 0, year = 0;
-    char month_name[16];
-    if (!extract_first_date_mm_yyyy(input_file, &month, &year)) {
-        // Fallback to current month/year if not found
-        time_t now = time(NULL);
-        struct tm *tm = localtime(&now);
-        month = tm ? (tm->tm_mon + 1) : 1;
-        year = tm ? (tm->tm_year + 1900) : 1970;
+    if (!reader_init(&input, input_fd)) {
+        fprintf(stderr, "Error: Out of memory\n");
+        if (input_fd != STDIN_FILENO) close(input_fd);
+        return 2;
     }
-    get_month_name(month, month_name, sizeof(month_name));
-
+    
+    // Determine month/year from input and build output path ./Journal Bq {Mois} {Annee}.csv
     char out_path[512];
-    snprintf(out_path, sizeof(out_path), "Journal Bq %s %d.csv", month_name, year);
+    journal_file_name(&input, out_path, sizeof(out_path));
 
-    // Open output file
-    output_file = fopen(out_path, "w");
-    if (!output_file) {
-        fprintf(stderr, "Error: Could not create output file %s\n", out_path);
-        fclose(input_file);
-        return 3;
+    if (incremental) {
+        // Only the new operations are converted, sequentially
+        lines_processed = update_bank_journal(&input, out_path, chart_of_accounts_file, rules_file,
+                                              history_files, history_count);
+        reader_free(&input);
+        if (input_fd != STDIN_FILENO) close(input_fd);
+    } else {
+        // Open output file
+        output_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (output_fd < 0 || !jwriter_init(&output, output_fd, JOURNAL_LAYOUT_CPTE_LIBELLE)) {
+            fprintf(stderr, "Error: Could not create output file %s\n", out_path);
+            reader_free(&input);
+            if (input_fd != STDIN_FILENO) close(input_fd);
+            return 3;
+        }
+
+        // Process the file
+        lines_processed = process_bank_statement(&input, &output, chart_of_accounts_file, rules_file,
+                                                 history_files, history_count, threads);
+
+        // Close files
+        reader_free(&input);
+        if (input_fd != STDIN_FILENO) close(input_fd);
+        STATS_ADD(STAT_BYTES_WRITTEN, jwriter_tell(&output));
+        if (!jwriter_close(&output) || close(output_fd) != 0) {
+            fprintf(stderr, "Error: Could not write output file %s\n", out_path);
+            lines_processed = -1;
+        }
     }
-    
-    // Process the file
-    lines_processed = process_csv_file(input_file, output_file, chart_of_accounts_file);
-    
-    // Close files
-    fclose(input_file);
-    fclose(output_file);
-    
+
     if (lines_processed > 0) {
         printf("Successfully processed %d lines.\n", lines_processed);
         printf("Output written to %s\n", out_path);
     }
+    if (counting && !stats_report(&stats, STATS_JB, argv[1], lines_processed > 0, stats_path))
+        lines_processed = -1;
     
     return (lines_processed > 0) ? 0 : 4;
 }
@@ -0,0 +1,147 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   parallel.c                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:35:35 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:28:48 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "process.h"
+#include "../common/pool.h"
+
+// Intra-file parallelism for very large statements. The whole input is read
+// into memory, then the operations after the header are cut into chunks at
+// record boundaries: a chunk always starts on a line that is not a
+// continuation line, so an operation keeps its BT/creditor lines exactly as
+// in a sequential run. Each chunk is converted on a worker into its own
+// memory writer and the buffers are written back in input order, which makes
+// the output byte-identical to the sequential conversion.
+
+#define CHUNK_MIN_SIZE (256 * 1024)
+#define CHUNKS_PER_THREAD 4
+
+typedef struct {
+    char *data;
+    size_t len;
+    const ChartOfAccounts *chart;
+    const RuleSet *rules;
+    const CsvDialect *dialect; // of the whole statement
+    JournalWriter out;
+    int entries;
+    Stats *stats;           // counters of the chunk with --stats, NULL otherwise
+} StatementChunk;
+
+static void convert_chunk(void *arg, int worker) {
+    StatementChunk *chunk = arg;
+    RecordReader reader;
+    Classifier classifier;
+    Stats *caller = stats_current;
+    (void)worker;
+
+    // The chunk counts on whichever thread runs it, the stats are merged afterwards
+    stats_current = chunk->stats;
+    chunk->entries = CONVERT_NO_MEMORY;
+    if (!jwriter_init(&chunk->out, -1, JOURNAL_LAYOUT_CPTE_LIBELLE))
+        return;
+    if (classifier_init(&classifier, chunk->chart, chunk->rules)) {
+        reader_init_memory(&reader, chunk->data, chunk->len);
+        reader.dialect = *chunk->dialect;
+        reader.sniffed = 1;
+        chunk->entries = convert_statement_records(&reader, &chunk->out, &classifier);
+        reader_free(&reader);
+        classifier_free(&classifier);
+    }
+    if (chunk->out.failed)
+        chunk->entries = CONVERT_NO_MEMORY;
+    stats_current = caller;
+}
+
+// Start of the first record after pos: the next line start that is not a continuation.
+// Lines already seen by the reader end with '\0' instead of '\n', data[len] is '\0'.
+static size_t next_record_start(const char *data, size_t len, size_t pos, const CsvDialect *dialect) {
+    do {
+        pos += strcspn(data + pos, "\n") + 1;
+    } while (pos < len && statement_continuation(data + pos, strcspn(data + pos, "\n"), dialect));
+    return pos < len ? pos : len;
+}
+
+int convert_statement_parallel(RecordReader *reader, JournalWriter *output, const ChartOfAccounts *chart,
+                               const RuleSet *rules, int threads) {
+    if (!reader_load_all(reader)) {
+        fprintf(stderr, "Error: Out of memory while reading input\n");
+        return -1;
+    }
+    if (!convert_statement_header(reader, output))
+        return -1;
+
+    char *data = reader->buf + reader->start;
+    size_t len = reader->end - reader->start;
+    int chunk_count = threads * CHUNKS_PER_THREAD;
+    if ((size_t)chunk_count > len / CHUNK_MIN_SIZE + 1)
+        chunk_count = (int)(len / CHUNK_MIN_SIZE + 1);
+
+    StatementChunk *chunks = calloc((size_t)chunk_count, sizeof(StatementChunk));
+    Stats *chunk_stats = stats_current ? calloc((size_t)chunk_count, sizeof(Stats)) : NULL;
+    if (!chunks || (stats_current && !chunk_stats)) {
+        free(chunks);
+        free(chunk_stats);
+        fprintf(stderr, "Error: Out of memory\n");
+        return -1;
+    }
+
+    // Cut the body at record boundaries; each cut ends the previous chunk with '\0'
+    int count = 0;
+    size_t start = 0;
+    for (int k = 1; k <= chunk_count && start < len; k++) {
+        size_t cut = len / (size_t)chunk_count * (size_t)k;
+        size_t end = k == chunk_count ? len : next_record_start(data, len, cut > start ? cut - 1 : start,
+                                                                   &reader->dialect);
+        if (end <= start)
+            continue;
+        if (end < len)
+            data[end - 1] = '\0';
+        chunks[count].data = data + start;
+        chunks[count].len = end - start;
+        chunks[count].chart = chart;
+        chunks[count].rules = rules;
+        chunks[count].dialect = &reader->dialect;
+        chunks[count].stats = chunk_stats ? &chunk_stats[count] : NULL;
+        count++;
+        start = end;
+    }
+
+    Pool pool;
+    if (!pool_init(&pool, threads)) {
+        for (int i = 0; i < count; i++)
+            convert_chunk(&chunks[i], 0);
+    } else {
+        for (int i = 0; i < count; i++) {
+            if (!pool_submit(&pool, convert_chunk, &chunks[i]))
+                convert_chunk(&chunks[i], 0);
+        }
+        pool_wait(&pool);
+        pool_destroy(&pool);
+    }
+
+    // Stitch the chunks back in input order
+    int total_entries = 0;
+    for (int i = 0; i < count; i++) {
+        if (chunks[i].entries < 0) {
+            fprintf(stderr, "Error: Could not convert part %d of the statement\n", i + 1);
+            total_entries = chunks[i].entries;
+        } else if (total_entries >= 0) {
+            jwriter_write(output, chunks[i].out.buf, chunks[i].out.len);
+            total_entries += chunks[i].entries;
+        }
+        jwriter_close(&chunks[i].out);
+        if (chunk_stats)
+            stats_merge(stats_current, &chunk_stats[i]);
+    }
+    free(chunk_stats);
+    free(chunks);
+    return total_entries;
+}
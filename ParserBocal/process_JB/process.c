@@ -6,30 +6,55 @@
 /*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/05/03 12:12:37 by igilbert          #+#    #+#             */
-/*   Updated: 2025/09/08 15:18:39 by igilbert         ###   ########.fr       */
+/*   Updated: 2026/10/17 01:28:48 by igilbert         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
 #include "process.h"
+#include <time.h>
 
 // --- helpers ---------------------------------------------------------------
-static void build_401_from_label(const char *label, char *out, size_t outsz) {
+// Same as clean_string, without touching the bytes: trim, unquote, trim
+Slice slice_clean(Slice s) {
+    while (s.len > 0 && isspace((unsigned char)s.ptr[s.len - 1])) s.len--;
+    while (s.len > 0 && isspace((unsigned char)*s.ptr)) { s.ptr++; s.len--; }
+    if (s.len >= 2 && ((s.ptr[0] == '"' && s.ptr[s.len - 1] == '"') ||
+                       (s.ptr[0] == '\'' && s.ptr[s.len - 1] == '\''))) {
+        s.ptr++;
+        s.len -= 2;
+    }
+    while (s.len > 0 && isspace((unsigned char)s.ptr[s.len - 1])) s.len--;
+    while (s.len > 0 && isspace((unsigned char)*s.ptr)) { s.ptr++; s.len--; }
+    return s;
+}
+
+// Clean a field of a writable line and terminate it in place so it is also a C string
+static Slice clean_field(char *start, char *end) {
+    Slice s = slice_clean(slice_between(start, end));
+    ((char *)s.ptr)[s.len] = '\0';
+    return s;
+}
+
+static Slice build_401_from_label(Slice label, Arena *arena) {
     // Build account like 401 + UPPERCASE(ALNUM(label)) with spaces and punctuation removed
-    if (!out || outsz == 0) return;
+    char *out = arena_alloc(arena, label.len + 4);
     size_t j = 0;
-    if (outsz > 1) out[j++] = '4';
-    if (j < outsz - 1) out[j++] = '0';
-    if (j < outsz - 1) out[j++] = '1';
-    if (!label) { out[j] = '\0'; return; }
-    for (const unsigned char *p = (const unsigned char *)label; *p && j < outsz - 1; ++p) {
-        unsigned char c = *p;
+    if (!out)
+        return slice_cstr("");
+    out[j++] = '4';
+    out[j++] = '0';
+    out[j++] = '1';
+    for (size_t i = 0; i < label.len; i++) {
+        unsigned char c = (unsigned char)label.ptr[i];
         if (isalnum(c)) {
             out[j++] = (char)toupper(c);
         }
         // Skip non-alnum (spaces, punctuation, diacritics bytes)
     }
     out[j] = '\0';
+    return slice_between(out, out + j);
 }
+
 static void trim_whitespace(char *s) {
     if (!s) return;
     // Trim trailing CR/LF/space
@@ -56,48 +81,52 @@ static void remove_surrounding_quotes(char *s) {
     }
 }
 
-static int icompare(const char *a, const char *b) {
-    // case-insensitive strcmp
-    unsigned char ca, cb;
-    while (*a && *b) {
-        ca = (unsigned char)tolower((unsigned char)*a);
-        cb = (unsigned char)tolower((unsigned char)*b);
-        if (ca != cb) return (int)ca - (int)cb;
-        a++; b++;
-    }
-    return (int)(unsigned char)tolower((unsigned char)*a) - (int)(unsigned char)tolower((unsigned char)*b);
+// Amount of a statement column; an empty or unreadable column counts as zero
+static Money parse_amount(Slice text) {
+    Money amount;
+    money_parse(text.ptr, text.len, &amount);
+    return amount;
 }
 
-static int icontains(const char *haystack, const char *needle) {
-    if (!haystack || !needle || !*needle) return 0;
-    size_t nlen = strlen(needle);
-    for (const char *p = haystack; *p; p++) {
-        if (strncasecmp(p, needle, nlen) == 0) return 1;
-    }
-    return 0;
+// --- per-batch arena ---------------------------------------------------------
+void *arena_alloc(Arena *arena, size_t size) {
+    ArenaBlock *block = arena->blocks;
+    if (!block || block->used + size > block->size) {
+        size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        block = malloc(sizeof(ArenaBlock) + block_size);
+        if (!block) {
+            arena->failed = 1;
+            return NULL;
+        }
+        block->size = block_size;
+        block->used = 0;
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+    void *ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
 }
 
-static void normalize_amount_positive(const char *src, char *dst) {
-    // Copy, drop leading '-', trim, and format decimal point to comma
-    if (!src || !dst) return;
-    size_t j = 0;
-    for (size_t i = 0; src[i]; i++) {
-        if (i == 0 && src[i] == '-') continue; // drop leading minus
-        dst[j++] = src[i];
-    }
-    dst[j] = '\0';
-    // remove spaces inside
-    size_t w = 0;
-    for (size_t i = 0; dst[i]; i++) {
-        if (!isspace((unsigned char)dst[i])) dst[w++] = dst[i];
-    }
-    dst[w] = '\0';
-    // cleanup and format
-    // ...existing code...
-    // Reuse existing clean_string + format_number
-    clean_string(dst);
-    format_number(dst);
-    if (dst[0] == '\0') strcpy(dst, "0");
+// Forget every allocation but keep the most recent block for reuse
+void arena_reset(Arena *arena) {
+    ArenaBlock *block = arena->blocks;
+    if (!block) return;
+    ArenaBlock *rest = block->next;
+    while (rest) {
+        ArenaBlock *next = rest->next;
+        free(rest);
+        rest = next;
+    }
+    block->next = NULL;
+    block->used = 0;
+    arena->failed = 0;
+}
+
+void arena_free(Arena *arena) {
+    arena_reset(arena);
+    free(arena->blocks);
+    arena->blocks = NULL;
 }
 
 // Clean a string by removing quotes and trimming whitespace
@@ -109,736 +138,449 @@ void clean_string(char *str) {
     trim_whitespace(str);
 }
 
-// Format number with comma as decimal separator
-void format_number(char *str) {
-    if (!str || *str == '\0')
-        return;
-
-    // Remove quotes & surrounding spaces
-    clean_string(str);
-
-    // Replace decimal point with comma
-    char *dot = strchr(str, '.');
-    if (dot) {
-        *dot = ',';
-    }
+// Columns of a statement, at the positions of the SG export when there is no header row
+static const DialectColumn statement_columns[STATEMENT_COLUMNS] = {
+    [STATEMENT_DATE] = {"date", 0, DIALECT_REQUIRED | DIALECT_DATE},
+    [STATEMENT_NATURE] = {"nature de l*", 1, DIALECT_REQUIRED},
+    [STATEMENT_DEBIT] = {"debit", 2, DIALECT_REQUIRED},
+    [STATEMENT_CREDIT] = {"credit", 3, DIALECT_REQUIRED},
+    [STATEMENT_DEVISE] = {"devise", 4, 0},
+    [STATEMENT_DATE_VALEUR] = {"date de valeur", 5, 0},
+    [STATEMENT_LIBELLE] = {"libelle*", 6, 0},
+};
+
+// Delimiter, encoding, header row, columns and date order of a statement
+int sniff_statement(const char *data, size_t len, CsvDialect *dialect) {
+    return dialect_sniff(data, len, statement_columns, STATEMENT_COLUMNS, dialect);
 }
 
-// Function to load the chart of accounts
-int load_chart_of_accounts(const char *filename, AccountInfo *accounts, int max_accounts) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Error: Could not open chart of accounts file %s\n", filename);
-        return 0;
-    }
-    
-    char line[MAX_LINE_SIZE];
-    int count = 0;
-    int line_count = 0;
-    
-    // Skip header line
-    if (fgets(line, MAX_LINE_SIZE, file) == NULL) {
-        fclose(file);
-        return 0;
+// Parse a line from the bank statement into a BankOperation structure.
+// The fields are slices of the line, which is modified in place; nothing is copied.
+int parse_bank_operation(char *line, size_t len, const CsvDialect *dialect, BankOperation *operation) {
+    Slice debit, credit;
+    Slice *fields[STATEMENT_COLUMNS] = {
+        [STATEMENT_DATE] = &operation->date, [STATEMENT_NATURE] = &operation->operation,
+        [STATEMENT_DEBIT] = &debit, [STATEMENT_CREDIT] = &credit, [STATEMENT_DEVISE] = &operation->devise,
+        [STATEMENT_DATE_VALEUR] = &operation->date_valeur, [STATEMENT_LIBELLE] = &operation->libelle,
+    };
+    Slice raw[DIALECT_MAX_FIELDS];
+    int field_count;
+
+    for (int c = 0; c < STATEMENT_COLUMNS; c++)
+        *fields[c] = slice_cstr("");
+    operation->details = slice_cstr("");
+
+    // Split the line, the details field keeps whatever follows the columns of the header
+    field_count = csv_split(line, len, dialect->delimiter, raw, dialect->field_count + 1);
+    if (field_count < dialect->required_fields)
+        return 0; // Not enough fields
+    for (int c = 0; c < STATEMENT_COLUMNS; c++) {
+        int field = dialect->columns[c];
+        if (field >= 0 && field < field_count)
+            *fields[c] = clean_field((char *)raw[field].ptr, (char *)raw[field].ptr + raw[field].len);
     }
-    
-    // Read accounts
-    while (fgets(line, MAX_LINE_SIZE, file) && count < max_accounts) {
-        line_count++;
-        
-        // Skip empty lines
-        if (strlen(line) <= 1)
-            continue;
-            
-        char *token;
-        char *rest = line;
-        
-        // Extract account number
-        token = strtok(rest, ";");
-        if (token) {
-            strncpy(accounts[count].number, token, MAX_FIELD_SIZE - 1);
-            accounts[count].number[MAX_FIELD_SIZE - 1] = '\0';
-            clean_string(accounts[count].number);
-        } else {
-            continue;
-        }
-        
-        // Extract account name
-        token = strtok(NULL, ";");
-        if (token) {
-            strncpy(accounts[count].name, token, MAX_FIELD_SIZE - 1);
-            accounts[count].name[MAX_FIELD_SIZE - 1] = '\0';
-            clean_string(accounts[count].name);
-            count++;
-        }
+    if (field_count > dialect->field_count) {
+        Slice extra = raw[dialect->field_count];
+        operation->details = clean_field((char *)extra.ptr, (char *)extra.ptr + extra.len);
     }
-    
-    fclose(file);
-    printf("Loaded %d accounts from %s\n", count, filename);
-    return count;
+    operation->debit = parse_amount(debit);
+    operation->credit = parse_amount(credit);
+
+    return field_count;
 }
 
-// Function to find an account by keyword in the name
-const char* find_account_by_keyword(const char *keyword, AccountInfo *accounts, int account_count) {
-    if (!keyword || strlen(keyword) == 0)
-        return NULL;
+// Append one journal entry
+static void add_entry(JournalEntry *entries, int *entry_count, Slice jour, Slice compte,
+                      Slice libelle, Money amount, JournalSide side) {
+    JournalEntry *e = &entries[(*entry_count)++];
+    e->journal = SLICE_LIT("BP");
+    e->jour = jour;
+    e->compte = compte;
+    e->libelle = libelle;
+    e->amount = amount;
+    e->side = side;
+}
 
-    // First, try exact match on account number (case-insensitive just in case)
-    for (int i = 0; i < account_count; i++) {
-        if (icompare(accounts[i].number, keyword) == 0) {
-            return accounts[i].number;
-        }
-    }
+// REMISE CB operations (Card payments received)
+static int convert_card_remittance(BankOperation *operation, JournalEntry *entries,
+                                   Classifier *classifier, Slice acc_580, Slice libelle) {
+    const ChartOfAccounts *chart = classifier->chart;
+    const char *details = operation->details.ptr;
+    int entry_count = 0;
 
-    // Then, search for the keyword in account names (case-insensitive)
-    for (int i = 0; i < account_count; i++) {
-        if (icontains(accounts[i].name, keyword)) {
-            return accounts[i].number;
-        }
-    }
+    // First entry: Credit clearing account with gross amount extracted from the BT line
+    Money gross_amount = operation->credit;
+    const char *bt_start = strstr(details, "BT ");
+    const char *e_pos = bt_start ? strstr(bt_start, "E COM") : NULL;
+    if (e_pos)
+        gross_amount = parse_amount(slice_between(bt_start + 2, e_pos));
+    add_entry(entries, &entry_count, operation->date, acc_580, libelle, gross_amount, JOURNAL_CREDIT);
+
+    // Second entry: Debit commission fees
+    Money commission = 0;
+    const char *com_start = strstr(details, "COM ");
+    if (com_start) {
+        e_pos = strstr(com_start, "E");
+        if (e_pos && e_pos > com_start + 4)
+            commission = parse_amount(slice_between(com_start + 4, e_pos));
+    }
+    add_entry(entries, &entry_count, operation->date, slice_cstr(chart->acc_627), libelle,
+              commission, JOURNAL_DEBIT);
+
+    // Third entry: Debit bank account with net credited amount
+    add_entry(entries, &entry_count, operation->date, slice_cstr(chart->acc_5121), libelle,
+              operation->credit, JOURNAL_DEBIT);
+    return entry_count;
+}
 
-    // If 401+keyword exists (common for suppliers)
-    char supplier_code[MAX_FIELD_SIZE];
-    snprintf(supplier_code, sizeof(supplier_code), "401%s", keyword);
-    for (int i = 0; i < account_count; i++) {
-        if (icompare(accounts[i].number, supplier_code) == 0) {
-            return accounts[i].number;
+// Try each word of a card label longer than 3 characters as an account keyword
+static const char *find_account_by_words(Slice libelle, const ChartOfAccounts *chart, Arena *arena) {
+    char *libelle_copy = arena_alloc(arena, libelle.len + 1);
+    char *save = NULL;
+    const char *found_account = NULL;
+
+    if (!libelle_copy)
+        return NULL;
+    memcpy(libelle_copy, libelle.ptr, libelle.len);
+    libelle_copy[libelle.len] = '\0';
+    char *word = strtok_r(libelle_copy, " ", &save);
+    while (word && !found_account) {
+        if (strlen(word) > 3) {
+            found_account = find_account_by_keyword(word, chart);
         }
+        word = strtok_r(NULL, " ", &save);
     }
-
-    return NULL;
+    return found_account;
 }
 
-// Parse a line from the bank statement into a BankOperation structure
-int parse_bank_operation(char *line, BankOperation *operation) {
-    char *token;
-    char *rest = line;
-    char temp[MAX_FIELD_SIZE] = {0};
-    int field_count = 0;
-
-    // Initialize the operation fields
-    memset(operation, 0, sizeof(BankOperation));
-
-    // Parse the line field by field
-    token = strtok(rest, ";");
-    if (token) {
-        strncpy(operation->date, token, MAX_FIELD_SIZE - 1);
-        clean_string(operation->date);
-        field_count++;
-    } else {
-        return 0; // Not enough fields
-    }
+// Convert a bank operation to journal entries
+int convert_to_journal_entries(BankOperation *operation, JournalEntry *entries, 
+                              Classifier *classifier) {
+    const ChartOfAccounts *chart = classifier->chart;
+    Arena *arena = &classifier->arena;
+    int entry_count = 0;
 
-    token = strtok(NULL, ";");
-    if (token) {
-        strncpy(operation->operation, token, MAX_FIELD_SIZE - 1);
-        clean_string(operation->operation);
-        field_count++;
-    } else {
+    // Skip empty lines, header lines and bank information: the date was parsed with the record
+    if (operation->day == DATE_NONE) {
         return 0;
     }
-
-    token = strtok(NULL, ";");
-    if (token) {
-        strncpy(operation->debit, token, MAX_FIELD_SIZE - 1);
-        clean_string(operation->debit);
-        field_count++;
-    } else {
+    char *jour = arena_alloc(arena, DATE_TEXT_SIZE);
+    if (!jour)
         return 0;
-    }
-
-    token = strtok(NULL, ";");
-    if (token) {
-        strncpy(operation->credit, token, MAX_FIELD_SIZE - 1);
-        clean_string(operation->credit);
-        field_count++;
-    } else {
+    operation->date = slice_between(jour, jour + date_format(operation->day, jour));
+
+    // Find the operation type in a single pass over the nature of the operation
+    size_t match_end = 0;
+    const ClassRule *op_rule = classify_field(classifier, RULE_FIELD_OPERATION, -1,
+                                              operation->operation.ptr, operation->operation.len,
+                                              &match_end);
+    if (!op_rule) {
+        STATS_ADD(STAT_SKIPPED_UNCLASSIFIED, 1);
         return 0;
     }
-
-    token = strtok(NULL, ";");
-    if (token) {
-        strncpy(operation->devise, token, MAX_FIELD_SIZE - 1);
-        clean_string(operation->devise);
-        field_count++;
+    if (stats_current) {
+        static const StatCounter branches[] = {
+            [RULE_TPL_NONE] = STAT_BRANCH_DEBIT, [RULE_TPL_REMISE_CB] = STAT_BRANCH_REMISE_CB,
+            [RULE_TPL_CARTE] = STAT_BRANCH_CARTE, [RULE_TPL_DEBIT] = STAT_BRANCH_DEBIT,
+            [RULE_TPL_CREDIT] = STAT_BRANCH_CREDIT,
+        };
+        stats_current->counters[branches[op_rule->tpl]]++;
+    }
+    int op_index = (int)(op_rule - classifier->rules->rules);
+
+    // Current libelle: the merchant label for card payments, the rule libelle otherwise
+    Slice libelle = slice_cstr(op_rule->libelle);
+    if (op_rule->tpl == RULE_TPL_CARTE) {
+        const char *op_end = operation->operation.ptr + operation->operation.len;
+        const char *space = memchr(operation->operation.ptr + match_end, ' ',
+                                   operation->operation.len - match_end);
+        libelle = space ? slice_between(space + 1, op_end) : slice_cstr("CARTE BANCAIRE");
+    }
+
+    // Fixed accounts of the rule, resolved via plan comptable with fallback
+    const char *account_keyword = op_rule->account;
+    const char *fallback = op_rule->fallback;
+    if (op_rule->tpl == RULE_TPL_REMISE_CB) {
+        const char *found = account_keyword ? find_account_by_keyword(account_keyword, chart) : NULL;
+        return convert_card_remittance(operation, entries, classifier,
+                                       slice_cstr(found ? found : (fallback ? fallback : account_keyword)),
+                                       libelle);
+    }
+
+    // Refine the account and libelle with the merchant or creditor rules
+    const ClassRule *sub_rule = NULL;
+    if (op_rule->tpl == RULE_TPL_CARTE) {
+        sub_rule = classify_field(classifier, RULE_FIELD_LIBELLE, op_index,
+                                  libelle.ptr, libelle.len, NULL);
     } else {
-        return 0;
-    }
-
-    token = strtok(NULL, ";");
-    if (token) {
-        strncpy(operation->date_valeur, token, MAX_FIELD_SIZE - 1);
-        clean_string(operation->date_valeur);
-        field_count++;
+        sub_rule = classify_field(classifier, RULE_FIELD_DETAILS, op_index,
+                                  operation->details.ptr, operation->details.len, NULL);
+    }
+    if (sub_rule) {
+        STATS_ADD(STAT_SUB_RULE_HITS, 1);
+        if (sub_rule->account) account_keyword = sub_rule->account;
+        fallback = sub_rule->fallback;
+        if (sub_rule->libelle) libelle = slice_cstr(sub_rule->libelle);
+    }
+
+    // A libelle of the past journals goes to the account it was booked to
+    const char *found_account = history_account(&classifier->rules->history, libelle);
+    if (found_account) {
+        STATS_ADD(STAT_HISTORY_HITS, 1);
+    } else if (account_keyword) {
+        found_account = find_account_by_keyword(account_keyword, chart);
+    } else if (op_rule->tpl == RULE_TPL_CARTE && !sub_rule) {
+        // Try to find a matching account by extracting keywords from libelle
+        STATS_ADD(STAT_LABEL_WORD_SEARCHES, 1);
+        found_account = find_account_by_words(libelle, chart, arena);
+    }
+
+    // Default account if no match found -> rule default or 401 + UPPER(libelle) without spaces
+    Slice compte;
+    if (found_account) {
+        compte = slice_cstr(found_account);
+    } else if (fallback) {
+        STATS_ADD(STAT_FALLBACK_RULE_DEFAULT, 1);
+        compte = slice_cstr(fallback);
     } else {
-        return 0;
+        STATS_ADD(STAT_FALLBACK_401, 1);
+        compte = build_401_from_label(libelle, arena);
     }
 
-    token = strtok(NULL, ";");
-    if (token) {
-        strncpy(operation->libelle, token, MAX_FIELD_SIZE - 1);
-        clean_string(operation->libelle);
-        field_count++;
+    if (op_rule->tpl == RULE_TPL_CREDIT) {
+        // Credit the account, debit the bank account
+        add_entry(entries, &entry_count, operation->date, compte, libelle,
+                  operation->credit, JOURNAL_CREDIT);
+        add_entry(entries, &entry_count, operation->date, slice_cstr(chart->acc_5121), libelle,
+                  operation->credit, JOURNAL_DEBIT);
+    } else {
+        // Debit the account (amount without its minus sign), credit the bank account
+        Money debit = money_abs(operation->debit);
+        add_entry(entries, &entry_count, operation->date, compte, libelle, debit, JOURNAL_DEBIT);
+        add_entry(entries, &entry_count, operation->date, slice_cstr(chart->acc_5121), libelle,
+                  debit, JOURNAL_CREDIT);
     }
 
-    // If this operation has details, store it
-    token = strtok(NULL, "\n");
-    if (token) {
-        strncpy(operation->details, token, MAX_FIELD_SIZE - 1);
-        clean_string(operation->details);
-    }
+    return entry_count;
+}
 
-    return field_count;
+// Write a journal entry to the output file
+void write_journal_entry(JournalWriter *output, JournalEntry *entry) {
+    jwriter_row_amount(output, entry->journal, entry->jour, entry->compte, entry->libelle,
+                       entry->amount, entry->side);
 }
 
-// Convert a bank operation to journal entries
-int convert_to_journal_entries(BankOperation *operation, JournalEntry *entries, 
-                              AccountInfo *accounts, int account_count) {
-    int entry_count = 0;
+// Skip the bank information up to the column headers (Date;Nature de l'opération;...),
+// the line the dialect of the statement found them on
+int find_statement_header(RecordReader *reader) {
+    StatementRecord record;
 
-    // Skip empty lines or if date is empty
-    if (strlen(operation->date) == 0) {
+    if (!reader_sniff(reader)) {
+        fprintf(stderr, "Error: Could not find headers line in input file\n");
         return 0;
     }
+    for (int lines = 0; lines <= reader->dialect.header_line && reader_next_record(reader, &record);
+         lines += record.line_count)
+        STATS_ADD(STAT_SKIPPED_HEADER, record.line_count);
+    return 1;
+}
 
-    // Skip header lines or bank information
-    if (operation->date[0] != '0' && operation->date[0] != '1' && 
-        operation->date[0] != '2' && operation->date[0] != '3') {
+// Skip the bank information up to the column headers and write the journal header
+int convert_statement_header(RecordReader *reader, JournalWriter *output) {
+    if (!find_statement_header(reader))
         return 0;
-    }
-
-    // Resolve common accounts via plan comptable with fallback
-    const char *acc_5121 = find_account_by_keyword("5121", accounts, account_count);
-    if (!acc_5121) acc_5121 = "5121";
-    const char *acc_580 = find_account_by_keyword("580", accounts, account_count);
-    if (!acc_580) acc_580 = "580";
-    const char *acc_627 = find_account_by_keyword("627", accounts, account_count);
-    if (!acc_627) acc_627 = "627";
-
-    // REMISE CB operations (Card payments received)
-    if (strstr(operation->operation, "REMISE CB")) {
-        // First entry: Credit clearing account with gross amount
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, acc_580);
-        strcpy(entries[entry_count].libelle, "CB");
-        strcpy(entries[entry_count].debit, "");
-        // Extract gross amount from BT line
-        char gross_amount[MAX_FIELD_SIZE] = {0};
-        if (strstr(operation->details, "BT ")) {
-            char *bt_start = strstr(operation->details, "BT ");
-            char *e_pos = strstr(bt_start, "E COM");
-            if (e_pos) {
-                size_t len = (size_t)(e_pos - (bt_start + 2));
-                if (len >= sizeof(gross_amount)) len = sizeof(gross_amount) - 1;
-                strncpy(gross_amount, bt_start + 2, len);
-                gross_amount[len] = '\0';
-                clean_string(gross_amount);
-                format_number(gross_amount);
-                strcpy(entries[entry_count].credit, gross_amount);
-            } else {
-                char tmp[MAX_FIELD_SIZE];
-                strncpy(tmp, operation->credit, sizeof(tmp) - 1); tmp[sizeof(tmp) - 1] = '\0';
-                format_number(tmp);
-                strcpy(entries[entry_count].credit, tmp);
-            }
-        } else {
-            char tmp[MAX_FIELD_SIZE];
-            strncpy(tmp, operation->credit, sizeof(tmp) - 1); tmp[sizeof(tmp) - 1] = '\0';
-            format_number(tmp);
-            strcpy(entries[entry_count].credit, tmp);
-        }
-        entry_count++;
-
-        // Second entry: Debit commission fees
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, acc_627);
-        strcpy(entries[entry_count].libelle, "CB");
-        char commission[MAX_FIELD_SIZE] = {0};
-        if (strstr(operation->details, "COM ")) {
-            char *com_start = strstr(operation->details, "COM ");
-            if (com_start) {
-                char *e_pos = strstr(com_start, "E");
-                if (e_pos && e_pos > com_start + 4) {
-                    size_t len = (size_t)(e_pos - (com_start + 4));
-                    if (len >= sizeof(commission)) len = sizeof(commission) - 1;
-                    strncpy(commission, com_start + 4, len);
-                    commission[len] = '\0';
-                }
-            }
-        }
-        if (commission[0]) {
-            clean_string(commission);
-            format_number(commission);
-            strcpy(entries[entry_count].debit, commission);
-            strcpy(entries[entry_count].credit, "");
-        } else {
-            strcpy(entries[entry_count].debit, "0");
-            strcpy(entries[entry_count].credit, "");
-        }
-        entry_count++;
-
-        // Third entry: Debit bank account with net credited amount
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, acc_5121);
-        strcpy(entries[entry_count].libelle, "CB");
-        char net_amt[MAX_FIELD_SIZE];
-        strncpy(net_amt, operation->credit, sizeof(net_amt) - 1); net_amt[sizeof(net_amt) - 1] = '\0';
-        format_number(net_amt);
-        strcpy(entries[entry_count].debit, net_amt);
-        strcpy(entries[entry_count].credit, "");
-        entry_count++;
-    }
-    // CARTE X0067 operations (Card payments made)
-    else if (strstr(operation->operation, "CARTE X0067")) {
-        char libelle[MAX_FIELD_SIZE] = {0};
-        char *space = strchr(operation->operation + 11, ' ');
-        if (space) {
-            strncpy(libelle, space + 1, sizeof(libelle) - 1);
-        } else {
-            strcpy(libelle, "CARTE BANCAIRE");
-        }
-
-        // Determine account code based on the payment
-        char compte[MAX_FIELD_SIZE] = {0};
-
-        // Try to find account based on libelle
-        const char *found_account = NULL;
+    jwriter_header(output);
+    return 1;
+}
 
-        // Special cases handling
-        if (strstr(libelle, "FACEBK")) {
-            found_account = find_account_by_keyword("FACEBOOK", accounts, account_count);
-            strcpy(libelle, "PUB FACEBOOK");
-        }
-        else if (strstr(libelle, "AMAZON")) {
-            found_account = find_account_by_keyword("AMAZON", accounts, account_count);
-        }
-        else if (strstr(libelle, "LEROY MERLIN") || strstr(libelle, "ADEO*LEROY")) {
-            found_account = find_account_by_keyword("LEROYMERLIN", accounts, account_count);
-            strcpy(libelle, "LEROY MERLIN");
-        }
-        else if (strstr(libelle, "AVERY")) {
-            found_account = find_account_by_keyword("AVERY", accounts, account_count);
-        }
-        else if (strstr(libelle, "ORANGE")) {
-            found_account = find_account_by_keyword("ORANGE", accounts, account_count);
-        }
-        else if (strstr(libelle, "ORANAISE")) {
-            found_account = find_account_by_keyword("RESTAURANT", accounts, account_count);
-            strcpy(libelle, "Restaurant");
-        }
-        else {
-            // Try to find a matching account by extracting keywords from libelle (without modifying libelle)
-            char libelle_copy[MAX_FIELD_SIZE];
-            strncpy(libelle_copy, libelle, sizeof(libelle_copy) - 1);
-            libelle_copy[sizeof(libelle_copy) - 1] = '\0';
-            char *word = strtok(libelle_copy, " ");
-            while (word && !found_account) {
-                if (strlen(word) > 3) {
-                    found_account = find_account_by_keyword(word, accounts, account_count);
-                }
-                word = strtok(NULL, " ");
-            }
-        }
+// Parse one record of the statement into an operation, continuation lines
+// included; returns 0 for lines that are not operations
+int parse_statement_record(StatementRecord *record, BankOperation *operation, Arena *arena) {
+    // Skip empty lines
+    if (record->len == 0) {
+        STATS_ADD(STAT_SKIPPED_EMPTY, record->line_count);
+        return 0;
+    }
 
-        // Default account if no match found -> 401 + UPPER(libelle) without spaces
-        if (found_account) {
-            strcpy(compte, found_account);
+    // Skip detail lines that follow no operation (without a date)
+    if (statement_continuation(record->line, record->len, record->dialect)) {
+        STATS_ADD(STAT_SKIPPED_CONTINUATION, record->line_count);
+        return 0;
+    }
+        
+    // Parse the bank operation
+    if (parse_bank_operation(record->line, record->len, record->dialect, operation) == 0) {
+        STATS_ADD(STAT_SKIPPED_SHORT, record->line_count);
+        return 0;
+    }
+        
+    // Skip operations without a date, and lines that don't look like valid operations
+    if (!date_parse(operation->date.ptr, operation->date.len, record->dialect->order, &operation->day)) {
+        STATS_ADD(STAT_SKIPPED_NOT_DATE, record->line_count);
+        return 0;
+    }
+    STATS_ADD(STAT_RECORDS_PARSED, 1);
+
+    // Details: the extra field of the line followed by the continuation lines
+    if (record->continuation.len) {
+        if (operation->details.len) {
+            size_t len = operation->details.len + 1 + record->continuation.len;
+            char *joined = arena_alloc(arena, len + 1);
+            if (!joined)
+                return 0;
+            memcpy(joined, operation->details.ptr, operation->details.len);
+            joined[operation->details.len] = '\n';
+            memcpy(joined + operation->details.len + 1, record->continuation.ptr, record->continuation.len);
+            joined[len] = '\0';
+            operation->details.ptr = joined;
+            operation->details.len = len;
         } else {
-            build_401_from_label(libelle, compte, sizeof(compte));
-        }
-
-        // First entry: Debit to supplier account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, compte);
-        strcpy(entries[entry_count].libelle, libelle);
-        // Clean the debit amount (remove minus sign and format)
-        char clean_debit[MAX_FIELD_SIZE];
-        normalize_amount_positive(operation->debit, clean_debit);
-        strcpy(entries[entry_count].debit, clean_debit);
-        strcpy(entries[entry_count].credit, "");
-        entry_count++;
-
-        // Second entry: Credit from bank account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, acc_5121);
-        strcpy(entries[entry_count].libelle, libelle);
-        strcpy(entries[entry_count].debit, "");
-        strcpy(entries[entry_count].credit, clean_debit);
-        entry_count++;
-    }
-    // VRST GAB operations (Cash deposits)
-    else if (strstr(operation->operation, "VRST GAB")) {
-        // First entry: Credit to cash clearing (580)
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, acc_580);
-        strcpy(entries[entry_count].libelle, "Versement especes");
-        strcpy(entries[entry_count].debit, "");
-        char credit_amt[MAX_FIELD_SIZE];
-        strncpy(credit_amt, operation->credit, sizeof(credit_amt) - 1); credit_amt[sizeof(credit_amt) - 1] = '\0';
-        format_number(credit_amt);
-        strcpy(entries[entry_count].credit, credit_amt);
-        entry_count++;
-
-        // Second entry: Debit to bank account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, acc_5121);
-        strcpy(entries[entry_count].libelle, "Versement especes");
-        strcpy(entries[entry_count].debit, credit_amt);
-        strcpy(entries[entry_count].credit, "");
-        entry_count++;
-    }
-    // VIR RECU operations (Received transfers)
-    else if (strstr(operation->operation, "VIR RECU")) {
-        // Determine account code and description based on details
-        char compte[MAX_FIELD_SIZE] = {0};
-        const char *acc_default = find_account_by_keyword("44567", accounts, account_count);
-        strcpy(compte, acc_default ? acc_default : "44567");
-        char libelle[MAX_FIELD_SIZE] = "Remboursement TVA";
-
-        if (strstr(operation->details, "SIE MOSSON")) {
-            const char *found_account = find_account_by_keyword("44567", accounts, account_count);
-            if (found_account) {
-                strcpy(compte, found_account);
-            }
-            strcpy(libelle, "Remboursement TVA");
+            operation->details = record->continuation;
         }
+    }
+    return 1;
+}
 
-        // First entry: Credit appropriate account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, compte);
-        strcpy(entries[entry_count].libelle, libelle);
-        strcpy(entries[entry_count].debit, "");
-        char amt[MAX_FIELD_SIZE];
-        strncpy(amt, operation->credit, sizeof(amt) - 1); amt[sizeof(amt) - 1] = '\0';
-        format_number(amt);
-        strcpy(entries[entry_count].credit, amt);
-        entry_count++;
-
-        // Second entry: Debit bank account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, acc_5121);
-        strcpy(entries[entry_count].libelle, libelle);
-        strcpy(entries[entry_count].debit, amt);
-        strcpy(entries[entry_count].credit, "");
-        entry_count++;
-    }
-    // PRELEVEMENT EUROPEEN operations (Direct debits)
-    else if (strstr(operation->operation, "PRELEVEMENT EUROPEEN")) {
-        // Determine account code and description based on details
-        char compte[MAX_FIELD_SIZE] = {0};
-        const char *acc_default = find_account_by_keyword("401DIVERS", accounts, account_count);
-        strcpy(compte, acc_default ? acc_default : "401DIVERS");
-        char libelle[MAX_FIELD_SIZE] = "Prelevement";
-        const char *found_account = NULL;
-
-        if (strstr(operation->details, "CEP TRESO SANTE PREV")) {
-            found_account = find_account_by_keyword("4375", accounts, account_count);
-            strcpy(libelle, "Prevoyance");
-        } else if (strstr(operation->details, "AXA")) {
-            found_account = find_account_by_keyword("6161", accounts, account_count);
-            strcpy(libelle, "AXA");
-        } else if (strstr(operation->details, "URSSAF")) {
-            if (strstr(operation->details, "FEV")) {
-                found_account = find_account_by_keyword("644101", accounts, account_count);
-                strcpy(libelle, "URSSAF ASF");
-            } else {
-                found_account = find_account_by_keyword("431", accounts, account_count);
-                strcpy(libelle, "URSSAF");
-            }
-        } else if (strstr(operation->details, "HAXE DIRECT")) {
-            found_account = find_account_by_keyword("HAXE DIRECT", accounts, account_count);
-            strcpy(libelle, "HAXE DIRECT");
-        } else if (strstr(operation->details, "GC RE HOKODO")) {
-            found_account = find_account_by_keyword("ANKORSTORE", accounts, account_count);
-            strcpy(libelle, "Ankorstore");
-        } else if (strstr(operation->details, "METAC")) {
-            found_account = find_account_by_keyword("TIME", accounts, account_count);
-            strcpy(libelle, "TIME METAC");
-        } else if (strstr(operation->details, "IONOS")) {
-            found_account = find_account_by_keyword("IONOS", accounts, account_count);
-            strcpy(libelle, "IONOS");
-        }
+// Convert one record of the statement, continuation lines included; returns
+// the number of journal entries written, 0 for lines that are not operations,
+// CONVERT_NO_MEMORY when the strings of the operation did not fit in memory
+int convert_statement_record(StatementRecord *record, JournalWriter *output, Classifier *classifier) {
+    BankOperation operation;
+    JournalEntry entries[MAX_OPERATIONS];
 
-        if (found_account) {
-            strcpy(compte, found_account);
-        } else {
-            build_401_from_label(libelle, compte, sizeof(compte));
-        }
+    int parsed = parse_statement_record(record, &operation, &classifier->arena);
+    STATS_LAP(STAT_STAGE_PARSE);
+    int entry_count = parsed ? convert_to_journal_entries(&operation, entries, classifier) : 0;
+    STATS_LAP(STAT_STAGE_CLASSIFY);
+    if (classifier->arena.failed) {
+        arena_reset(&classifier->arena);
+        return CONVERT_NO_MEMORY;
+    }
+    
+    // Write the entries to the output file
+    for (int i = 0; i < entry_count; i++)
+        write_journal_entry(output, &entries[i]);
+    arena_reset(&classifier->arena);
+    STATS_ADD(STAT_ENTRIES_WRITTEN, entry_count);
+    STATS_LAP(STAT_STAGE_WRITE);
+    return entry_count;
+}
 
-        // First entry: Debit to appropriate account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, compte);
-        strcpy(entries[entry_count].libelle, libelle);
-        char clean_debit[MAX_FIELD_SIZE];
-        normalize_amount_positive(operation->debit, clean_debit);
-        strcpy(entries[entry_count].debit, clean_debit);
-        strcpy(entries[entry_count].credit, "");
-        entry_count++;
-
-        // Second entry: Credit from bank account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, acc_5121);
-        strcpy(entries[entry_count].libelle, libelle);
-        strcpy(entries[entry_count].debit, "");
-        strcpy(entries[entry_count].credit, clean_debit);
-        entry_count++;
-    }
-    // VIR EUROPEEN EMIS operations (Outgoing transfers)
-    else if (strstr(operation->operation, "VIR EUROPEEN EMIS")) {
-        // Determine account code and description based on details
-        char compte[MAX_FIELD_SIZE] = {0};
-        const char *acc_default = find_account_by_keyword("401DIVERS", accounts, account_count);
-        strcpy(compte, acc_default ? acc_default : "401DIVERS");
-        char libelle[MAX_FIELD_SIZE] = "Virement";
-        const char *found_account = NULL;
-
-        if (strstr(operation->details, "FREJAVILLE Carla")) {
-            found_account = find_account_by_keyword("421", accounts, account_count);
-            strcpy(libelle, "Salaire Janvier");
-        } else if (strstr(operation->details, "SCOP EPICE")) {
-            found_account = find_account_by_keyword("SCOPEPICE", accounts, account_count);
-            strcpy(libelle, "SCOP EPICE");
-        } else if (strstr(operation->details, "COMPAGNIE DU BICARBONATE")) {
-            found_account = find_account_by_keyword("COMPAGNIEBIC", accounts, account_count);
-            strcpy(libelle, "Cie Bicarbonate");
-        } else if (strstr(operation->details, "ECODIS")) {
-            found_account = find_account_by_keyword("ECODIS", accounts, account_count);
-            strcpy(libelle, "ECODIS");
-        } else if (strstr(operation->details, "SCI JC")) {
-            found_account = find_account_by_keyword("SCIJC", accounts, account_count);
-            strcpy(libelle, "Loyer Février 2025");
-        }
+// Convert the operations that follow the header, up to the end of the reader;
+// stops with CONVERT_NO_MEMORY when memory runs out
+int convert_statement_records(RecordReader *reader, JournalWriter *output, Classifier *classifier) {
+    StatementRecord record;
+    int total_entries = 0;
 
-        if (found_account) {
-            strcpy(compte, found_account);
-        } else {
-            build_401_from_label(libelle, compte, sizeof(compte));
+    STATS_LAP_START();
+    while (reader_next_record(reader, &record)) {
+        STATS_LAP(STAT_STAGE_READ);
+        int entries = convert_statement_record(&record, output, classifier);
+        if (entries < 0) {
+            fprintf(stderr, "Error: Out of memory\n");
+            return entries;
         }
-
-        // First entry: Debit to appropriate account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, compte);
-        strcpy(entries[entry_count].libelle, libelle);
-        char clean_debit[MAX_FIELD_SIZE];
-        normalize_amount_positive(operation->debit, clean_debit);
-        strcpy(entries[entry_count].debit, clean_debit);
-        strcpy(entries[entry_count].credit, "");
-        entry_count++;
-
-        // Second entry: Credit from bank account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, acc_5121);
-        strcpy(entries[entry_count].libelle, libelle);
-        strcpy(entries[entry_count].debit, "");
-        strcpy(entries[entry_count].credit, clean_debit);
-        entry_count++;
-    }
-    // COTISATION MENSUELLE operations (Bank fees)
-    else if (strstr(operation->operation, "COTISATION MENSUELLE")) {
-        const char *found_account = find_account_by_keyword("627", accounts, account_count);
-        char compte[MAX_FIELD_SIZE];
-        strcpy(compte, found_account ? found_account : acc_627);
-
-        // First entry: Debit to bank fees account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, compte);
-        strcpy(entries[entry_count].libelle, "Cotisation Jazz Pro");
-        char clean_debit[MAX_FIELD_SIZE];
-        normalize_amount_positive(operation->debit, clean_debit);
-        strcpy(entries[entry_count].debit, clean_debit);
-        strcpy(entries[entry_count].credit, "");
-        entry_count++;
-
-        // Second entry: Credit from bank account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, acc_5121);
-        strcpy(entries[entry_count].libelle, "Cotisation Jazz Pro");
-        strcpy(entries[entry_count].debit, "");
-        strcpy(entries[entry_count].credit, clean_debit);
-        entry_count++;
-    }
-    // COMMISSION RELEVE or COM REL operations (Bank fees)
-    else if (strstr(operation->operation, "COMMISSION RELEVE") || 
-             strstr(operation->operation, "COM REL")) {
-        const char *found_account = find_account_by_keyword("627", accounts, account_count);
-        char compte[MAX_FIELD_SIZE];
-        strcpy(compte, found_account ? found_account : acc_627);
-
-        // First entry: Debit to bank fees account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, compte);
-        strcpy(entries[entry_count].libelle, "Commission LCR");
-        char clean_debit[MAX_FIELD_SIZE];
-        normalize_amount_positive(operation->debit, clean_debit);
-        strcpy(entries[entry_count].debit, clean_debit);
-        strcpy(entries[entry_count].credit, "");
-        entry_count++;
-
-        // Second entry: Credit from bank account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, acc_5121);
-        strcpy(entries[entry_count].libelle, "Commission LCR");
-        strcpy(entries[entry_count].debit, "");
-        strcpy(entries[entry_count].credit, clean_debit);
-        entry_count++;
-    }
-    // RELEVE LCR DOMICIL operations (Bank fees)
-    else if (strstr(operation->operation, "RELEVE LCR DOMICIL")) {
-        const char *found_account = find_account_by_keyword("EVOOTRADE", accounts, account_count);
-        char compte[MAX_FIELD_SIZE];
-        strcpy(compte, found_account ? found_account : "401EVOOTRADE");
-
-        // First entry: Debit to supplier account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, compte);
-        strcpy(entries[entry_count].libelle, "EVOOTRADE");
-        char clean_debit[MAX_FIELD_SIZE];
-        normalize_amount_positive(operation->debit, clean_debit);
-        strcpy(entries[entry_count].debit, clean_debit);
-        strcpy(entries[entry_count].credit, "");
-        entry_count++;
-
-        // Second entry: Credit from bank account
-        strcpy(entries[entry_count].journal, "BP");
-        strcpy(entries[entry_count].jour, operation->date);
-        strcpy(entries[entry_count].compte, acc_5121);
-        strcpy(entries[entry_count].libelle, "EVOOTRADE");
-        strcpy(entries[entry_count].debit, "");
-        strcpy(entries[entry_count].credit, clean_debit);
-        entry_count++;
+        total_entries += entries;
     }
-
-    return entry_count;
+    return total_entries;
 }
 
-// Write a journal entry to the output file
-void write_journal_entry(FILE *output, JournalEntry *entry) {
-    fprintf(output, "%s;%s;%s;%s;%s;%s\n",
-            entry->journal,
-            entry->jour,
-            entry->compte,
-            entry->libelle,
-            entry->debit,
-            entry->credit);
+// Convert a statement with an already loaded chart and rules; safe to run on
+// several statements at once since the chart and rules are only read
+int convert_statement(RecordReader *reader, JournalWriter *output, const ChartOfAccounts *chart,
+                      const RuleSet *rules) {
+    Classifier classifier;
+
+    if (!convert_statement_header(reader, output))
+        return -1;
+    if (!classifier_init(&classifier, chart, rules)) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return CONVERT_NO_MEMORY;
+    }
+    int total_entries = convert_statement_records(reader, output, &classifier);
+    classifier_free(&classifier);
+    return total_entries;
 }
 
 // Process the bank statement and convert it to journal entries
-int process_bank_statement(FILE *input, FILE *output, const char *chart_of_accounts_file) {
-    char line[MAX_LINE_SIZE];
-    BankOperation operation;
-    JournalEntry entries[MAX_OPERATIONS];
-    AccountInfo accounts[MAX_ACCOUNTS];
-    int line_count = 0;
-    int total_entries = 0;
-    int header_written = 0;
+int process_bank_statement(RecordReader *reader, JournalWriter *output, const char *chart_of_accounts_file,
+                           const char *rules_file, char *const *history_files, int history_count, int threads) {
+    ChartOfAccounts chart;
+    RuleSet rules;
     
     // Load chart of accounts
-    int account_count = load_chart_of_accounts(chart_of_accounts_file, accounts, MAX_ACCOUNTS);
+    STATS_LAP_START();
+    int account_count = load_chart_of_accounts(chart_of_accounts_file, &chart);
+    STATS_LAP(STAT_STAGE_LOAD_CHART);
     if (account_count == 0) {
         fprintf(stderr, "Warning: No accounts loaded from %s. Using default account codes.\n", 
                 chart_of_accounts_file);
     }
-    
-    // Skip header and bank information lines
-    while (fgets(line, MAX_LINE_SIZE, input)) {
-        line_count++;
-        
-        // Skip empty lines
-        if (strlen(line) <= 1)
-            continue;
-            
-        // Check if this is the headers line (Date;Nature de l'opération;...)
-        if (strstr(line, "Date;Nature de l")) {
-            // Write the header for the journal
-            fprintf(output, "Journal;Jour;cpte;Libelle;Debit;Credit\n");
-            header_written = 1;
-            break;
-        }
-    }
-    
-    // If we couldn't find the headers line, return error
-    if (!header_written) {
-        fprintf(stderr, "Error: Could not find headers line in input file\n");
+
+    // Load and compile the classification rules
+    if (load_classification_rules(rules_file, &rules) == 0) {
+        fprintf(stderr, "Error: No classification rules available\n");
+        free_classification_rules(&rules);
+        free_chart_of_accounts(&chart);
         return -1;
     }
-    
-    // Process each line of the input file
-    while (fgets(line, MAX_LINE_SIZE, input)) {
-        line_count++;
-        
-        // Skip empty lines
-        if (strlen(line) <= 1)
-            continue;
-
-        // Skip lines that appear to be detail lines (starting with empty fields)
-        if (line[0] == '"' && line[1] == '"')
-            continue;
-            
-        // Parse the bank operation
-        memset(&operation, 0, sizeof(BankOperation));
-        if (parse_bank_operation(line, &operation) == 0)
-            continue;
-            
-        // Skip operations without a date
-        if (strlen(operation.date) == 0)
-            continue;
-            
-        // Skip lines that don't look like valid operations
-        if (operation.date[0] != '0' && operation.date[0] != '1' && 
-            operation.date[0] != '2' && operation.date[0] != '3')
-            continue;
-
-        // Capture details from next line if it's a BT line (for commission calculation)
-        if (strstr(operation.operation, "REMISE CB")) {
-            char next_line[MAX_LINE_SIZE];
-            long pos = ftell(input);
-            if (fgets(next_line, MAX_LINE_SIZE, input)) {
-                if (strstr(next_line, "BT ")) {
-                    strncpy(operation.details, next_line, MAX_FIELD_SIZE - 1);
-                    operation.details[MAX_FIELD_SIZE - 1] = '\0';
-                    clean_string(operation.details);
-                    line_count++;
-                } else {
-                    // Not a BT line, go back
-                    fseek(input, pos, SEEK_SET);
-                }
-            }
-        }
-        
-        // Convert the operation to journal entries
-        memset(entries, 0, sizeof(entries));
-        int entry_count = convert_to_journal_entries(&operation, entries, accounts, account_count);
-        
-        // Write the entries to the output file
-        for (int i = 0; i < entry_count; i++) {
-            write_journal_entry(output, &entries[i]);
-            total_entries++;
-        }
+    if (!learn_history_files(&rules.history, history_files, history_count)) {
+        free_classification_rules(&rules);
+        free_chart_of_accounts(&chart);
+        return -1;
     }
+    STATS_LAP(STAT_STAGE_LOAD_RULES);
+
+    int total_entries = threads > 1
+        ? convert_statement_parallel(reader, output, &chart, &rules, threads)
+        : convert_statement(reader, output, &chart, &rules);
     
+    free_classification_rules(&rules);
+    free_chart_of_accounts(&chart);
     return total_entries;
 }
 
-// Wrapper function to maintain compatibility with main.c
-int process_csv_file(FILE *input, FILE *output, const char *chart_of_accounts_file) {
-    return process_bank_statement(input, output, chart_of_accounts_file);
+static void get_month_name(int month, char *out, size_t outsz) {
+    const char *months[] = {"Janvier","Fevrier","Mars","Avril","Mai","Juin","Juillet","Aout","Septembre","Octobre","Novembre","Decembre"};
+    if (month >= 1 && month <= 12) {
+        snprintf(out, outsz, "%s", months[month-1]);
+    } else {
+        snprintf(out, outsz, "Inconnu");
+    }
 }
 
+// Month and year of the first operation, the first line after the header with a date
+static int first_operation_month(RecordReader *in, int *out_month, int *out_year) {
+    const CsvDialect *dialect = &in->dialect;
+    const char *line;
+    size_t offset = 0;
+    Day date;
+    int day;
+
+    reader_sniff(in);
+    // Peek at the lines without consuming them, so that pipes work as well
+    for (int number = 0; (line = reader_peek_line(in, &offset)); number++) {
+        Slice field = line_field(line, strlen(line), dialect->delimiter, dialect->columns[STATEMENT_DATE]);
+        if (number > dialect->header_line && date_parse(field.ptr, field.len, dialect->order, &date)) {
+            date_to_civil(date, out_year, out_month, &day);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Name of the journal of a statement, "Journal Bq {Mois} {Annee}.csv", from its first operation
+void journal_file_name(RecordReader *in, char *out, size_t outsz) {
+    int month = 0, year = 0;
+    char month_name[16];
+    if (!first_operation_month(in, &month, &year)) {
+        // Fallback to current month/year if not found
+        time_t now = time(NULL);
+        struct tm tm;
+        int have_tm = localtime_r(&now, &tm) != NULL;
+        month = have_tm ? (tm.tm_mon + 1) : 1;
+        year = have_tm ? (tm.tm_year + 1900) : 1970;
+    }
+    get_month_name(month, month_name, sizeof(month_name));
+    snprintf(out, outsz, "Journal Bq %s %d.csv", month_name, year);
+}
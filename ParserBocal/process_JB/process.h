@@ -6,7 +6,7 @@
 /*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/05/03 12:12:38 by igilbert          #+#    #+#             */
-/*   Updated: 2025/05/06 12:20:59 by igilbert         ###   ########.fr       */
+/*   Updated: 2026/10/17 01:34:32 by igilbert         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -17,71 +17,338 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include "../common/jwriter.h"
+#include "../common/csvscan.h"
+#include "../common/stats.h"
+#include "../common/dates.h"
+#include "../common/dialect.h"
 
 #define MAX_LINE_SIZE 2048
-#define MAX_FIELD_SIZE 256
 #define MAX_OPERATIONS 10
-#define MAX_ACCOUNTS 2000
+#define MAX_HISTORY_FILES 64
+
+#define ARENA_BLOCK_SIZE 4096
+
+// Returned by the conversion functions when memory runs out (-1 is a statement
+// without a header row), so that the library can tell the caller
+#define CONVERT_NO_MEMORY -2
+
+// Nanoseconds of the mtime of a struct stat
+#ifdef __APPLE__
+# define STAT_MTIME_NSEC(st) ((st).st_mtimespec.tv_nsec)
+#else
+# define STAT_MTIME_NSEC(st) ((st).st_mtim.tv_nsec)
+#endif
+
+// Bump allocator for the few strings built while converting one operation
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+    char data[];
+} ArenaBlock;
 
-// Structure for a bank operation from the source file
 typedef struct {
-    char date[MAX_FIELD_SIZE];
-    char operation[MAX_FIELD_SIZE];
-    char debit[MAX_FIELD_SIZE];
-    char credit[MAX_FIELD_SIZE];
-    char devise[MAX_FIELD_SIZE];
-    char date_valeur[MAX_FIELD_SIZE];
-    char libelle[MAX_FIELD_SIZE];
-    char details[MAX_FIELD_SIZE];
+    ArenaBlock *blocks;
+    int failed;             // an allocation ran out of memory since the last reset
+} Arena;
+
+// Columns of a statement, found by name in its header row
+enum {
+    STATEMENT_DATE,
+    STATEMENT_NATURE,
+    STATEMENT_DEBIT,
+    STATEMENT_CREDIT,
+    STATEMENT_DEVISE,
+    STATEMENT_DATE_VALEUR,
+    STATEMENT_LIBELLE,
+    STATEMENT_COLUMNS
+};
+
+// Forward-only reader of a statement, from a file, a pipe or stdin
+typedef struct {
+    int fd;
+    char *buf;              // window [start, end) of unconsumed bytes, NUL after end
+    size_t cap;
+    size_t start;
+    size_t end;
+    int eof;
+    int borrowed;           // buf belongs to the caller (memory reader)
+    char *scratch;          // continuation text of the current record
+    size_t scratch_len;
+    size_t scratch_cap;
+    CsvDialect dialect;     // of the statement, the SG layout until reader_sniff
+    int sniffed;
+    int cp1252;             // bytes are converted to UTF-8 as they are read
+} RecordReader;
+
+// One operation of the statement: its line and the text of its continuation lines
+typedef struct {
+    char *line;             // writable, NUL-terminated, without the newline
+    size_t len;
+    Slice continuation;     // Nature field of each continuation line, joined with '\n'
+    int line_count;
+    const CsvDialect *dialect;
+} StatementRecord;
+
+// Structure for a bank operation from the source file, fields point into the line
+typedef struct {
+    Slice date;
+    Day day;
+    Slice operation;
+    Money debit;            // parsed from the Débit and Crédit columns
+    Money credit;
+    Slice devise;
+    Slice date_valeur;
+    Slice libelle;
+    Slice details;
 } BankOperation;
 
 // Structure for a journal entry in the target format
 typedef struct {
-    char journal[MAX_FIELD_SIZE];
-    char jour[MAX_FIELD_SIZE];
-    char compte[MAX_FIELD_SIZE];
-    char libelle[MAX_FIELD_SIZE];
-    char debit[MAX_FIELD_SIZE];
-    char credit[MAX_FIELD_SIZE];
+    Slice journal;
+    Slice jour;
+    Slice compte;
+    Slice libelle;
+    Money amount;
+    JournalSide side;
 } JournalEntry;
 
-// Structure for an account from the chart of accounts
+// Account of the chart: offsets of its number and name in the string table
+typedef struct {
+    uint32_t number;
+    uint32_t name;
+} ChartAccount;
+
+// Trigram of a case-folded account name and its slice of the postings array
+typedef struct {
+    uint32_t key;           // three folded bytes, 0 marks an empty slot
+    int32_t start;
+    int32_t count;
+} ChartGram;
+
+// Chart of accounts with its lookup index, all in one compiled image that is
+// either mapped from the cache file next to the chart or built in memory
 typedef struct {
-    char number[MAX_FIELD_SIZE];
-    char name[MAX_FIELD_SIZE];
-} AccountInfo;
+    const char *strings;    // NUL-terminated numbers and names
+    size_t strings_size;
+    const ChartAccount *accounts;
+    int count;
+    const int32_t *number_slots;  // open addressing on the case-folded number, -1 if empty
+    size_t number_mask;
+    const ChartGram *gram_slots;  // open addressing on name trigrams
+    size_t gram_mask;
+    const int32_t *postings;      // account indices, ascending within each trigram
+    size_t posting_count;
+    void *image;
+    size_t image_size;
+    int mapped;             // image is a read-only mapping of the cache file
+    const char *acc_5121;   // common accounts resolved at load time
+    const char *acc_580;
+    const char *acc_627;
+} ChartOfAccounts;
+
+// Field of the bank operation a classification rule looks at
+typedef enum {
+    RULE_FIELD_OPERATION,   // nature of the operation
+    RULE_FIELD_DETAILS,     // continuation lines of the statement
+    RULE_FIELD_LIBELLE      // merchant label of a card payment
+} RuleField;
 
-// Function to parse a line from the bank statement
-int parse_bank_operation(char *line, BankOperation *operation);
+// Journal entries generated for a classified operation
+typedef enum {
+    RULE_TPL_NONE,
+    RULE_TPL_REMISE_CB,     // credit clearing with gross, debit fees and bank
+    RULE_TPL_CARTE,         // card payment: merchant label, debit account, credit bank
+    RULE_TPL_DEBIT,         // debit account, credit bank
+    RULE_TPL_CREDIT         // credit account, debit bank
+} RuleTemplate;
 
-// Function to determine the account code based on operation type
-void determine_accounts(BankOperation *operation, JournalEntry *entries, int *entry_count, 
-                        AccountInfo *accounts, int account_count);
+// One line of the rules file
+typedef struct {
+    RuleField field;
+    int parent;             // operation rule refined by this rule, -1 for operation rules
+    int pattern;            // pattern that fires the rule
+    int condition;          // pattern that must also be present, -1 if none
+    char *account;          // keyword for find_account_by_keyword, NULL if none
+    char *fallback;         // account used when the keyword is not found, NULL for 401<LIBELLE>
+    char *libelle;          // libelle to write, NULL keeps the current one
+    RuleTemplate tpl;
+} ClassRule;
+
+// Aho-Corasick automaton over all rule patterns, as a DFA on byte classes
+typedef struct {
+    int *next;              // state * class_count + class -> state
+    int *out;               // pattern ending in the state, -1 if none
+    int *dict;              // next state on the failure chain with an output, -1 if none
+    unsigned char classes[256];
+    int class_count;
+    int state_count;
+} PatternAutomaton;
+
+// Account booked to a learned label, and the next account of the label
+typedef struct {
+    uint32_t account;       // offset in the strings of the history
+    uint32_t count;         // bookings of the label to the account
+    int32_t next;           // -1 at the end
+} HistoryAccount;
+
+// Normalized label of the past journals and the account it was booked to most
+typedef struct {
+    uint64_t hash;          // 0 marks an empty slot
+    uint32_t label;
+    uint32_t best;
+    uint32_t best_count;
+    uint32_t total;         // bookings of the label, all accounts
+    int32_t accounts;       // first HistoryAccount, -1 if none
+} HistoryLabel;
+
+// Label to account mapping learned from past journals, empty without --history
+typedef struct {
+    char *strings;          // NUL-terminated labels and accounts
+    size_t strings_len;
+    size_t strings_cap;
+    HistoryLabel *slots;    // open addressing on the normalized label
+    size_t mask;
+    int count;
+    HistoryAccount *accounts;
+    int account_count;
+    int account_capacity;
+} LabelHistory;
+
+// Compiled classification rules
+typedef struct {
+    ClassRule *rules;
+    int rule_count;
+    int rule_capacity;
+    char **patterns;
+    int pattern_count;
+    int pattern_capacity;
+    int *pattern_rules;     // rules fired by each pattern, in file order
+    int *pattern_rule_start;
+    int last_operation;
+    PatternAutomaton ac;
+    LabelHistory history;   // consulted before the chart lookups of the rules
+} RuleSet;
+
+// Per-thread classification state: chart, rules and automaton scratch
+typedef struct {
+    const ChartOfAccounts *chart;
+    const RuleSet *rules;
+    int *seen;              // generation stamp of the patterns found by the last scan
+    size_t *first_end;      // end offset of their first occurrence
+    int *hits;
+    int hit_count;
+    int generation;
+    Arena arena;            // strings of the operation being converted
+} Classifier;
+
+// Function to parse a line from the bank statement, splitting it in place
+int parse_bank_operation(char *line, size_t len, const CsvDialect *dialect, BankOperation *operation);
+
+// Function to find the dialect of a statement from its first bytes
+int sniff_statement(const char *data, size_t len, CsvDialect *dialect);
 
 // Function to convert a bank operation to journal entries
 int convert_to_journal_entries(BankOperation *operation, JournalEntry *entries, 
-                               AccountInfo *accounts, int account_count);
+                               Classifier *classifier);
 
 // Function to write a journal entry to the output file
-void write_journal_entry(FILE *output, JournalEntry *entry);
+void write_journal_entry(JournalWriter *output, JournalEntry *entry);
+
+// Function to convert a statement with a chart and rules loaded by the caller
+int convert_statement(RecordReader *reader, JournalWriter *output, const ChartOfAccounts *chart,
+                      const RuleSet *rules);
 
 // Main processing function
-int process_bank_statement(FILE *input, FILE *output, const char *chart_of_accounts_file);
+int process_bank_statement(RecordReader *reader, JournalWriter *output, const char *chart_of_accounts_file,
+                           const char *rules_file, char *const *history_files, int history_count, int threads);
+
+// Functions to convert a statement in two steps: its header, then its operations
+int find_statement_header(RecordReader *reader);
+int convert_statement_header(RecordReader *reader, JournalWriter *output);
+int convert_statement_records(RecordReader *reader, JournalWriter *output, Classifier *classifier);
+
+// Function to parse one record of the statement, continuation lines included
+int parse_statement_record(StatementRecord *record, BankOperation *operation, Arena *arena);
+
+// Function to convert one record of the statement, returns the entries written
+int convert_statement_record(StatementRecord *record, JournalWriter *output, Classifier *classifier);
+
+// Function to bring a journal up to date, converting only the operations it lacks
+int update_bank_journal(RecordReader *reader, const char *out_path, const char *chart_of_accounts_file,
+                        const char *rules_file, char *const *history_files, int history_count);
+
+// Function to convert a statement split in chunks converted on `threads` workers
+int convert_statement_parallel(RecordReader *reader, JournalWriter *output, const ChartOfAccounts *chart,
+                               const RuleSet *rules, int threads);
+
+// Function to load the chart of accounts, from its compiled cache when it is up to date
+int load_chart_of_accounts(const char *filename, ChartOfAccounts *chart);
+
+// Function to release a chart loaded by load_chart_of_accounts
+void free_chart_of_accounts(ChartOfAccounts *chart);
+
+// Function to find an account by number, then by keyword in the name, then as 401<keyword>
+const char* find_account_by_keyword(const char *keyword, const ChartOfAccounts *chart);
+
+// Function to load the classification rules (NULL or a missing file selects the built-in rules)
+int load_classification_rules(const char *filename, RuleSet *rules);
+
+// Function to release rules loaded by load_classification_rules
+void free_classification_rules(RuleSet *rules);
+
+// Functions to learn the accounts of the libelles of past journals; a missing
+// journal is only a warning, learning fails (-1, 0) when out of memory
+int learn_history(LabelHistory *history, const char *filename);
+int learn_history_files(LabelHistory *history, char *const *paths, int count);
+
+// Function to find the account most of the bookings of a libelle went to, NULL if none
+const char *history_account(const LabelHistory *history, Slice label);
+void free_history(LabelHistory *history);
+
+// Functions to set up and release the per-thread classification state
+int classifier_init(Classifier *classifier, const ChartOfAccounts *chart, const RuleSet *rules);
+void classifier_free(Classifier *classifier);
+
+// Function to find the first rule of a field matching the text, in a single pass
+const ClassRule *classify_field(Classifier *classifier, RuleField field, int parent,
+                                const char *text, size_t len, size_t *match_end);
+
+// Batch mode entry point (arguments after --batch)
+int run_batch(const char *program_name, int argc, char *argv[]);
+
+// Function to name the journal of a statement after its first date
+void journal_file_name(RecordReader *in, char *out, size_t outsz);
+
+// Functions to read a statement one record at a time
+int reader_init(RecordReader *reader, int fd);
+void reader_init_memory(RecordReader *reader, char *data, size_t len);
+int reader_load_all(RecordReader *reader);
+void reader_free(RecordReader *reader);
+int reader_sniff(RecordReader *reader);
+int reader_next_record(RecordReader *reader, StatementRecord *record);
+const char *reader_peek_line(RecordReader *reader, size_t *offset);
+
+// Field `index` of a line split on the delimiter outside quotes; empty past the last one
+Slice line_field(const char *line, size_t len, char delimiter, int index);
 
-// Function wrapper for compatibility with main.c
-int process_csv_file(FILE *input, FILE *output, const char *chart_of_accounts_file);
+// Function to tell a continuation line, whose date field is empty, from an operation
+int statement_continuation(const char *line, size_t len, const CsvDialect *dialect);
 
-// Function to load the chart of accounts
-int load_chart_of_accounts(const char *filename, AccountInfo *accounts, int max_accounts);
+// Function to trim and unquote a field without copying it
+Slice slice_clean(Slice s);
 
-// Function to find an account by keyword in the name
-const char* find_account_by_keyword(const char *keyword, AccountInfo *accounts, int account_count);
+// Functions to allocate from, rewind and release an arena; arena_alloc returns
+// NULL and marks the arena failed when out of memory
+void *arena_alloc(Arena *arena, size_t size);
+void arena_reset(Arena *arena);
+void arena_free(Arena *arena);
 
 // Utility function to clean a string (remove quotes, trim whitespace)
 void clean_string(char *str);
 
-// Utility function to format decimal numbers with comma as separator
-void format_number(char *str);
 
 #endif
 
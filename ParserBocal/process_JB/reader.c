@@ -0,0 +1,266 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   reader.c                                           :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:31:48 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:17:44 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "process.h"
+#include <errno.h>
+#include <unistd.h>
+
+// The statement is read forward only, through a window buffer that is
+// compacted (rather than wrapped) when it runs out of room so that a record,
+// the dated line plus its continuation lines, always sits in one contiguous
+// block that can be parsed in place. The window grows when a single line is
+// longer than it, so no line is ever truncated, and nothing needs seeking:
+// pipes and stdin work like regular files. The dialect of the statement is
+// decided from the first window; a Windows-1252 statement is converted to
+// UTF-8 from there on, a window at a time, so the journal is UTF-8 either way.
+
+#define READER_INITIAL_SIZE 65536
+
+int reader_init(RecordReader *reader, int fd) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = fd;
+    reader->cap = READER_INITIAL_SIZE;
+    reader->buf = malloc(reader->cap + 1);
+    if (!reader->buf) return 0;
+    reader->buf[0] = '\0';
+    sniff_statement("", 0, &reader->dialect);
+    return 1;
+}
+
+// Read records from bytes owned by the caller; a line ending the range must end with
+// '\n' or '\0', and the bytes after the range are never touched
+void reader_init_memory(RecordReader *reader, char *data, size_t len) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+    reader->buf = data;
+    reader->cap = len;
+    reader->end = len;
+    reader->eof = 1;
+    reader->borrowed = 1;
+    sniff_statement("", 0, &reader->dialect);
+}
+
+void reader_free(RecordReader *reader) {
+    if (!reader) return;
+    if (!reader->borrowed)
+        free(reader->buf);
+    free(reader->scratch);
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+}
+
+// Read more bytes after the window, keeping everything from the read position on
+static int reader_fill(RecordReader *reader) {
+    if (reader->eof) return 0;
+
+    if (reader->start > 0) {
+        memmove(reader->buf, reader->buf + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+    // A Windows-1252 byte takes up to three bytes once converted
+    size_t room = (reader->cap - reader->end) / (reader->cp1252 ? 3 : 1);
+    if (room == 0) {
+        char *grown = realloc(reader->buf, reader->cap * 2 + 1);
+        if (!grown) {
+            fprintf(stderr, "Error: Out of memory while reading input\n");
+            reader->eof = 1;
+            return 0;
+        }
+        reader->buf = grown;
+        reader->cap *= 2;
+        room = (reader->cap - reader->end) / (reader->cp1252 ? 3 : 1);
+    }
+
+    ssize_t n;
+    do {
+        n = read(reader->fd, reader->buf + reader->end, room);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        if (n < 0) fprintf(stderr, "Error: Could not read input: %s\n", strerror(errno));
+        reader->eof = 1;
+        reader->buf[reader->end] = '\0';
+        return 0;
+    }
+    if (reader->cp1252) {
+        size_t size = dialect_utf8_size(reader->buf + reader->end, (size_t)n);
+        dialect_to_utf8(reader->buf + reader->end, (size_t)n, reader->buf + reader->end);
+        n = (ssize_t)size;
+    }
+    reader->end += (size_t)n;
+    reader->buf[reader->end] = '\0';
+    return 1;
+}
+
+// Convert the window of a Windows-1252 statement to UTF-8, into a buffer of its own
+static int reader_convert(RecordReader *reader) {
+    size_t len = reader->end - reader->start;
+    size_t size = dialect_utf8_size(reader->buf + reader->start, len);
+    size_t cap = size > reader->cap ? size : reader->cap;
+    char *utf8 = malloc(cap + 1);
+
+    if (!utf8) {
+        fprintf(stderr, "Error: Out of memory while reading input\n");
+        return 0;
+    }
+    dialect_to_utf8(reader->buf + reader->start, len, utf8);
+    utf8[size] = '\0';
+    if (!reader->borrowed)
+        free(reader->buf);
+    reader->buf = utf8;
+    reader->cap = cap;
+    reader->start = 0;
+    reader->end = size;
+    reader->borrowed = 0;
+    reader->cp1252 = 1;
+    return 1;
+}
+
+// Decide the dialect of the statement from its first bytes, before anything
+// is read from it; returns 1 when its header row was found
+int reader_sniff(RecordReader *reader) {
+    if (reader->sniffed)
+        return reader->dialect.header_line >= 0;
+    reader->sniffed = 1;
+    while (reader->end - reader->start < DIALECT_SAMPLE_SIZE && reader_fill(reader))
+        ;
+    int found = sniff_statement(reader->buf + reader->start, reader->end - reader->start, &reader->dialect);
+    if (reader->dialect.encoding == DIALECT_CP1252 && !reader_convert(reader))
+        return 0;
+    return found;
+}
+
+// Read the rest of the input into the window, for callers that need all of it at once
+int reader_load_all(RecordReader *reader) {
+    while (!reader->eof) {
+        if (!reader_fill(reader) && !reader->eof)
+            return 0;
+    }
+    return 1;
+}
+
+// Find the line starting `offset` bytes after the read position and terminate it
+// in place. Returns its length and the offset of the following line, -1 at the end.
+static long reader_line(RecordReader *reader, size_t offset, size_t *next) {
+    for (;;) {
+        if (reader->eof && reader->start + offset >= reader->end)
+            return -1;
+        char *line = reader->buf + reader->start + offset;
+        char *eol = (char *)csv_find3(line, reader->buf + reader->end, '\n', '\0', '\0');
+        size_t len = (size_t)(eol - line);
+
+        if (eol < reader->buf + reader->end) {
+            *eol = '\0';
+            *next = offset + len + 1;
+            return (long)len;
+        }
+        if (!reader_fill(reader)) {
+            if (len == 0) return -1;
+            *next = offset + len;
+            return (long)len;
+        }
+    }
+}
+
+// Peek at the line `*offset` bytes after the read position without consuming it
+const char *reader_peek_line(RecordReader *reader, size_t *offset) {
+    size_t next;
+    if (reader_line(reader, *offset, &next) < 0)
+        return NULL;
+    const char *line = reader->buf + reader->start + *offset;
+    *offset = next;
+    return line;
+}
+
+Slice line_field(const char *line, size_t len, char delimiter, int index) {
+    const char *p = line, *end = line + len, *field = line;
+    int quoted = 0;
+
+    if (index < 0)
+        return slice_cstr("");
+    for (; p < end; p++) {
+        if (*p == '"') {
+            quoted = !quoted;
+        } else if (*p == delimiter && !quoted) {
+            if (index-- == 0)
+                return slice_between(field, p);
+            field = p + 1;
+        }
+    }
+    return index == 0 ? slice_between(field, end) : slice_cstr("");
+}
+
+// A continuation line carries on the operation above it: the bank leaves its
+// date field empty ("";"BT ..." in the SG export), blank lines are not ones
+int statement_continuation(const char *line, size_t len, const CsvDialect *dialect) {
+    if (slice_clean(slice_between(line, line + len)).len == 0)
+        return 0;
+    return slice_clean(line_field(line, len, dialect->delimiter, dialect->columns[STATEMENT_DATE])).len == 0;
+}
+
+static int scratch_append(RecordReader *reader, Slice text) {
+    size_t need = reader->scratch_len + text.len + 2;
+    if (need > reader->scratch_cap) {
+        size_t cap = reader->scratch_cap ? reader->scratch_cap : 256;
+        while (cap < need) cap *= 2;
+        char *grown = realloc(reader->scratch, cap);
+        if (!grown) return 0;
+        reader->scratch = grown;
+        reader->scratch_cap = cap;
+    }
+    if (reader->scratch_len)
+        reader->scratch[reader->scratch_len++] = '\n';
+    memcpy(reader->scratch + reader->scratch_len, text.ptr, text.len);
+    reader->scratch_len += text.len;
+    reader->scratch[reader->scratch_len] = '\0';
+    return 1;
+}
+
+// Read the next record: one line and the continuation lines that follow it.
+// The record stays valid until the next call.
+int reader_next_record(RecordReader *reader, StatementRecord *record) {
+    size_t next;
+    long len = reader_line(reader, 0, &next);
+    if (len < 0)
+        return 0;
+
+    record->len = (size_t)len;
+    record->line_count = 1;
+    reader->scratch_len = 0;
+
+    // A continuation line right after the header belongs to no operation
+    if (!statement_continuation(reader->buf + reader->start, record->len, &reader->dialect)) {
+        size_t cont_next;
+        long cont_len;
+        while ((cont_len = reader_line(reader, next, &cont_next)) >= 0) {
+            const char *cont = reader->buf + reader->start + next;
+            if (!statement_continuation(cont, (size_t)cont_len, &reader->dialect))
+                break;
+
+            // Keep the Nature field, where the bank writes the text of the line
+            Slice text = slice_clean(line_field(cont, (size_t)cont_len, reader->dialect.delimiter,
+                                                reader->dialect.columns[STATEMENT_NATURE]));
+            if (text.len && !scratch_append(reader, text))
+                fprintf(stderr, "Error: Out of memory while reading input\n");
+            record->line_count++;
+            next = cont_next;
+        }
+    }
+
+    record->line = reader->buf + reader->start;
+    record->continuation.ptr = reader->scratch_len ? reader->scratch : "";
+    record->continuation.len = reader->scratch_len;
+    record->dialect = &reader->dialect;
+    reader->start += next;
+    STATS_ADD(STAT_LINES_READ, record->line_count);
+    return 1;
+}
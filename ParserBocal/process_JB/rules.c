@@ -0,0 +1,371 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   rules.c                                            :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:27:40 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:32:17 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "process.h"
+
+// Operation classification rules.
+//
+// The rules come from a semicolon separated file (see "Regles JB.csv") so that
+// onboarding a supplier no longer needs a rebuild. Every distinct pattern of
+// the rule set is compiled into a single Aho-Corasick automaton: one pass over
+// a field reports every pattern it contains, and the winning rule is the one
+// that comes first in the file among the rules those patterns belong to.
+
+// Built-in rules, used when no rules file is found: "Regles JB.csv" itself,
+// turned into a string by make
+static const char *default_rules =
+#include "rules_default.h"
+    ;
+
+#define RULE_COLUMNS 7
+
+static char *dup_or_null(const char *s) {
+    return (s && *s) ? strdup(s) : NULL;
+}
+
+// Split a rules line on ';' keeping empty columns
+static int split_rule_line(char *line, char **cols, int max_cols) {
+    int n = 0;
+    char *p = line;
+    cols[n++] = p;
+    while (*p && n < max_cols) {
+        if (*p == ';') {
+            *p = '\0';
+            cols[n++] = p + 1;
+        }
+        p++;
+    }
+    for (int i = 0; i < n; i++) clean_string(cols[i]);
+    for (int i = n; i < max_cols; i++) cols[i] = "";
+    return n;
+}
+
+static int intern_pattern(RuleSet *rs, const char *text) {
+    for (int i = 0; i < rs->pattern_count; i++) {
+        if (strcmp(rs->patterns[i], text) == 0) return i;
+    }
+    if (rs->pattern_count == rs->pattern_capacity) {
+        int capacity = rs->pattern_capacity ? rs->pattern_capacity * 2 : 32;
+        char **grown = realloc(rs->patterns, (size_t)capacity * sizeof(char *));
+        if (!grown) return -1;
+        rs->patterns = grown;
+        rs->pattern_capacity = capacity;
+    }
+    rs->patterns[rs->pattern_count] = strdup(text);
+    if (!rs->patterns[rs->pattern_count]) return -1;
+    return rs->pattern_count++;
+}
+
+static int parse_field(const char *s, RuleField *field) {
+    if (strcasecmp(s, "operation") == 0) *field = RULE_FIELD_OPERATION;
+    else if (strcasecmp(s, "details") == 0) *field = RULE_FIELD_DETAILS;
+    else if (strcasecmp(s, "libelle") == 0) *field = RULE_FIELD_LIBELLE;
+    else return 0;
+    return 1;
+}
+
+static int parse_template(const char *s, RuleTemplate *tpl) {
+    if (*s == '\0') *tpl = RULE_TPL_NONE;
+    else if (strcasecmp(s, "REMISE_CB") == 0) *tpl = RULE_TPL_REMISE_CB;
+    else if (strcasecmp(s, "CARTE") == 0) *tpl = RULE_TPL_CARTE;
+    else if (strcasecmp(s, "DEBIT") == 0) *tpl = RULE_TPL_DEBIT;
+    else if (strcasecmp(s, "CREDIT") == 0) *tpl = RULE_TPL_CREDIT;
+    else return 0;
+    return 1;
+}
+
+// Add one line of the rules file; returns 0 if the line was rejected
+static int add_rule_line(RuleSet *rs, char *line, const char *origin, int line_no) {
+    char *cols[RULE_COLUMNS];
+    RuleField field;
+    RuleTemplate tpl;
+
+    split_rule_line(line, cols, RULE_COLUMNS);
+    if (cols[0][0] == '\0' || cols[0][0] == '#' || strcasecmp(cols[0], "Champ") == 0)
+        return 1;
+
+    if (!parse_field(cols[0], &field) || cols[1][0] == '\0' || !parse_template(cols[6], &tpl)) {
+        fprintf(stderr, "Warning: %s:%d: invalid rule ignored\n", origin, line_no);
+        return 0;
+    }
+    if (field == RULE_FIELD_OPERATION && tpl == RULE_TPL_NONE) {
+        fprintf(stderr, "Warning: %s:%d: operation rule without Modele ignored\n", origin, line_no);
+        return 0;
+    }
+    if (field != RULE_FIELD_OPERATION && rs->last_operation < 0) {
+        fprintf(stderr, "Warning: %s:%d: %s rule before any operation rule ignored\n",
+                origin, line_no, cols[0]);
+        return 0;
+    }
+
+    if (rs->rule_count == rs->rule_capacity) {
+        int capacity = rs->rule_capacity ? rs->rule_capacity * 2 : 32;
+        ClassRule *grown = realloc(rs->rules, (size_t)capacity * sizeof(ClassRule));
+        if (!grown) return 0;
+        rs->rules = grown;
+        rs->rule_capacity = capacity;
+    }
+
+    int pattern = intern_pattern(rs, cols[1]);
+    int condition = cols[2][0] ? intern_pattern(rs, cols[2]) : -1;
+    if (pattern < 0 || (cols[2][0] && condition < 0)) return 0;
+
+    ClassRule *rule = &rs->rules[rs->rule_count];
+    memset(rule, 0, sizeof(*rule));
+    rule->field = field;
+    rule->parent = (field == RULE_FIELD_OPERATION) ? -1 : rs->last_operation;
+    rule->pattern = pattern;
+    rule->condition = condition;
+    rule->account = dup_or_null(cols[3]);
+    rule->fallback = dup_or_null(cols[4]);
+    rule->libelle = dup_or_null(cols[5]);
+    rule->tpl = tpl;
+
+    // Sub-rules without their own default inherit the one of their operation
+    if (field != RULE_FIELD_OPERATION && !rule->fallback && rs->rules[rule->parent].fallback)
+        rule->fallback = strdup(rs->rules[rule->parent].fallback);
+
+    if (field == RULE_FIELD_OPERATION) rs->last_operation = rs->rule_count;
+    rs->rule_count++;
+    return 1;
+}
+
+// Compile every pattern into a DFA over byte classes (Aho-Corasick)
+static int build_automaton(RuleSet *rs) {
+    PatternAutomaton *ac = &rs->ac;
+    size_t max_states = 1;
+
+    memset(ac->classes, 0, sizeof(ac->classes));
+    ac->class_count = 1;
+    for (int p = 0; p < rs->pattern_count; p++) {
+        for (const unsigned char *s = (const unsigned char *)rs->patterns[p]; *s; s++) {
+            if (!ac->classes[*s]) ac->classes[*s] = (unsigned char)ac->class_count++;
+            max_states++;
+        }
+    }
+
+    int c = ac->class_count;
+    ac->next = malloc(max_states * (size_t)c * sizeof(int));
+    ac->out = malloc(max_states * sizeof(int));
+    ac->dict = malloc(max_states * sizeof(int));
+    int *fail = malloc(max_states * sizeof(int));
+    int *queue = malloc(max_states * sizeof(int));
+    if (!ac->next || !ac->out || !ac->dict || !fail || !queue) {
+        free(fail);
+        free(queue);
+        return 0;
+    }
+    memset(ac->next, 0xff, max_states * (size_t)c * sizeof(int));
+    ac->state_count = 1;
+    ac->out[0] = -1;
+    ac->dict[0] = -1;
+
+    // Trie
+    for (int p = 0; p < rs->pattern_count; p++) {
+        int state = 0;
+        for (const unsigned char *s = (const unsigned char *)rs->patterns[p]; *s; s++) {
+            int *slot = &ac->next[state * c + ac->classes[*s]];
+            if (*slot < 0) {
+                *slot = ac->state_count;
+                ac->out[ac->state_count] = -1;
+                ac->state_count++;
+            }
+            state = *slot;
+        }
+        ac->out[state] = p;
+    }
+
+    // Breadth-first failure links, turning the trie into a full DFA
+    int head = 0, tail = 0;
+    for (int k = 0; k < c; k++) {
+        int s = ac->next[k];
+        if (s < 0) {
+            ac->next[k] = 0;
+        } else {
+            fail[s] = 0;
+            ac->dict[s] = -1;
+            queue[tail++] = s;
+        }
+    }
+    while (head < tail) {
+        int state = queue[head++];
+        for (int k = 0; k < c; k++) {
+            int s = ac->next[state * c + k];
+            if (s < 0) {
+                ac->next[state * c + k] = ac->next[fail[state] * c + k];
+            } else {
+                int f = ac->next[fail[state] * c + k];
+                fail[s] = f;
+                ac->dict[s] = (ac->out[f] >= 0) ? f : ac->dict[f];
+                queue[tail++] = s;
+            }
+        }
+    }
+
+    free(fail);
+    free(queue);
+    return 1;
+}
+
+// Index rules by the pattern they fire on
+static int build_pattern_rules(RuleSet *rs) {
+    rs->pattern_rule_start = calloc((size_t)rs->pattern_count + 1, sizeof(int));
+    rs->pattern_rules = malloc((size_t)(rs->rule_count ? rs->rule_count : 1) * sizeof(int));
+    if (!rs->pattern_rule_start || !rs->pattern_rules) return 0;
+
+    for (int r = 0; r < rs->rule_count; r++)
+        rs->pattern_rule_start[rs->rules[r].pattern + 1]++;
+    for (int p = 0; p < rs->pattern_count; p++)
+        rs->pattern_rule_start[p + 1] += rs->pattern_rule_start[p];
+
+    int *fill = calloc((size_t)rs->pattern_count + 1, sizeof(int));
+    if (!fill) return 0;
+    for (int r = 0; r < rs->rule_count; r++) {
+        int p = rs->rules[r].pattern;
+        rs->pattern_rules[rs->pattern_rule_start[p] + fill[p]++] = r;
+    }
+    free(fill);
+    return 1;
+}
+
+static int load_rules_text(RuleSet *rs, FILE *file, const char *text, const char *origin) {
+    char line[MAX_LINE_SIZE];
+    int line_no = 0;
+
+    for (;;) {
+        if (file) {
+            if (!fgets(line, sizeof(line), file)) break;
+        } else {
+            if (!*text) break;
+            const char *eol = strchr(text, '\n');
+            size_t len = eol ? (size_t)(eol - text) : strlen(text);
+            if (len >= sizeof(line)) len = sizeof(line) - 1;
+            memcpy(line, text, len);
+            line[len] = '\0';
+            text += eol ? len + 1 : len;
+        }
+        line_no++;
+        add_rule_line(rs, line, origin, line_no);
+    }
+    return rs->rule_count;
+}
+
+// Load the classification rules; a NULL or missing file selects the built-in rules
+int load_classification_rules(const char *filename, RuleSet *rs) {
+    memset(rs, 0, sizeof(*rs));
+    rs->last_operation = -1;
+
+    FILE *file = filename ? fopen(filename, "r") : NULL;
+    if (file) {
+        load_rules_text(rs, file, NULL, filename);
+        fclose(file);
+        printf("Loaded %d classification rules from %s\n", rs->rule_count, filename);
+    } else {
+        if (filename)
+            fprintf(stderr, "Warning: Could not open rules file %s, using built-in rules\n", filename);
+        load_rules_text(rs, NULL, default_rules, "built-in rules");
+    }
+
+    if (!build_automaton(rs) || !build_pattern_rules(rs)) {
+        fprintf(stderr, "Error: Out of memory while compiling classification rules\n");
+        free_classification_rules(rs);
+        return 0;
+    }
+    return rs->rule_count;
+}
+
+void free_classification_rules(RuleSet *rs) {
+    if (!rs) return;
+    for (int r = 0; r < rs->rule_count; r++) {
+        free(rs->rules[r].account);
+        free(rs->rules[r].fallback);
+        free(rs->rules[r].libelle);
+    }
+    for (int p = 0; p < rs->pattern_count; p++) free(rs->patterns[p]);
+    free(rs->rules);
+    free(rs->patterns);
+    free(rs->pattern_rules);
+    free(rs->pattern_rule_start);
+    free(rs->ac.next);
+    free(rs->ac.out);
+    free(rs->ac.dict);
+    free_history(&rs->history);
+    memset(rs, 0, sizeof(*rs));
+}
+
+int classifier_init(Classifier *cl, const ChartOfAccounts *chart, const RuleSet *rules) {
+    size_t n = (size_t)(rules->pattern_count ? rules->pattern_count : 1);
+    memset(cl, 0, sizeof(*cl));
+    cl->chart = chart;
+    cl->rules = rules;
+    cl->seen = calloc(n, sizeof(int));
+    cl->first_end = malloc(n * sizeof(size_t));
+    cl->hits = malloc(n * sizeof(int));
+    if (!cl->seen || !cl->first_end || !cl->hits) {
+        classifier_free(cl);
+        return 0;
+    }
+    return 1;
+}
+
+void classifier_free(Classifier *cl) {
+    if (!cl) return;
+    free(cl->seen);
+    free(cl->first_end);
+    free(cl->hits);
+    arena_free(&cl->arena);
+    cl->seen = NULL;
+    cl->first_end = NULL;
+    cl->hits = NULL;
+}
+
+// Scan a field once and return the first rule of `field` under `parent` that fires
+const ClassRule *classify_field(Classifier *cl, RuleField field, int parent,
+                                const char *text, size_t len, size_t *match_end) {
+    const RuleSet *rs = cl->rules;
+    const PatternAutomaton *ac = &rs->ac;
+    int state = 0;
+
+    if (!text || !rs->rule_count) return NULL;
+
+    cl->generation++;
+    cl->hit_count = 0;
+    for (size_t i = 0; i < len; i++) {
+        state = ac->next[state * ac->class_count + ac->classes[(unsigned char)text[i]]];
+        for (int t = (ac->out[state] >= 0) ? state : ac->dict[state]; t >= 0; t = ac->dict[t]) {
+            int p = ac->out[t];
+            if (cl->seen[p] != cl->generation) {
+                cl->seen[p] = cl->generation;
+                cl->first_end[p] = i + 1;
+                cl->hits[cl->hit_count++] = p;
+            }
+        }
+    }
+
+    int best = -1;
+    for (int h = 0; h < cl->hit_count; h++) {
+        int p = cl->hits[h];
+        for (int k = rs->pattern_rule_start[p]; k < rs->pattern_rule_start[p + 1]; k++) {
+            int r = rs->pattern_rules[k];
+            const ClassRule *rule = &rs->rules[r];
+            if (best >= 0 && r >= best) break;
+            if (rule->field != field || rule->parent != parent) continue;
+            if (rule->condition >= 0 && cl->seen[rule->condition] != cl->generation) continue;
+            best = r;
+            break;
+        }
+    }
+
+    if (best < 0) return NULL;
+    if (match_end) *match_end = cl->first_end[rs->rules[best].pattern];
+    return &rs->rules[best];
+}
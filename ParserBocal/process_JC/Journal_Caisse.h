@@ -0,0 +1,22 @@
+#ifndef JOURNAL_CAISSE_H
+# define JOURNAL_CAISSE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../common/jwriter.h"
+#include "../common/csvscan.h"
+#include "../common/stats.h"
+#include "../common/dates.h"
+#include "../common/dialect.h"
+
+// Convert the withdrawals of a cash export, held in a writable NUL-terminated buffer,
+// into rows of `output` (cpte after Libelle); `name` receives the journal file name.
+// Returns the number of days written, -1 if the export has no header row naming
+// its DATE and RETRAITS columns.
+int convert_cash_withdrawals(char *data, size_t size, JournalWriter *output, char *name, size_t name_size);
+
+#endif
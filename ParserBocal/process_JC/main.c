@@ -0,0 +1,95 @@
+#include "Journal_Caisse.h"
+
+// Function to check if a file is an Excel file based on extension
+int is_excel_file(const char *filename) {
+    const char *ext = strrchr(filename, '.');
+    if (ext != NULL) {
+        if (strcmp(ext, ".xlsx") == 0 || strcmp(ext, ".xls") == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int finish(Stats *stats, const char *path, const char *input, int status) {
+    if (stats && !stats_report(stats, STATS_JC, input, status == 0, path))
+        return 1;
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    const char *stats_path = NULL;
+    Stats stats, *counting = NULL;
+
+    // --stats[=file] reports counters and stage timings
+    if (argc == 3 && stats_option(argv[1], &stats_path)) {
+        counting = &stats;
+        argv[1] = argv[0];
+        argv++;
+        argc--;
+    }
+    if (argc != 2) {
+        printf("Usage: %s [--stats[=file]] <input_file>\n", argv[0]);
+        return 1;
+    }
+    if (counting)
+        stats_start(counting);
+
+    // Check if the input file is an Excel file
+    if (is_excel_file(argv[1])) {
+        printf("Error: Excel files (.xlsx/.xls) are not supported directly.\n");
+        printf("Please convert the Excel file to CSV format first and then run the program.\n");
+        printf("You can do this by opening the Excel file and using 'Save As' with CSV format.\n");
+        return 1;
+    }
+
+    size_t input_size;
+    char *input = csv_read_file(argv[1], &input_size);
+    STATS_LAP(STAT_STAGE_READ);
+    if (!input) {
+        printf("Error: Could not open input file %s\n", argv[1]);
+        return finish(counting, stats_path, argv[1], 1);
+    }
+
+    // Rows are built in memory, the file is only created when there is something to write
+    char output_filename[256] = "";
+    JournalWriter rows;
+    if (!jwriter_init(&rows, -1, JOURNAL_LAYOUT_LIBELLE_CPTE)) {
+        printf("Error: Out of memory\n");
+        free(input);
+        return finish(counting, stats_path, argv[1], 1);
+    }
+    int days = convert_cash_withdrawals(input, input_size, &rows, output_filename, sizeof(output_filename));
+    free(input);
+    if (days < 0) {
+        printf("Error: Input file has no DATE and RETRAITS header row\n");
+        jwriter_close(&rows);
+        return finish(counting, stats_path, argv[1], 1);
+    }
+    if (days == 0) {
+        printf("No valid data found in input file\n");
+        jwriter_close(&rows);
+        return finish(counting, stats_path, argv[1], 0);
+    }
+
+    JournalWriter output;
+    int output_fd = open(output_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (output_fd < 0 || !jwriter_init(&output, output_fd, JOURNAL_LAYOUT_LIBELLE_CPTE)) {
+        printf("Error: Could not create output file %s\n", output_filename);
+        if (output_fd >= 0) close(output_fd);
+        jwriter_close(&rows);
+        return finish(counting, stats_path, argv[1], 1);
+    }
+    STATS_LAP_START();
+    jwriter_write(&output, rows.buf, rows.len);
+    STATS_ADD(STAT_BYTES_WRITTEN, jwriter_tell(&output));
+    int written = jwriter_close(&output) && !rows.failed;
+    jwriter_close(&rows);
+    if (close(output_fd) != 0 || !written) {
+        printf("Error: Could not write output file %s\n", output_filename);
+        return finish(counting, stats_path, argv[1], 1);
+    }
+    STATS_LAP(STAT_STAGE_WRITE);
+    printf("Successfully created %s\n", output_filename);
+    return finish(counting, stats_path, argv[1], 0);
+}
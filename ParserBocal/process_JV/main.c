@@ -0,0 +1,125 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   main.c                                             :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 14:47:29 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:37:05 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "process.h"
+
+// Main function to process files and create journal
+int main(int argc, char *argv[]) {
+    char ca_filename[256] = "/Users/igilbert/Desktop/Projets/ParserBocal/assets/Journal Vente Fevrier 2025/CAISSE-CA Fevrier 2025.csv";
+    char reglement_filename[256] = "/Users/igilbert/Desktop/Projets/ParserBocal/assets/Journal Vente Fevrier 2025/CAISSE-Reglement Fevrier 2025.csv";
+    char output_filename[256];
+    const char *stats_path = NULL;
+    int counting = 0;
+    Stats stats;
+    
+    // -q keeps only the errors, --stats[=file] reports counters and stage timings
+    while (argc >= 2) {
+        if (strcmp(argv[1], "-q") == 0)
+            jv_verbose = 0;
+        else if (stats_option(argv[1], &stats_path))
+            counting = 1;
+        else
+            break;
+        argv[1] = argv[0];
+        argv++;
+        argc--;
+    }
+    if (counting)
+        stats_start(&stats);
+    
+    // Allow command line arguments for filenames
+    if (argc >= 3) {
+        strncpy(ca_filename, argv[1], sizeof(ca_filename) - 1);
+        strncpy(reglement_filename, argv[2], sizeof(reglement_filename) - 1);
+    }
+    
+    // Accounts of the VAT rates beyond 5.5% and 20%, when the client has some
+    if (access(VAT_ACCOUNTS_FILE, R_OK) == 0) {
+        if (!vat_load_accounts(VAT_ACCOUNTS_FILE)) {
+            fprintf(stderr, "Error opening file: %s\n", VAT_ACCOUNTS_FILE);
+            return 1;
+        }
+        JV_LOG("VAT accounts read from: %s\n", VAT_ACCOUNTS_FILE);
+    }
+    
+    JV_LOG("Processing files:\n1. %s\n2. %s\n", ca_filename, reglement_filename);
+    
+    // Create output filename based on input
+    journal_output_name(ca_filename, output_filename, sizeof(output_filename));
+    
+    JV_LOG("Output will be written to: %s\n", output_filename);
+    
+    // The sales are streamed through a window, the payments read whole for their
+    // index; the journal is written day by day as they are joined
+    size_t payments_size = 0;
+    SalesStream sales;
+    STATS_LAP_START();
+    JV_LOG("Reading sales data from: %s\n", ca_filename);
+    int sales_fd = open(ca_filename, O_RDONLY);
+    int sales_ok = sales_fd >= 0 && sales_stream_open(&sales, sales_fd);
+    JV_LOG("Reading payment data from: %s\n", reglement_filename);
+    char *payments = csv_read_file(reglement_filename, &payments_size);
+    STATS_LAP(STAT_STAGE_READ);
+    if (!sales_ok)
+        fprintf(stderr, "Error opening file: %s\n", ca_filename);
+    if (!payments)
+        fprintf(stderr, "Error opening file: %s\n", reglement_filename);
+    
+    JournalWriter writer;
+    int fd = -1;
+    int entry_count = -1;
+    if (sales_ok && payments) {
+        fd = open(output_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || !jwriter_init(&writer, fd, JOURNAL_LAYOUT_CPTE_LIBELLE)) {
+            fprintf(stderr, "Error creating output file: %s\n", output_filename);
+            if (fd >= 0) close(fd);
+            sales_stream_free(&sales);
+            close(sales_fd);
+            free(payments);
+            if (counting)
+                stats_report(&stats, STATS_JV, ca_filename, 0, stats_path);
+            return 1;
+        }
+        entry_count = generate_sales_journal(&sales, payments, payments_size, &writer);
+        STATS_ADD(STAT_BYTES_WRITTEN, jwriter_tell(&writer));
+    }
+    if (sales_ok)
+        sales_stream_free(&sales);
+    if (sales_fd >= 0)
+        close(sales_fd);
+    free(payments);
+    
+    int ok = entry_count > 0;
+    if (entry_count < 0) {
+        fprintf(stderr, "Error: No data read from input files. Aborting.\n");
+    } else if (!ok) {
+        fprintf(stderr, "Error: No matching entries found. Check date formats in input files.\n");
+    }
+    if (fd >= 0) {
+        STATS_LAP_START();
+        if (!jwriter_close(&writer) || close(fd) != 0) {
+            if (ok)
+                fprintf(stderr, "Error writing to output file: %s\n", output_filename);
+            ok = 0;
+        }
+        STATS_LAP(STAT_STAGE_WRITE);
+        // Nothing to keep without a journal
+        if (!ok)
+            unlink(output_filename);
+    }
+    if (ok)
+        JV_LOG("Successfully processed %d entries and wrote to %s\n", entry_count, output_filename);
+    if (counting && !stats_report(&stats, STATS_JV, ca_filename, ok, stats_path))
+        ok = 0;
+    return ok ? 0 : 1;
+}
+
@@ -6,12 +6,31 @@
 /*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/04/18 15:50:41 by igilbert          #+#    #+#             */
-/*   Updated: 2025/09/08 15:18:39 by igilbert         ###   ########.fr       */
+/*   Updated: 2026/10/17 01:37:05 by igilbert         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
 #include "process.h"
 
+// Progress messages on stdout, errors always go to stderr
+_Thread_local int jv_verbose = 1;
+
+// Columns read from the exports, found by name in their header rows
+enum { SALES_DATE, SALES_TTC, SALES_HT, SALES_COLUMNS };
+static const DialectColumn sales_columns[SALES_COLUMNS] = {
+    {"date", 0, DIALECT_REQUIRED | DIALECT_DATE},
+    {"ca ttc", 1, DIALECT_REQUIRED},
+    {"ca ht", 2, DIALECT_REQUIRED},
+};
+
+enum { PAYMENT_DATE, PAYMENT_ESPECES, PAYMENT_CARTES, PAYMENT_TOTAL, PAYMENT_COLUMNS };
+static const DialectColumn payment_columns[PAYMENT_COLUMNS] = {
+    {"date", 0, DIALECT_REQUIRED | DIALECT_DATE},
+    {"especes", 1, DIALECT_REQUIRED},
+    {"cartes", 3, DIALECT_REQUIRED},
+    {"total", 14, 0},
+};
+
 // Utility function to trim whitespace from strings
 char* trim(char *str) {
     if (!str) return NULL;
@@ -31,40 +50,25 @@ char* trim(char *str) {
     return str;
 }
 
-// Convert string with numbers to double
-double extract_number(const char *str) {
-    char *temp = strdup(str);
-    char *clean = temp;
-    
-    // Skip any non-digit characters at start except for a minus sign
-    while (*clean && !isdigit(*clean) && *clean != '-' && *clean != '.') clean++;
-    
-    double result = atof(clean);
-    free(temp);
-    
+// Convert the first number of a string to cents
+Money extract_number(const char *str) {
+    Money result;
+    money_parse(str, strlen(str), &result);
     return result;
 }
 
-// Parse CSV line into fields
-int parse_csv_line(char *line, char **fields, int max_fields, char delimiter) {
-    int count = 0;
-    int in_quotes = 0;
-    char *p = line;
-    fields[count++] = p;
-    
-    while (*p && count < max_fields) {
-        if (*p == '\"') {
-            in_quotes = !in_quotes;
-        } else if (*p == delimiter && !in_quotes) {
-            *p = '\0';
-            fields[count++] = p + 1;
-        }
-        p++;
-    }
+// Parse CSV line into fields, trimmed and unquoted in place
+int parse_csv_line(char *line, size_t line_len, char **fields, int max_fields, char delimiter) {
+    Slice raw[20];
+    int count;
+
+    if (max_fields > 20)
+        max_fields = 20;
+    count = csv_split(line, line_len, delimiter, raw, max_fields);
     
     // Trim quotes and whitespace from each field
     for (int i = 0; i < count; i++) {
-        fields[i] = trim(fields[i]);
+        fields[i] = trim((char *)raw[i].ptr);
         
         // Remove surrounding quotes if present
         int len = strlen(fields[i]);
@@ -77,62 +81,6 @@ int parse_csv_line(char *line, char **fields, int max_fields, char delimiter) {
     return count;
 }
 
-// Normalize the date format to DD/MM/YYYY for consistent comparison
-void normalize_date(const char *input_date, char *normalized_date, size_t size) {
-    // Check if format is M/D/YY (like 2/1/25)
-    if (strchr(input_date, '/') && strlen(input_date) <= 8) {
-        int day, month, year;
-        if (sscanf(input_date, "%d/%d/%d", &day, &month, &year) == 3 ||
-            sscanf(input_date, "%d/%d/%d", &month, &day, &year) == 3) {
-            // Convert YY to YYYY if needed
-            if (year < 100) {
-                year += 2000;
-            }
-            snprintf(normalized_date, size, "%02d/%02d/%d", day, month, year);
-            printf("Normalized date from '%s' to '%s'\n", input_date, normalized_date);
-            return;
-        }
-    }
-    
-    // Default: just copy the date as is
-    strncpy(normalized_date, input_date, size - 1);
-    normalized_date[size - 1] = '\0';
-    printf("Kept original date format: %s\n", normalized_date);
-}
-
-// Extract VAT information from TVA detail lines - improved version
-void extract_vat_info(const char *line, double *vat_5_5_amount, double *vat_5_5_ht, 
-                     double *vat_20_amount, double *vat_20_ht) {
-    printf("Processing VAT line: %s\n", line);
-    
-    if (strstr(line, "TVA: 5.50%") || strstr(line, "TVA: 5,50%") || strstr(line, "TVA:5.50%")) {
-        char *amount_str = strstr(line, "Montant:");
-        char *ht_str = strstr(line, "HT:");
-        
-        if (amount_str && ht_str) {
-            *vat_5_5_amount = extract_number(amount_str + 8);
-            *vat_5_5_ht = extract_number(ht_str + 3);
-            printf("Found 5.5%% VAT: Amount=%.2f, HT=%.2f\n", *vat_5_5_amount, *vat_5_5_ht);
-        }
-    } else if (strstr(line, "TVA:20.00%") || strstr(line, "TVA: 20.00%") || 
-               strstr(line, "TVA: 20,00%") || strstr(line, "TVA:20,00%")) {
-        char *amount_str = strstr(line, "Montant:");
-        char *ht_str = strstr(line, "HT:");
-        
-        if (amount_str && ht_str) {
-            *vat_20_amount = extract_number(amount_str + 8);
-            *vat_20_ht = extract_number(ht_str + 3);
-            printf("Found 20%% VAT: Amount=%.2f, HT=%.2f\n", *vat_20_amount, *vat_20_ht);
-        }
-    }
-}
-
-void convert_date_to_julian(const char *date, char *julian) {
-    // Instead of converting to Julian, we'll keep the DD/MM/YYYY format
-    strncpy(julian, date, MAX_FIELD_LENGTH - 1);
-    julian[MAX_FIELD_LENGTH - 1] = '\0';
-}
-
 // Get month name from month number
 char* get_month_name(int month) {
     static char *month_names[] = {
@@ -147,335 +95,402 @@ char* get_month_name(int month) {
     return "Inconnu";
 }
 
-// Read sales data from CAISSE-CA file - enhanced with date normalization
-int read_sales_data(const char *filename, SalesData *sales_data, int max_entries) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Error opening file: %s\n", filename);
+// Scan the records after the header row of an export; none without a header row
+static int stream_start(CsvScanner *scanner, CsvDialect *dialect, const DialectColumn *columns, int count,
+                        char *data, size_t size) {
+    int found = dialect_sniff(data, size, columns, count, dialect);
+    size_t offset = found ? dialect->data_offset : size;
+
+    csv_init(scanner, data, size);
+    scanner->pos = offset;
+    if (found) {
+        STATS_ADD(STAT_LINES_READ, dialect->header_line + 1);
+        STATS_ADD(STAT_SKIPPED_HEADER, dialect->header_line + 1);
+    }
+    return found;
+}
+
+// Stream the sales export from a file descriptor, through a window that only
+// grows for a record longer than it; returns 0 if out of memory
+int sales_stream_open(SalesStream *stream, int fd) {
+    memset(stream, 0, sizeof(*stream));
+    stream->fd = fd;
+    stream->cap = SALES_WINDOW_SIZE;
+    stream->buf = malloc(stream->cap + 1);
+    if (!stream->buf)
         return 0;
+    stream->buf[0] = '\0';
+    return 1;
+}
+
+// Stream the sales export held whole in a writable, NUL-terminated buffer
+void sales_stream_init(SalesStream *stream, char *data, size_t size) {
+    memset(stream, 0, sizeof(*stream));
+    stream->fd = -1;
+    stream->buf = data;
+    stream->cap = size;
+    stream->end = size;
+    stream->eof = 1;
+    stream->borrowed = 1;
+}
+
+void sales_stream_free(SalesStream *stream) {
+    if (!stream->borrowed)
+        free(stream->buf);
+    stream->buf = NULL;
+}
+
+// Read more of the export after the window, keeping the bytes from the next
+// record on; the scanner starts again at the front of the window
+static int sales_stream_fill(SalesStream *stream) {
+    size_t keep = stream->scanner.pos;
+    ssize_t n = 0;
+
+    if (stream->eof)
+        return 0;
+    if (keep > 0) {
+        memmove(stream->buf, stream->buf + keep, stream->end - keep);
+        stream->end -= keep;
     }
-    
-    printf("Reading sales data from: %s\n", filename);
-    
-    char line[MAX_LINE_LENGTH];
-    char *fields[20];
-    int current_entry = -1;
-    int data_section = 0;
-    int count = 0;
-    
-    while (fgets(line, sizeof(line), file) && count < max_entries) {
-        // Remove newline character
-        size_t len = strlen(line);
-        if (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
-            line[len-1] = '\0';
-        
-        // Replace commas with dots for number parsing
-        char *p = line;
-        while (*p) {
-            if (*p == ',') *p = '.';
-            p++;
-        }
-        
-        // Check for start of data section
-        if (strstr(line, "Date") && strstr(line, "CA TTC") && strstr(line, "CA HT")) {
-            data_section = 1;
-            printf("Found data section header\n");
-            continue;
-        }
-        
-        if (data_section) {
-            // Parse the line
-            int field_count = parse_csv_line(line, fields, 20, ';');
-            
-            // Check if this is a date line with sales data
-            if (field_count >= 4 && fields[0][0] != '\0' && 
-                strstr(fields[0], "/") && isdigit(fields[0][0])) {
-                current_entry++;
-                count++;
-                
-                if (current_entry >= max_entries)
-                    break;
-                
-                // Normalize date format
-                char normalized_date[MAX_DATE_LENGTH];
-                normalize_date(fields[0], normalized_date, MAX_DATE_LENGTH);
-                
-                // Copy normalized date
-                strncpy(sales_data[current_entry].date, normalized_date, MAX_DATE_LENGTH - 1);
-                sales_data[current_entry].date[MAX_DATE_LENGTH - 1] = '\0';
-                
-                // Parse CA TTC and CA HT - replace commas with dots
-                sales_data[current_entry].ca_ttc = extract_number(fields[1]);
-                sales_data[current_entry].ca_ht = extract_number(fields[2]);
-                
-                // Initialize VAT fields
-                sales_data[current_entry].vat_5_5_amount = 0.0;
-                sales_data[current_entry].vat_5_5_ht = 0.0;
-                sales_data[current_entry].vat_20_amount = 0.0;
-                sales_data[current_entry].vat_20_ht = 0.0;
-                
-                printf("Read sales entry: Date=%s, TTC=%.2f, HT=%.2f\n", 
-                       sales_data[current_entry].date,
-                       sales_data[current_entry].ca_ttc, 
-                       sales_data[current_entry].ca_ht);
-            } 
-            // Check if this is a VAT details line
-            else if (current_entry >= 0 && 
-                    (strstr(line, "TVA: 5.50%") || strstr(line, "TVA:20.00%") || 
-                     strstr(line, "TVA: 20.00%") || strstr(line, "TVA: 5,50%") || 
-                     strstr(line, "TVA: 20,00%"))) {
-                extract_vat_info(line, 
-                                &sales_data[current_entry].vat_5_5_amount,
-                                &sales_data[current_entry].vat_5_5_ht,
-                                &sales_data[current_entry].vat_20_amount,
-                                &sales_data[current_entry].vat_20_ht);
-            }
+    if (stream->end == stream->cap) {
+        char *grown = realloc(stream->buf, stream->cap * 2 + 1);
+        if (grown) {
+            stream->buf = grown;
+            stream->cap *= 2;
+        } else {
+            fprintf(stderr, "Error: Out of memory while reading the sales\n");
         }
     }
-    
-    fclose(file);
-    printf("Finished reading sales data. Found %d entries.\n", count);
-    return count;
+    if (stream->end < stream->cap) {
+        do {
+            n = read(stream->fd, stream->buf + stream->end, stream->cap - stream->end);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0)
+            fprintf(stderr, "Error: Could not read the sales: %s\n", strerror(errno));
+    }
+    if (n > 0)
+        stream->end += (size_t)n;
+    else
+        stream->eof = 1;
+    stream->buf[stream->end] = '\0';
+    csv_init(&stream->scanner, stream->buf, stream->end);
+    return n > 0;
 }
 
-// Read payment data from CAISSE-Reglement file - enhanced with date normalization
-int read_payment_data(const char *filename, PaymentData *payment_data, int max_entries) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Error opening file: %s\n", filename);
-        return 0;
+// Dialect of the export from its first window, then the records after its header row
+static void sales_stream_start(SalesStream *stream) {
+    while (stream->end < DIALECT_SAMPLE_SIZE && sales_stream_fill(stream))
+        ;
+    if (stream_start(&stream->scanner, &stream->dialect, sales_columns, SALES_COLUMNS, stream->buf, stream->end))
+        JV_LOG("Found data section header\n");
+    else
+        stream->eof = 1;
+}
+
+// Next record, read further into the export when the window ends inside it
+static int sales_stream_record(SalesStream *stream, Slice *record) {
+    for (;;) {
+        size_t pos = stream->scanner.pos;
+        if (csv_next_record(&stream->scanner, record)) {
+            if (stream->eof || record->ptr + record->len < stream->buf + stream->end)
+                return 1;
+            stream->scanner.pos = pos;
+        } else if (stream->eof) {
+            return 0;
+        }
+        sales_stream_fill(stream);
     }
-    
-    printf("Reading payment data from: %s\n", filename);
-    
-    char line[MAX_LINE_LENGTH];
+}
+
+// Next day of the sales export with its VAT details; returns 0 at the end
+int sales_stream_next(SalesStream *stream, SalesData *day) {
+    const CsvDialect *dialect = &stream->dialect;
+    Slice record;
     char *fields[20];
-    int data_section = 0;
-    int count = 0;
+    char text[DATE_TEXT_SIZE];
+    Day date;
     
-    while (fgets(line, sizeof(line), file) && count < max_entries) {
-        // Remove newline character
-        size_t len = strlen(line);
-        if (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
-            line[len-1] = '\0';
+    while (sales_stream_record(stream, &record)) {
+        char *line = (char *)record.ptr;
+        STATS_ADD(STAT_LINES_READ, 1);
         
-        // Replace commas with dots for number parsing
-        char *p = line;
-        while (*p) {
-            if (*p == ',') *p = '.';
-            p++;
-        }
-            
-        // Check for header line with "Date", "ESPECES", "CARTES", "TOTAL"
-        if (strstr(line, "Date") && strstr(line, "ESPECES") && strstr(line, "CARTES") && 
-            strstr(line, "TOTAL")) {
-            data_section = 1;
-            printf("Found payment data section header\n");
+        if (record.len == 0) {
+            STATS_ADD(STAT_SKIPPED_EMPTY, 1);
             continue;
         }
         
-        if (data_section) {
-            // Parse the line
-            int field_count = parse_csv_line(line, fields, 20, ';');
+        // Parse the record
+        int field_count = parse_csv_line(line, record.len, fields, 20, dialect->delimiter);
+        int date_column = dialect->columns[SALES_DATE];
+        const char *date_field = field_count > date_column ? fields[date_column] : "";
+        
+        // Check if this is a date line with sales data
+        if (field_count >= dialect->required_fields &&
+            date_parse(date_field, strlen(date_field), dialect->order, &date)) {
+            STATS_ADD(STAT_RECORDS_PARSED, 1);
             
-            // Check if this is a data line with date and payment info
-            if (field_count >= 14 && fields[0][0] != '\0' && 
-                strstr(fields[0], "/") && isdigit(fields[0][0])) {
-                
-                if (count >= max_entries)
-                    break;
-                
-                // Normalize date format
-                char normalized_date[MAX_DATE_LENGTH];
-                normalize_date(fields[0], normalized_date, MAX_DATE_LENGTH);
-                
-                // Copy normalized date
-                strncpy(payment_data[count].date, normalized_date, MAX_DATE_LENGTH - 1);
-                payment_data[count].date[MAX_DATE_LENGTH - 1] = '\0';
-                
-                // Parse payment amounts
-                payment_data[count].especes = extract_number(fields[1]);
-                payment_data[count].cartes = extract_number(fields[3]);
-                
-                // Try to get the total from the last field or calculate it
-                if (field_count >= 15 && fields[14] && *fields[14]) {
-                    payment_data[count].total = extract_number(fields[14]);
-                } else {
-                    // Calculate total from available payment methods
-                    payment_data[count].total = payment_data[count].especes + payment_data[count].cartes;
-                }
-                
-                printf("Read payment entry: Date=%s, Especes=%.2f, Cartes=%.2f, Total=%.2f\n", 
-                       payment_data[count].date, 
-                       payment_data[count].especes, 
-                       payment_data[count].cartes, 
-                       payment_data[count].total);
-                
-                count++;
-            }
-            // Check if we've reached the totals line (usually has no date)
-            else if (field_count >= 14 && (fields[0][0] == '\0' || !strstr(fields[0], "/")) && 
-                    isdigit(fields[1][0]) && isdigit(fields[3][0])) {
-                printf("Found totals line, ending payment data processing\n");
-                break;
-            }
+            // The day read so far is complete
+            int complete = stream->has_day;
+            if (complete)
+                *day = stream->day;
+            
+            SalesData *next = &stream->day;
+            memset(next, 0, sizeof(*next));
+            next->date = date;
+            next->ca_ttc = extract_number(fields[dialect->columns[SALES_TTC]]);
+            next->ca_ht = extract_number(fields[dialect->columns[SALES_HT]]);
+            stream->has_day = 1;
+            
+            date_format(date, text);
+            JV_LOG("Read sales entry: Date=%s, TTC=" MONEY_PRINTF ", HT=" MONEY_PRINTF "\n", 
+                   text, MONEY_PRINTF_ARGS(next->ca_ttc), MONEY_PRINTF_ARGS(next->ca_ht));
+            if (complete)
+                return 1;
+        } 
+        // Check if this is a VAT details cell, one quoted cell with a line per rate
+        else if (stream->has_day && lex_vat_cell(date_field, strlen(date_field), &stream->day)) {
+            STATS_ADD(STAT_VAT_CELLS, 1);
+        } else {
+            STATS_ADD(STAT_SKIPPED_NOT_DATE, 1);
         }
     }
     
-    fclose(file);
-    printf("Finished reading payment data. Found %d entries.\n", count);
-    return count;
+    // End of the export: the last day
+    if (!stream->has_day)
+        return 0;
+    *day = stream->day;
+    stream->has_day = 0;
+    return 1;
 }
 
-// Combine sales and payment data into journal entries - improved matching with flexible tolerance
-int combine_data(SalesData *sales_data, int sales_count, 
-                PaymentData *payment_data, int payment_count,
-                JournalEntry *journal_entries) {
-    int entry_count = 0;
-    
-    printf("Combining data: %d sales entries and %d payment entries\n", sales_count, payment_count);
+// Start streaming the payments export held in a writable, NUL-terminated buffer
+void payment_stream_init(PaymentStream *stream, char *data, size_t size) {
+    memset(stream, 0, sizeof(*stream));
+    if (stream_start(&stream->scanner, &stream->dialect, payment_columns, PAYMENT_COLUMNS, data, size))
+        JV_LOG("Found payment data section header\n");
+}
+
+// Next day of the payments export; returns 0 at the end or at the totals line
+int payment_stream_next(PaymentStream *stream, PaymentData *payment) {
+    const CsvDialect *dialect = &stream->dialect;
+    Slice record;
+    char *fields[20];
+    char text[DATE_TEXT_SIZE];
     
-    for (int i = 0; i < sales_count && entry_count < MAX_ENTRIES; i++) {
-        // Skip days with no sales
-        if (sales_data[i].ca_ttc == 0) {
-            printf("Skipping date %s with zero sales\n", sales_data[i].date);
+    while (!stream->done && csv_next_record(&stream->scanner, &record)) {
+        char *line = (char *)record.ptr;
+        STATS_ADD(STAT_LINES_READ, 1);
+        
+        if (record.len == 0) {
+            STATS_ADD(STAT_SKIPPED_EMPTY, 1);
             continue;
         }
         
-        // Find matching payment data
-        PaymentData *payment = NULL;
-        for (int j = 0; j < payment_count; j++) {
-            printf("Comparing sales date '%s' with payment date '%s'\n", 
-                   sales_data[i].date, payment_data[j].date);
-                   
-            if (strcmp(sales_data[i].date, payment_data[j].date) == 0) {
-                payment = &payment_data[j];
-                printf("Match found for date %s\n", sales_data[i].date);
-                break;
-            }
+        // Parse the record
+        int field_count = parse_csv_line(line, record.len, fields, 20, dialect->delimiter);
+        if (field_count < dialect->required_fields) {
+            STATS_ADD(STAT_SKIPPED_NOT_DATE, 1);
+            continue;
         }
+        const char *date_field = fields[dialect->columns[PAYMENT_DATE]];
+        const char *especes = fields[dialect->columns[PAYMENT_ESPECES]];
+        const char *cartes = fields[dialect->columns[PAYMENT_CARTES]];
+        int total = dialect->columns[PAYMENT_TOTAL];
         
-        if (!payment) {
-            fprintf(stderr, "Warning: No payment data found for date %s, creating entry with just sales data\n", 
-                    sales_data[i].date);
+        // Check if this is a data line with date and payment info
+        if (date_parse(date_field, strlen(date_field), dialect->order, &payment->date)) {
             
-            // Create journal entry with just sales data
-            JournalEntry entry = {0};
-            strcpy(entry.date, sales_data[i].date);
-            convert_date_to_julian(entry.date, entry.jour);
+            // Parse payment amounts
+            payment->especes = extract_number(especes);
+            payment->cartes = extract_number(cartes);
             
-            entry.vente_5_5 = sales_data[i].vat_5_5_ht;
-            entry.tva_5_5 = sales_data[i].vat_5_5_amount;
-            entry.vente_20 = sales_data[i].vat_20_ht;
-            entry.tva_20 = sales_data[i].vat_20_amount;
-            entry.cb = sales_data[i].ca_ttc * 0.8; // Estimate 80% as CB if unknown
-            entry.especes = sales_data[i].ca_ttc * 0.2; // Estimate 20% as cash if unknown
+            // Try to get the total from its column or calculate it
+            if (total >= 0 && total < field_count && *fields[total]) {
+                payment->total = extract_number(fields[total]);
+            } else {
+                // Calculate total from available payment methods
+                payment->total = payment->especes + payment->cartes;
+            }
             
-            printf("Creating journal entry with estimated payments for date %s\n", entry.date);
-            journal_entries[entry_count++] = entry;
-            continue;
+            date_format(payment->date, text);
+            JV_LOG("Read payment entry: Date=%s, Especes=" MONEY_PRINTF ", Cartes=" MONEY_PRINTF
+                   ", Total=" MONEY_PRINTF "\n", 
+                   text, MONEY_PRINTF_ARGS(payment->especes), 
+                   MONEY_PRINTF_ARGS(payment->cartes), MONEY_PRINTF_ARGS(payment->total));
+            STATS_ADD(STAT_RECORDS_PARSED, 1);
+            return 1;
         }
-        
-        // Create journal entry
-        JournalEntry entry = {0};
-        strcpy(entry.date, sales_data[i].date);
-        convert_date_to_julian(entry.date, entry.jour);
-        
-        entry.vente_5_5 = sales_data[i].vat_5_5_ht;
-        entry.tva_5_5 = sales_data[i].vat_5_5_amount;
-        entry.vente_20 = sales_data[i].vat_20_ht;
-        entry.tva_20 = sales_data[i].vat_20_amount;
-        entry.cb = payment->cartes;
-        entry.especes = payment->especes;
-        
-        // Validate the data totals match approximately with more flexible tolerance (5%)
-        double sales_total = sales_data[i].ca_ttc;
-        double payment_total = payment->total;
-        double tolerance = sales_total * 0.05; // 5% tolerance
-        
-        if (fabs(sales_total - payment_total) > tolerance) { 
-            printf("Warning: For date %s, sales total (%.2f) doesn't match payment total (%.2f)\n",
-                   entry.date, sales_total, payment_total);
-            
-            // Adjust payment values proportionally if a small discrepancy
-            if (payment_total > 0 && fabs(sales_total - payment_total) < sales_total * 0.25) {
-                double ratio = sales_total / payment_total;
-                entry.cb *= ratio;
-                entry.especes *= ratio;
-                printf("Adjusted payment values by factor %.2f to match sales total\n", ratio);
-            }
+        // Check if we've reached the totals line (usually has no date)
+        if (!strchr(date_field, '/') && isdigit((unsigned char)especes[0]) && isdigit((unsigned char)cartes[0])) {
+            JV_LOG("Found totals line, ending payment data processing\n");
+            stream->done = 1;
+        } else {
+            STATS_ADD(STAT_SKIPPED_NOT_DATE, 1);
         }
-        
-        printf("Creating journal entry for date %s: 5.5%% (%.2f/%.2f), 20%% (%.2f/%.2f), CB=%.2f, Especes=%.2f\n",
-               entry.date, entry.vente_5_5, entry.tva_5_5, entry.vente_20, entry.tva_20, 
-               entry.cb, entry.especes);
-        
-        // Store the entry
-        journal_entries[entry_count++] = entry;
     }
-    
-    printf("Combined %d entries\n", entry_count);
-    return entry_count;
+    return 0;
 }
 
-// Write journal entries to CSV file
-static void format_fr(double value, char *out, size_t outsz) {
-    char tmp[64];
-    snprintf(tmp, sizeof(tmp), "%.2f", value);
-    for (char *p = tmp; *p; ++p) if (*p == '.') *p = ',';
-    strncpy(out, tmp, outsz - 1);
-    out[outsz - 1] = '\0';
+// Every day of the payments export in the index, checking their order
+static int payment_index_build(PaymentIndex *index, char *data, size_t size) {
+    PaymentStream stream;
+    PaymentData payment;
+    
+    memset(index, 0, sizeof(*index));
+    index->ordered = 1;
+    payment_stream_init(&stream, data, size);
+    while (payment_stream_next(&stream, &payment)) {
+        if (index->count == index->capacity) {
+            int capacity = index->capacity ? index->capacity * 2 : 64;
+            PaymentData *grown = realloc(index->days, (size_t)capacity * sizeof(PaymentData));
+            if (!grown)
+                return 0;
+            index->days = grown;
+            index->capacity = capacity;
+        }
+        if (index->count > 0 && payment.date < index->days[index->count - 1].date)
+            index->ordered = 0;
+        index->days[index->count++] = payment;
+    }
+    JV_LOG("Finished reading payment data. Found %d entries.\n", index->count);
+    return 1;
 }
 
-int write_journal_file(const char *filename, JournalEntry *entries, int count) {
-    FILE *file = fopen(filename, "w");
-    if (!file) {
-        fprintf(stderr, "Error creating output file: %s\n", filename);
+static size_t date_slot(const PaymentIndex *index, Day date) {
+    // Fibonacci hashing of the day number
+    return (size_t)(((uint32_t)date * 2654435769u) >> 7) & index->mask;
+}
+
+// Hash table of the dates, the first day of the export wins as in a scan
+static int payment_index_hash(PaymentIndex *index) {
+    size_t size = 64;
+    while (size < (size_t)index->count * 2)
+        size *= 2;
+    index->slots = calloc(size, sizeof(int32_t));
+    if (!index->slots)
         return 0;
+    index->mask = size - 1;
+    for (int i = 0; i < index->count; i++) {
+        size_t slot = date_slot(index, index->days[i].date);
+        while (index->slots[slot] && index->days[index->slots[slot] - 1].date != index->days[i].date)
+            slot = (slot + 1) & index->mask;
+        if (!index->slots[slot])
+            index->slots[slot] = i + 1;
     }
-    
-    // Write header (use 'cpte' as requested)
-    fprintf(file, "Journal;Jour;cpte;Libelle;Debit;Credit\n");
+    return 1;
+}
 
-    // Write entries (comptes fixes)
-    for (int i = 0; i < count; i++) {
-        JournalEntry *e = &entries[i];
-        char a[32], b[32], c[32], d[32], cb[32], esp[32];
-        format_fr(e->vente_5_5, a, sizeof(a));
-        format_fr(e->tva_5_5, b, sizeof(b));
-        format_fr(e->vente_20, c, sizeof(c));
-        format_fr(e->tva_20, d, sizeof(d));
-        format_fr(e->cb, cb, sizeof(cb));
-        format_fr(e->especes, esp, sizeof(esp));
+static const PaymentData *payment_index_find(const PaymentIndex *index, Day date) {
+    size_t slot = date_slot(index, date);
+    while (index->slots[slot]) {
+        const PaymentData *payment = &index->days[index->slots[slot] - 1];
+        if (payment->date == date)
+            return payment;
+        slot = (slot + 1) & index->mask;
+    }
+    return NULL;
+}
+
+static void payment_index_free(PaymentIndex *index) {
+    free(index->days);
+    free(index->slots);
+    memset(index, 0, sizeof(*index));
+}
+
+// Journal entry of a sales day and its payments, estimated when payment is NULL
+void combine_day(const SalesData *sales, const PaymentData *payment, JournalEntry *entry) {
+    char text[DATE_TEXT_SIZE];
+    
+    memset(entry, 0, sizeof(*entry));
+    entry->date = sales->date;
+    date_format(entry->date, text);
+    memcpy(entry->vat, sales->vat, sizeof(entry->vat));
+    entry->vat_count = sales->vat_count;
+    
+    if (!payment) {
+        STATS_ADD(STAT_UNMATCHED_DAYS, 1);
+        fprintf(stderr, "Warning: No payment data found for date %s, creating entry with just sales data\n", 
+                text);
+        entry->cb = money_muldiv(sales->ca_ttc, 80, 100); // Estimate 80% as CB if unknown
+        entry->especes = money_muldiv(sales->ca_ttc, 20, 100); // Estimate 20% as cash if unknown
+        JV_LOG("Creating journal entry with estimated payments for date %s\n", text);
+        return;
+    }
+    
+    JV_LOG("Match found for date %s\n", text);
+    entry->cb = payment->cartes;
+    entry->especes = payment->especes;
+    
+    // Validate the data totals match approximately with more flexible tolerance (5%)
+    Money sales_total = sales->ca_ttc;
+    Money payment_total = payment->total;
+    Money gap = money_abs(sales_total - payment_total);
+    
+    if (gap * 100 > sales_total * 5) { 
+        JV_LOG("Warning: For date %s, sales total (" MONEY_PRINTF ") doesn't match payment total ("
+               MONEY_PRINTF ")\n", text, MONEY_PRINTF_ARGS(sales_total), MONEY_PRINTF_ARGS(payment_total));
         
-        // Sales 5.5% VAT (credit)
-        fprintf(file, "VE;%s;7071;Vente 5,5%%;;%s\n", e->jour, a);
-        // VAT 5.5% (credit)
-        fprintf(file, "VE;%s;4457111;TVA 5,5%%;;%s\n", e->jour, b);
-        // Sales 20% VAT (credit)
-        fprintf(file, "VE;%s;7072;Vente 20%%;;%s\n", e->jour, c);
-        // VAT 20% (credit)
-        fprintf(file, "VE;%s;445711;TVA 20%%;;%s\n", e->jour, d);
-        // Credit card payment (debit)
-        fprintf(file, "VE;%s;580CB;CB;%s;\n", e->jour, cb);
-        // Cash payment (debit)
-        fprintf(file, "VE;%s;530;Especes;%s;\n", e->jour, esp);
+        // Adjust payment values proportionally if a small discrepancy (rounded to the cent)
+        if (payment_total > 0 && gap * 100 < sales_total * 25) {
+            STATS_ADD(STAT_ADJUSTED_DAYS, 1);
+            entry->cb = money_muldiv(entry->cb, sales_total, payment_total);
+            entry->especes = money_muldiv(entry->especes, sales_total, payment_total);
+            JV_LOG("Adjusted payment values by factor %.2f to match sales total\n",
+                   (double)sales_total / (double)payment_total);
+        }
     }
     
-    fclose(file);
-    return 1;
+    JV_LOG("Creating journal entry for date %s: %d VAT rate(s), CB=" MONEY_PRINTF ", Especes=" MONEY_PRINTF "\n",
+           text, entry->vat_count, MONEY_PRINTF_ARGS(entry->cb), MONEY_PRINTF_ARGS(entry->especes));
+}
+
+// Write the rows of one journal entry: a sale and VAT pair per rate, then the payments (comptes fixes)
+void write_sales_entry(JournalWriter *writer, const JournalEntry *e) {
+    char text[DATE_TEXT_SIZE];
+    Slice jour = slice_between(text, text + date_format(e->date, text));
+    
+    // Sales and VAT of each rate of the day (credit), accounts from the rate table
+    for (int i = 0; i < e->vat_count; i++) {
+        const VatBucket *bucket = &e->vat[i];
+        const VatAccounts *accounts = vat_accounts(bucket->rate);
+        char rate[16], libelle[32];
+        
+        format_rate(bucket->rate, rate);
+        if (!accounts) {
+            fprintf(stderr, "Warning: No accounts for VAT %s%% on %s, its sales are not booked (add the rate to "
+                    VAT_ACCOUNTS_FILE ")\n", rate, text);
+            continue;
+        }
+        snprintf(libelle, sizeof(libelle), "Vente %s%%", rate);
+        jwriter_row_amount(writer, SLICE_LIT("VE"), jour, slice_cstr(accounts->sales_account),
+                           slice_cstr(libelle), bucket->ht, JOURNAL_CREDIT);
+        STATS_ADD(STAT_ENTRIES_WRITTEN, 1);
+        if (accounts->vat_account) {
+            snprintf(libelle, sizeof(libelle), "TVA %s%%", rate);
+            jwriter_row_amount(writer, SLICE_LIT("VE"), jour, slice_cstr(accounts->vat_account),
+                               slice_cstr(libelle), bucket->amount, JOURNAL_CREDIT);
+            STATS_ADD(STAT_ENTRIES_WRITTEN, 1);
+        }
+    }
+    STATS_ADD(STAT_ENTRIES_WRITTEN, 2);
+    // Credit card payment (debit)
+    jwriter_row_amount(writer, SLICE_LIT("VE"), jour, SLICE_LIT("580CB"), SLICE_LIT("CB"),
+                       e->cb, JOURNAL_DEBIT);
+    // Cash payment (debit)
+    jwriter_row_amount(writer, SLICE_LIT("VE"), jour, SLICE_LIT("530"), SLICE_LIT("Especes"),
+                       e->especes, JOURNAL_DEBIT);
 }
 
 // Create output filename based on month and year
 void create_output_filename(char *output_filename, size_t size) {
     time_t now;
-    struct tm *time_info;
+    struct tm time_info;
     
     time(&now);
-    time_info = localtime(&now);
+    localtime_r(&now, &time_info);
     
-    int month = time_info->tm_mon + 1; // tm_mon is 0-11
-    int year = time_info->tm_year + 1900;
+    int month = time_info.tm_mon + 1; // tm_mon is 0-11
+    int year = time_info.tm_year + 1900;
     
     char *month_name = get_month_name(month);
     
@@ -512,61 +527,99 @@ void extract_month_year(const char *filename, int *month, int *year) {
     }
 }
 
-// Main function to process files and create journal
-int main(int argc, char *argv[]) {
-    char ca_filename[256] = "/Users/igilbert/Desktop/Projets/ParserBocal/assets/Journal Vente Fevrier 2025/CAISSE-CA Fevrier 2025.csv";
-    char reglement_filename[256] = "/Users/igilbert/Desktop/Projets/ParserBocal/assets/Journal Vente Fevrier 2025/CAISSE-Reglement Fevrier 2025.csv";
-    char output_filename[256];
-    
-    // Allow command line arguments for filenames
-    if (argc >= 3) {
-        strncpy(ca_filename, argv[1], sizeof(ca_filename) - 1);
-        strncpy(reglement_filename, argv[2], sizeof(reglement_filename) - 1);
-    }
-    
-    printf("Processing files:\n1. %s\n2. %s\n", ca_filename, reglement_filename);
-    
-    // Create output filename based on input
+// Name of the journal: month and year of the sales file name, else the current month
+void journal_output_name(const char *ca_filename, char *output_filename, size_t size) {
     int month, year;
     extract_month_year(ca_filename, &month, &year);
     
     if (month > 0 && year > 0) {
         char *month_name = get_month_name(month);
-        snprintf(output_filename, sizeof(output_filename), "journal VE %s %d.csv", month_name, year);
+        snprintf(output_filename, size, "journal VE %s %d.csv", month_name, year);
     } else {
-        create_output_filename(output_filename, sizeof(output_filename));
+        create_output_filename(output_filename, size);
     }
-    
-    printf("Output will be written to: %s\n", output_filename);
-    
-    // Read sales and payment data
-    SalesData sales_data[MAX_ENTRIES];
-    PaymentData payment_data[MAX_ENTRIES];
-    JournalEntry journal_entries[MAX_ENTRIES];
-    
-    int sales_count = read_sales_data(ca_filename, sales_data, MAX_ENTRIES);
-    int payment_count = read_payment_data(reglement_filename, payment_data, MAX_ENTRIES);
-    
-    if (sales_count == 0 || payment_count == 0) {
-        fprintf(stderr, "Error: No data read from input files. Aborting.\n");
-        return 1;
+}
+
+// Build the journal from the sales stream and the payments export, held in a
+// writable NUL-terminated buffer. The payments are indexed by day, then the
+// sales days are streamed and joined one at a time, straight to the output: a
+// merge join while both exports are in date order, a hash join on the day
+// numbers otherwise. Read from a file, the sales only take their window, so
+// memory follows the days of the payments export whatever the length of the
+// sales export.
+// Returns the number of entries written, 0 if no day matched, -1 if an export has no data.
+int generate_sales_journal(SalesStream *stream, char *payments, size_t payments_size, JournalWriter *output) {
+    PaymentIndex index;
+    SalesData day;
+    JournalEntry entry;
+    int sales_count = 0;
+    int entry_count = 0;
+    int cursor = 0;
+    Day last_date = DATE_NONE;
+    
+    STATS_LAP_START();
+    if (!payment_index_build(&index, payments, payments_size)) {
+        fprintf(stderr, "Error: Out of memory while reading the payments\n");
+        payment_index_free(&index);
+        return -1;
     }
-    
-    // Combine data and create journal
-    int entry_count = combine_data(sales_data, sales_count, payment_data, payment_count, journal_entries);
-    
-    if (entry_count == 0) {
-        fprintf(stderr, "Error: No matching entries found. Check date formats in input files.\n");
-        return 1;
+    STATS_LAP(STAT_STAGE_PARSE);
+    if (index.count == 0) {
+        payment_index_free(&index);
+        return -1;
+    }
+    int hashed = !index.ordered;
+    if (hashed && !payment_index_hash(&index)) {
+        payment_index_free(&index);
+        return -1;
     }
     
-    // Write output file
-    if (!write_journal_file(output_filename, journal_entries, entry_count)) {
-        fprintf(stderr, "Error writing to output file: %s\n", output_filename);
-        return 1;
+    sales_stream_start(stream);
+    while (sales_stream_next(stream, &day)) {
+        sales_count++;
+        STATS_LAP(STAT_STAGE_PARSE);
+        
+        // Skip days with no sales
+        if (day.ca_ttc == 0) {
+            STATS_ADD(STAT_SKIPPED_NO_SALES, 1);
+            char text[DATE_TEXT_SIZE];
+            date_format(day.date, text);
+            JV_LOG("Skipping date %s with zero sales\n", text);
+            continue;
+        }
+        
+        // A sales day before the previous one ends the merge join
+        if (!hashed && day.date < last_date) {
+            JV_LOG("Sales days out of date order, joining on a hash of the payment days\n");
+            if (!payment_index_hash(&index)) {
+                fprintf(stderr, "Error: Out of memory while indexing the payments\n");
+                break;
+            }
+            hashed = 1;
+        }
+        last_date = day.date;
+        
+        const PaymentData *payment;
+        if (hashed) {
+            payment = payment_index_find(&index, day.date);
+        } else {
+            while (cursor < index.count && index.days[cursor].date < day.date)
+                cursor++;
+            payment = cursor < index.count && index.days[cursor].date == day.date ? &index.days[cursor] : NULL;
+        }
+        combine_day(&day, payment, &entry);
+        STATS_LAP(STAT_STAGE_CLASSIFY);
+        
+        // Write header (use 'cpte' as requested) before the first entry
+        if (entry_count == 0)
+            jwriter_header(output);
+        write_sales_entry(output, &entry);
+        entry_count++;
+        STATS_LAP(STAT_STAGE_WRITE);
     }
     
-    printf("Successfully processed %d entries and wrote to %s\n", entry_count, output_filename);
-    return 0;
+    JV_LOG("Finished reading sales data. Found %d entries.\n", sales_count);
+    JV_LOG("Combined %d entries\n", entry_count);
+    payment_index_free(&index);
+    return sales_count == 0 ? -1 : entry_count;
 }
-
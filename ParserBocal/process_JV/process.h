@@ -6,7 +6,7 @@
 /*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
 /*                                                +#+#+#+#+#+   +#+           */
 /*   Created: 2025/04/18 15:50:41 by igilbert          #+#    #+#             */
-/*   Updated: 2025/05/05 11:11:06 by igilbert         ###   ########.fr       */
+/*   Updated: 2026/10/17 01:37:05 by igilbert         ###   ########.fr       */
 /*                                                                            */
 /* ************************************************************************** */
 
@@ -16,9 +16,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
 #include <time.h>
-#include <math.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -26,61 +26,120 @@
 #include <limits.h>
 #include <stdbool.h>
 #include <fcntl.h>
+#include "../common/jwriter.h"
+#include "../common/csvscan.h"
+#include "../common/stats.h"
+#include "../common/dates.h"
+#include "../common/dialect.h"
 
-#define MAX_LINE_LENGTH 4096
-#define MAX_DATE_LENGTH 20
-#define MAX_ENTRIES 100
 #define MAX_FIELD_LENGTH 256
 #define MAX_FILENAME_LENGTH 512
+#define VAT_MAX_RATES 8
+#define VAT_MAX_ACCOUNTS 16
+#define SALES_WINDOW_SIZE 65536
+#define VAT_ACCOUNTS_FILE "Comptes TVA.csv"
+
+// Sales of one VAT rate over a day
+typedef struct {
+    int32_t rate;                // basis points, 550 for 5.5%
+    Money ht;
+    Money amount;                // VAT
+} VatBucket;
+
+// Accounts of a VAT rate; no VAT row when vat_account is NULL
+typedef struct {
+    int32_t rate;
+    const char *sales_account;
+    const char *vat_account;
+} VatAccounts;
 
 // Structure to hold sales data from CAISSE-CA file
 typedef struct {
-    char date[MAX_DATE_LENGTH];
-    double ca_ttc;
-    double ca_ht;
-    double vat_5_5_amount;
-    double vat_5_5_ht;
-    double vat_20_amount;
-    double vat_20_ht;
+    Day date;                    // the join key
+    Money ca_ttc;
+    Money ca_ht;
+    VatBucket vat[VAT_MAX_RATES]; // rates of the day in the order of the accounts table
+    int vat_count;
 } SalesData;
 
 // Structure to hold payment data from CAISSE-Reglement file
 typedef struct {
-    char date[MAX_DATE_LENGTH];
-    double especes;
-    double cartes;
-    double total;
+    Day date;
+    Money especes;
+    Money cartes;
+    Money total;
 } PaymentData;
 
 // Structure to hold a combined journal entry
 typedef struct {
-    char date[MAX_DATE_LENGTH];
-    char jour[MAX_FIELD_LENGTH]; // Julian date
-    double vente_5_5;            // Sales at 5.5% VAT
-    double tva_5_5;              // 5.5% VAT amount
-    double vente_20;             // Sales at 20% VAT
-    double tva_20;               // 20% VAT amount
-    double cb;                   // Card payments
-    double especes;              // Cash payments
+    Day date;
+    VatBucket vat[VAT_MAX_RATES]; // Sales and VAT of each rate
+    int vat_count;
+    Money cb;                    // Card payments
+    Money especes;               // Cash payments
 } JournalEntry;
 
+// Days of the CAISSE-CA export one at a time: a date line and the TVA cell after it.
+// The export is read from fd through a window, or held whole when borrowed.
+typedef struct {
+    int fd;
+    char *buf;
+    size_t cap;
+    size_t end;                  // bytes of the export in the window
+    int eof;
+    int borrowed;                // buf belongs to the caller
+    CsvScanner scanner;          // records of the window after the header row
+    CsvDialect dialect;          // of the export, found from a sample
+    int has_day;                 // day holds a date line whose TVA cell may follow
+    SalesData day;
+} SalesStream;
+
+// Days of the CAISSE-Reglement export one at a time, up to its totals line
+typedef struct {
+    CsvScanner scanner;
+    CsvDialect dialect;
+    int done;
+} PaymentStream;
+
+// Payments by day, the build side of the join: a merge cursor when the days
+// are in date order, an open addressing table on the keys otherwise
+typedef struct {
+    PaymentData *days;
+    int count;
+    int capacity;
+    int ordered;                 // dates never decrease
+    int32_t *slots;              // position + 1 of the first day of a date, 0 when empty
+    size_t mask;
+} PaymentIndex;
+
+// Progress messages, silenced with -q or by the library (per thread for the service)
+extern _Thread_local int jv_verbose;
+#define JV_LOG(...) do { if (jv_verbose) printf(__VA_ARGS__); } while (0)
+
 // Function prototypes
-int read_sales_data(const char *filename, SalesData *sales_data, int max_entries);
-int read_payment_data(const char *filename, PaymentData *payment_data, int max_entries);
-int combine_data(SalesData *sales_data, int sales_count, 
-                 PaymentData *payment_data, int payment_count,
-                 JournalEntry *journal_entries);
-int write_journal_file(const char *filename, JournalEntry *entries, int count);
+int sales_stream_open(SalesStream *stream, int fd);
+void sales_stream_init(SalesStream *stream, char *data, size_t size);
+void sales_stream_free(SalesStream *stream);
+int sales_stream_next(SalesStream *stream, SalesData *day);
+void payment_stream_init(PaymentStream *stream, char *data, size_t size);
+int payment_stream_next(PaymentStream *stream, PaymentData *payment);
+void combine_day(const SalesData *sales, const PaymentData *payment, JournalEntry *entry);
+void write_sales_entry(JournalWriter *writer, const JournalEntry *entry);
+int generate_sales_journal(SalesStream *sales, char *payments, size_t payments_size, JournalWriter *output);
+void journal_output_name(const char *ca_filename, char *output_filename, size_t size);
 char* get_month_name(int month);
-void convert_date_to_julian(const char *date, char *julian);
 void create_output_filename(char *output_filename, size_t size);
 void extract_month_year(const char *filename, int *month, int *year);
 
 // Helper functions
 char* trim(char *str);
-int parse_csv_line(char *line, char **fields, int max_fields, char delimiter);
-double extract_number(const char *str);
-void extract_vat_info(const char *line, double *vat_5_5_amount, double *vat_5_5_ht, 
-                     double *vat_20_amount, double *vat_20_ht);
+int parse_csv_line(char *line, size_t line_len, char **fields, int max_fields, char delimiter);
+Money extract_number(const char *str);
+
+// VAT details (vat.c)
+int lex_vat_cell(const char *cell, size_t len, SalesData *day);
+const VatAccounts *vat_accounts(int32_t rate);
+int vat_load_accounts(const char *path);
+size_t format_rate(int32_t rate, char *out);
 
 #endif /* PROCESS_H */
\ No newline at end of file
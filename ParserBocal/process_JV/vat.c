@@ -0,0 +1,215 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   vat.c                                              :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: igilbert <igilbert@student.42perpignan.    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/16 15:43:24 by igilbert          #+#    #+#             */
+/*   Updated: 2026/10/17 01:31:43 by igilbert         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "process.h"
+
+// VAT details of a CAISSE-CA day: one quoted cell holding a line per rate,
+//   TVA: 5.50%  Montant:   22.73  HT:  413.28  TTC:  436.01     Marge:  198.46
+// read in one pass into the buckets of the day, whatever the rates.
+
+// Comptes fixes of the rates every client has; the journal lists the rates of
+// a day in the order of this table. Other rates are booked only once
+// VAT_ACCOUNTS_FILE gives their accounts, never into made-up ones.
+static VatAccounts vat_table[VAT_MAX_ACCOUNTS] = {
+    {550, "7071", "4457111"},
+    {2000, "7072", "445711"},
+};
+static int vat_table_size = 2;
+
+typedef enum {
+    VAT_KEY_NONE,
+    VAT_KEY_RATE,
+    VAT_KEY_AMOUNT,
+    VAT_KEY_HT,
+    VAT_KEY_TTC,
+    VAT_KEY_MARGE
+} VatKey;
+
+// Labels of the cell, each followed by ':' and a number
+static const struct {
+    const char *name;
+    size_t len;
+    VatKey key;
+} vat_keys[] = {
+    {"TVA", 3, VAT_KEY_RATE}, {"Montant", 7, VAT_KEY_AMOUNT}, {"HT", 2, VAT_KEY_HT},
+    {"TTC", 3, VAT_KEY_TTC}, {"Marge", 5, VAT_KEY_MARGE},
+};
+
+enum { CHAR_OTHER, CHAR_LETTER, CHAR_DIGIT, CHAR_COLON };
+
+// Class of each byte; bytes of accented letters count as letters
+static unsigned char char_class(unsigned char c) {
+    if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c >= 0x80) return CHAR_LETTER;
+    if (c >= '0' && c <= '9') return CHAR_DIGIT;
+    return c == ':' ? CHAR_COLON : CHAR_OTHER;
+}
+
+static VatKey vat_key(const char *word, size_t len) {
+    for (size_t k = 0; k < sizeof(vat_keys) / sizeof(vat_keys[0]); k++) {
+        if (vat_keys[k].len == len && memcmp(vat_keys[k].name, word, len) == 0)
+            return vat_keys[k].key;
+    }
+    return VAT_KEY_NONE;
+}
+
+// Position of a rate in the journal: the accounts table first, then the other rates
+static int64_t rate_rank(int32_t rate) {
+    for (int i = 0; i < vat_table_size; i++) {
+        if (vat_table[i].rate == rate)
+            return i;
+    }
+    return vat_table_size + (int64_t)rate - INT32_MIN;
+}
+
+// Add a rate line to the buckets of the day, kept in journal order
+static void add_bucket(SalesData *day, const VatBucket *line) {
+    int i = 0;
+    if (line->ht == 0 && line->amount == 0)
+        return;
+    while (i < day->vat_count && day->vat[i].rate != line->rate)
+        i++;
+    if (i < day->vat_count) {
+        day->vat[i].ht += line->ht;
+        day->vat[i].amount += line->amount;
+        return;
+    }
+    if (day->vat_count == VAT_MAX_RATES) {
+        fprintf(stderr, "Warning: More than %d VAT rates on a day, rate %d.%02d%% ignored\n",
+                VAT_MAX_RATES, line->rate / 100, line->rate % 100);
+        return;
+    }
+    int64_t rank = rate_rank(line->rate);
+    for (i = day->vat_count; i > 0 && rate_rank(day->vat[i - 1].rate) > rank; i--)
+        day->vat[i] = day->vat[i - 1];
+    day->vat[i] = *line;
+    day->vat_count++;
+}
+
+// Read the rate lines of a VAT details cell into the buckets of the day;
+// returns the number of lines read, 0 if the cell holds no VAT details
+int lex_vat_cell(const char *cell, size_t len, SalesData *day) {
+    const char *p = cell, *end = cell + len;
+    VatBucket line = {0, 0, 0};
+    VatKey key = VAT_KEY_NONE;
+    int open = 0, lines = 0;
+    Money value;
+
+    while (p < end) {
+        switch (char_class((unsigned char)*p)) {
+        case CHAR_LETTER: {
+            const char *word = p;
+            while (p < end && char_class((unsigned char)*p) == CHAR_LETTER)
+                p++;
+            key = vat_key(word, (size_t)(p - word));
+            break;
+        }
+        case CHAR_COLON: {
+            // The number runs up to the next label, '%' or line, in hundredths
+            const char *number = ++p;
+            while (p < end && char_class((unsigned char)*p) != CHAR_LETTER && *p != ':' && *p != '%' &&
+                   *p != '\n')
+                p++;
+            if (key == VAT_KEY_NONE || !money_parse(number, (size_t)(p - number), &value)) {
+                key = VAT_KEY_NONE;
+                break;
+            }
+            if (key == VAT_KEY_RATE) {
+                // A rate starts the next line
+                if (open)
+                    add_bucket(day, &line);
+                line.rate = (int32_t)value;
+                line.ht = 0;
+                line.amount = 0;
+                open = 1;
+                lines++;
+            } else if (open && key == VAT_KEY_AMOUNT) {
+                line.amount = value;
+            } else if (open && key == VAT_KEY_HT) {
+                line.ht = value;
+            }
+            key = VAT_KEY_NONE;
+            break;
+        }
+        default:
+            // Spaces and '%' keep a label waiting for its ':', anything else drops it
+            if (*p != ' ' && *p != '\t' && *p != '%')
+                key = VAT_KEY_NONE;
+            p++;
+            break;
+        }
+    }
+    if (open)
+        add_bucket(day, &line);
+    return lines;
+}
+
+// Accounts of a rate, NULL when neither the table nor the accounts file has it
+const VatAccounts *vat_accounts(int32_t rate) {
+    for (int i = 0; i < vat_table_size; i++) {
+        if (vat_table[i].rate == rate)
+            return &vat_table[i];
+    }
+    return NULL;
+}
+
+// Add the rates of an accounts file, Taux;Compte vente;Compte TVA with an
+// empty Compte TVA for a rate without VAT row; a rate already in the table
+// takes the accounts of the file. The file stays loaded for the strings.
+// Returns 0 if the file cannot be read.
+int vat_load_accounts(const char *path) {
+    size_t size;
+    char *data = csv_read_file(path, &size);
+    CsvScanner scanner;
+    Slice record;
+    int line_no = 0;
+
+    if (!data)
+        return 0;
+    csv_init(&scanner, data, size);
+    while (csv_next_record(&scanner, &record)) {
+        char *cols[3];
+        Money rate;
+        line_no++;
+        int count = parse_csv_line((char *)record.ptr, record.len, cols, 3, ';');
+        if (count == 0 || cols[0][0] == '\0' || cols[0][0] == '#' || strcasecmp(cols[0], "Taux") == 0)
+            continue;
+        if (count < 2 || cols[1][0] == '\0' || !money_parse(cols[0], strlen(cols[0]), &rate) || rate < 0 ||
+            rate > 10000) {
+            fprintf(stderr, "Warning: %s:%d: invalid VAT accounts ignored\n", path, line_no);
+            continue;
+        }
+        int i = 0;
+        while (i < vat_table_size && vat_table[i].rate != (int32_t)rate)
+            i++;
+        if (i == VAT_MAX_ACCOUNTS) {
+            fprintf(stderr, "Warning: %s:%d: more than %d VAT rates, line ignored\n", path, line_no,
+                    VAT_MAX_ACCOUNTS);
+            continue;
+        }
+        vat_table[i].rate = (int32_t)rate;
+        vat_table[i].sales_account = cols[1];
+        vat_table[i].vat_account = count > 2 && cols[2][0] ? cols[2] : NULL;
+        if (i == vat_table_size)
+            vat_table_size++;
+    }
+    return 1;
+}
+
+// "5,5", "20", "2,1" for a rate in basis points, returns the length
+size_t format_rate(int32_t rate, char *out) {
+    int whole = rate / 100, hundredths = rate % 100;
+    if (hundredths == 0)
+        return (size_t)sprintf(out, "%d", whole);
+    if (hundredths % 10 == 0)
+        return (size_t)sprintf(out, "%d,%d", whole, hundredths / 10);
+    return (size_t)sprintf(out, "%d,%02d", whole, hundredths);
+}
@@ -5,6 +5,15 @@ import subprocess
 import platform
 import webbrowser
 
+import comptabocal
+
+# Messages de succès personnalisés selon le script
+MESSAGES_SUCCES = {
+    "process_JV": "✅ Journal Vente/Encaissement généré avec succès !",
+    "process_JC": "✅ Journal Caisse généré avec succès !",
+    "process_JB": "✅ Journal Bancaire généré avec succès !"
+}
+
 # Infobulles légères façon macOS
 class Tooltip:
     def __init__(self, widget, text):
@@ -40,6 +49,8 @@ class App:
         self.root.configure(bg="#f5f7fa")
         self.fichiers = []
         self.last_dir = os.path.join(os.path.expanduser("~"), "Desktop")
+        # Bibliothèque des générateurs, gardée chargée entre deux journaux (None: exécutables)
+        self.bibliotheque = comptabocal.charger(os.path.dirname(os.path.abspath(__file__)))
         
         # Détection du thème sombre sur macOS
         self.is_dark = self._is_macos_dark_mode() if platform.system() == "Darwin" else False
@@ -571,6 +582,43 @@ class App:
     def executer_script3(self):
         self.executer_script("process_JB", self.case_fichier3a, self.case_fichier3b)
 
+    def _executer_en_memoire(self, script_name, fichiers):
+        """Génère le journal avec libcomptabocal ; False pour revenir aux exécutables."""
+        # Le journal est écrit là où l'exécutable l'aurait écrit : le dossier de l'application
+        app_dir = os.path.dirname(os.path.abspath(__file__))
+        try:
+            if script_name == "process_JB" and len(fichiers) >= 2:
+                regles = os.path.join(app_dir, "Regles JB.csv")
+                journal = self.bibliotheque.journal_bancaire(
+                    fichiers[0], fichiers[1], regles if os.path.exists(regles) else None)
+            elif script_name == "process_JV" and len(fichiers) >= 2:
+                journal = self.bibliotheque.journal_vente(fichiers[0], fichiers[1])
+            elif script_name == "process_JC" and fichiers:
+                journal = self.bibliotheque.journal_caisse(fichiers[0])
+            else:
+                return False
+        except comptabocal.ErreurComptabocal as e:
+            messagebox.showerror(
+                "Erreur de génération",
+                f"❌ Erreur lors de la génération du journal {script_name.replace('process_', '').upper()}:\n\n{e}"
+            )
+            return True
+        except OSError as e:
+            # Service arrêté en cours de route : retour aux exécutables
+            print(f"Génération en mémoire impossible, exécutables utilisés à la place : {e}")
+            self.bibliotheque = None
+            return False
+
+        try:
+            chemin = journal.enregistrer(app_dir)
+        except OSError as e:
+            messagebox.showerror("Erreur système", f"❌ Impossible d'écrire le journal :\n\n{e}")
+            return True
+
+        print(f"{journal.lignes} lignes traitées, journal écrit dans {chemin}")
+        messagebox.showinfo("Génération réussie", MESSAGES_SUCCES.get(script_name, f"✅ Le {script_name} a été généré avec succès."))
+        return True
+
     def executer_script(self, script_name, *fichiers_labels_or_lists):
         fichiers = []
         output_filename = None
@@ -618,6 +666,10 @@ class App:
         if script_name == "jb" and output_filename and output_filename not in fichiers:
             fichiers.append(output_filename)
 
+        # Génération dans le processus quand la bibliothèque est disponible
+        if self.bibliotheque is not None and self._executer_en_memoire(script_name, fichiers):
+            return
+
         try:
             # Obtenir le chemin absolu du répertoire de l'application
             app_dir = os.path.dirname(os.path.abspath(__file__))
@@ -659,13 +711,7 @@ class App:
             result = subprocess.run(args, capture_output=True, text=True, cwd=os.path.dirname(exe_path))
 
             if result.returncode == 0:
-                # Messages de succès personnalisés selon le script
-                success_messages = {
-                    "process_JV": "✅ Journal Vente/Encaissement généré avec succès !",
-                    "process_JC": "✅ Journal Caisse généré avec succès !",
-                    "process_JB": "✅ Journal Bancaire généré avec succès !"
-                }
-                message = success_messages.get(script_name, f"✅ Le {script_name} a été généré avec succès.")
+                message = MESSAGES_SUCCES.get(script_name, f"✅ Le {script_name} a été généré avec succès.")
                 messagebox.showinfo("Génération réussie", message)
                 print(f"Sortie standard: {result.stdout}")
             else:
@@ -0,0 +1,189 @@
+"""Liaison ctypes vers libcomptabocal.so : génère les journaux dans le processus
+de l'application, sans lancer process_JB, process_JV ou process_JC.
+Quand le service `comptabocal serve` tourne, les journaux lui sont demandés à
+la place : il garde les plans comptables chargés pour tous les postes.
+
+Les plans comptables et les règles chargés restent en mémoire d'un appel à
+l'autre ; un objet Comptabocal ou Service sert à un seul thread à la fois.
+"""
+
+import ctypes
+import os
+import socket
+
+NOM_BIBLIOTHEQUE = "libcomptabocal.so"
+VERSION_API = 1
+
+
+class ErreurComptabocal(Exception):
+    """Échec d'une génération, avec le message de la bibliothèque."""
+
+    def __init__(self, statut, message):
+        super().__init__(message)
+        self.statut = statut
+
+
+class _Journal(ctypes.Structure):
+    _fields_ = [
+        ("name", ctypes.c_char * 256),
+        ("text", ctypes.POINTER(ctypes.c_char)),
+        ("len", ctypes.c_size_t),
+        ("rows", ctypes.c_int),
+    ]
+
+
+class Journal:
+    """Journal produit en mémoire : nom de fichier, texte CSV et nombre de lignes."""
+
+    def __init__(self, nom, texte, lignes):
+        self.nom = nom
+        self.texte = texte
+        self.lignes = lignes
+
+    def enregistrer(self, dossier):
+        chemin = os.path.join(dossier, self.nom)
+        with open(chemin, "wb") as f:
+            f.write(self.texte)
+        return chemin
+
+
+def _chemin(valeur):
+    return os.fsencode(valeur) if valeur is not None else None
+
+
+class Comptabocal:
+    def __init__(self, chemin_bibliotheque, verbeux=False):
+        self._lib = ctypes.CDLL(chemin_bibliotheque)
+        self._declarer()
+        if self._lib.cb_api_version() != VERSION_API:
+            raise OSError(f"Version de {NOM_BIBLIOTHEQUE} incompatible")
+        self._ctx = self._lib.cb_context_new()
+        if not self._ctx:
+            raise MemoryError("cb_context_new")
+        self._lib.cb_set_verbose(self._ctx, 1 if verbeux else 0)
+
+    def _declarer(self):
+        lib = self._lib
+        ctx = ctypes.c_void_p
+        chaine = ctypes.c_char_p
+        journal = ctypes.POINTER(_Journal)
+        lib.cb_api_version.restype = ctypes.c_int
+        lib.cb_api_version.argtypes = []
+        lib.cb_context_new.restype = ctx
+        lib.cb_context_new.argtypes = []
+        lib.cb_context_free.restype = None
+        lib.cb_context_free.argtypes = [ctx]
+        lib.cb_set_verbose.restype = None
+        lib.cb_set_verbose.argtypes = [ctx, ctypes.c_int]
+        lib.cb_last_error.restype = chaine
+        lib.cb_last_error.argtypes = [ctx]
+        lib.cb_jb_file.restype = ctypes.c_int
+        lib.cb_jb_file.argtypes = [ctx, chaine, chaine, chaine, journal]
+        lib.cb_jb_buffer.restype = ctypes.c_int
+        lib.cb_jb_buffer.argtypes = [ctx, chaine, ctypes.c_size_t, chaine, chaine, journal]
+        lib.cb_jv_files.restype = ctypes.c_int
+        lib.cb_jv_files.argtypes = [ctx, chaine, chaine, journal]
+        lib.cb_jc_file.restype = ctypes.c_int
+        lib.cb_jc_file.argtypes = [ctx, chaine, journal]
+        lib.cb_journal_free.restype = None
+        lib.cb_journal_free.argtypes = [journal]
+
+    def fermer(self):
+        if self._ctx:
+            self._lib.cb_context_free(self._ctx)
+            self._ctx = None
+
+    def __del__(self):
+        try:
+            self.fermer()
+        except Exception:
+            pass
+
+    def _appeler(self, fonction, *arguments):
+        resultat = _Journal()
+        statut = fonction(self._ctx, *arguments, ctypes.byref(resultat))
+        if statut != 0:
+            message = self._lib.cb_last_error(self._ctx) or b""
+            raise ErreurComptabocal(statut, message.decode("utf-8", "replace"))
+        try:
+            texte = ctypes.string_at(resultat.text, resultat.len)
+            return Journal(resultat.name.decode("utf-8", "replace"), texte, resultat.rows)
+        finally:
+            self._lib.cb_journal_free(ctypes.byref(resultat))
+
+    def journal_bancaire(self, releve, plan_comptable, regles=None):
+        return self._appeler(self._lib.cb_jb_file, _chemin(releve), _chemin(plan_comptable),
+                             _chemin(regles))
+
+    def journal_bancaire_texte(self, donnees, plan_comptable, regles=None):
+        return self._appeler(self._lib.cb_jb_buffer, donnees, len(donnees), _chemin(plan_comptable),
+                             _chemin(regles))
+
+    def journal_vente(self, fichier_ca, fichier_reglement):
+        return self._appeler(self._lib.cb_jv_files, _chemin(fichier_ca), _chemin(fichier_reglement))
+
+    def journal_caisse(self, fichier_prlv):
+        return self._appeler(self._lib.cb_jc_file, _chemin(fichier_prlv))
+
+
+def chemin_service():
+    """Socket du service : $COMPTABOCAL_SOCKET, sinon /tmp/comptabocal-<uid>.sock."""
+    return os.environ.get("COMPTABOCAL_SOCKET") or f"/tmp/comptabocal-{os.getuid()}.sock"
+
+
+class Service:
+    """Client du service `comptabocal serve`, mêmes méthodes que Comptabocal."""
+
+    def __init__(self, chemin_socket):
+        self._socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._socket.connect(chemin_socket)
+        self._fichier = self._socket.makefile("rwb")
+        self._envoyer("PING")
+        if self._fichier.readline() != b"PONG\n":
+            raise OSError(f"Réponse inattendue du service {chemin_socket}")
+
+    def _envoyer(self, *champs):
+        ligne = "\t".join(os.fsdecode(c) for c in champs)
+        self._fichier.write(ligne.encode("utf-8", "surrogateescape") + b"\n")
+        self._fichier.flush()
+
+    def _appeler(self, *champs):
+        self._envoyer(*champs)
+        entete = self._fichier.readline().rstrip(b"\n").split(b"\t", 3)
+        if entete[0] == b"ERR" and len(entete) >= 3:
+            raise ErreurComptabocal(int(entete[1]), entete[2].decode("utf-8", "replace"))
+        if entete[0] != b"OK" or len(entete) != 4:
+            raise OSError("Connexion au service interrompue")
+        texte = self._fichier.read(int(entete[2]))
+        return Journal(entete[3].decode("utf-8", "replace"), texte, int(entete[1]))
+
+    def journal_bancaire(self, releve, plan_comptable, regles=None):
+        return self._appeler("JB", os.path.abspath(releve), os.path.abspath(plan_comptable),
+                             os.path.abspath(regles) if regles else "")
+
+    def journal_vente(self, fichier_ca, fichier_reglement):
+        return self._appeler("JV", os.path.abspath(fichier_ca), os.path.abspath(fichier_reglement))
+
+    def journal_caisse(self, fichier_prlv):
+        return self._appeler("JC", os.path.abspath(fichier_prlv))
+
+    def fermer(self):
+        self._fichier.close()
+        self._socket.close()
+
+
+def charger(dossier, verbeux=False):
+    """Service s'il tourne, sinon bibliothèque du dossier de l'application, sinon None."""
+    if hasattr(socket, "AF_UNIX") and os.path.exists(chemin_service()):
+        try:
+            return Service(chemin_service())
+        except OSError as e:
+            print(f"Service {chemin_service()} injoignable : {e}")
+    chemin = os.path.join(dossier, NOM_BIBLIOTHEQUE)
+    if not os.path.exists(chemin):
+        return None
+    try:
+        return Comptabocal(chemin, verbeux)
+    except (OSError, AttributeError, MemoryError) as e:
+        print(f"Bibliothèque {chemin} inutilisable, exécutables utilisés à la place : {e}")
+        return None